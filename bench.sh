@@ -0,0 +1,138 @@
+#!/bin/sh
+# Benchmark of SWOCS built from the bundled test cases.
+#
+# The syntax is:
+#   sh bench.sh [swocs_executable] [report_file]
+# Every case is simulated with the combinations of model types and surface
+# flow schemes and with different mesh sizes. The number of time steps is
+# limited to make a similar number of node updates in every simulation. The
+# report contains a row by simulation with the time steps, the calculation
+# time, the time steps and the node updates by second, the relative water mass
+# balance error (only with closed outlets) and the peak resident memory.
+#
+# Environment variables:
+#   BENCH_CASES: input files of the cases.
+#   BENCH_MODELS: combinations model_type:surface_flow_scheme.
+#   BENCH_NODES: numbers of mesh nodes.
+#   BENCH_UPDATES: number of node updates by simulation.
+#   BENCH_STEPS: minimum number of time steps by simulation.
+#   BENCH_TIMEOUT: maximum time of a simulation in seconds.
+
+swocs=${1:-./swocs}
+report=${2:-bench.txt}
+cases=${BENCH_CASES:-"dambreak/i-1-1-1-0.1-10 rankine-hugoniot/case1-1-1
+	normal-gaussian/case1-1-1 normal-sinusoidal/case1-1-1
+	normal-rankine-hugoniot/case1-1-1"}
+models=${BENCH_MODELS:-"1:1 1:2 1:3 1:4 2:1 2:2 2:3 3:1 3:3 4:1 4:3"}
+nodes=${BENCH_NODES:-"1000 10000 100000 1000000"}
+updates=${BENCH_UPDATES:-100000000}
+minimum_steps=${BENCH_STEPS:-100}
+timeout=${BENCH_TIMEOUT:-3600}
+
+if [ ! -x "$swocs" ]; then
+	echo "bench: unable to find the executable $swocs"
+	exit 1
+fi
+run=
+if command -v timeout > /dev/null 2>&1; then run="timeout $timeout"; fi
+dir=$(mktemp -d "${TMPDIR:-/tmp}/swocs-bench.XXXXXX") || exit 2
+trap 'rm -rf "$dir"' EXIT
+trap 'exit 2' INT TERM
+
+# input_file mode [nodes scheme model]
+# mode outlet prints the outlet type of an input file; mode write prints the
+# input file with other nodes number, surface flow scheme and model type
+input()
+{
+	awk -v mode="$2" -v n="$3" -v scheme="$4" -v model="$5" '
+	{
+		for (i = 1; i <= NF; ++i)
+		{
+			if (substr($i, 1, 1) == "(") { end = 1; break }
+			t[++nt] = $i
+		}
+		if (end) exit
+	}
+	END {
+		k = 6 + 1 + 5 * t[6] + 1 + 4 + 1
+		k += 1 + 2 * t[k]
+		k += 1 + 2 * t[k]
+		inodes = k
+		k += 2
+		if (t[inodes + 1] == 2) k += 1 + 4 * t[k]
+		if (mode == "outlet")
+		{
+			print t[2]
+			exit
+		}
+		t[inodes] = n
+		t[k + 4] = scheme
+		t[k + 6] = model
+		for (i = 1; i <= nt; ++i) print t[i]
+	}' "$1"
+}
+
+# name value: prints a number of the profile summary
+summary()
+{
+	sed -n "s/.*\"$1\":\([^,}]*\).*/\1/p" "$dir/profile"
+}
+
+{
+	echo "# SWOCS benchmark $(date -u '+%Y-%m-%d %H:%M:%S UTC')"
+	echo "# host: $(uname -srm)"
+	echo "# version: $(git rev-parse --short HEAD 2> /dev/null || echo unknown)"
+	echo "# threads: ${OMP_NUM_THREADS:-default}"
+	printf "%-36s %5s %6s %8s %8s %10s %10s %10s %10s %9s\n" \
+		"#case" "model" "scheme" "nodes" "steps" "time" "steps/s" \
+		"updates/s" "mass_error" "memory_kB"
+} > "$report"
+cat "$report"
+
+for case in $cases; do
+	if [ ! -f "$case" ]; then
+		echo "bench: unable to find the case $case"
+		continue
+	fi
+	outlet=$(input "$case" outlet)
+	for ms in $models; do
+		model=${ms%:*}
+		scheme=${ms#*:}
+		for n in $nodes; do
+			steps=$((updates / n))
+			[ $steps -lt $minimum_steps ] && steps=$minimum_steps
+			input "$case" write "$n" "$scheme" "$model" > "$dir/input"
+			rm -f "$dir/profile"
+			if $run "$swocs" -p "$dir/profile" 0 -s $steps "$dir/input" \
+				"$dir/variables" > "$dir/output" 2> /dev/null \
+				&& [ -s "$dir/profile" ]; then
+				cpu=$(sed -n 's/.*cpu=\([^ ]*\).*/\1/p' "$dir/output")
+				awk -v case="$case" -v model="$model" -v scheme="$scheme" \
+					-v n="$n" -v steps="$(summary steps)" -v cpu="$cpu" \
+					-v w0="$(summary initial)" -v w="$(summary final)" \
+					-v wi="$(summary inlet)" -v outlet="$outlet" \
+					-v memory="$(summary memory)" 'BEGIN {
+						if (steps == 0)
+						{
+							printf "%-36s %5s %6s %8d %8s\n", case, model, scheme, n,
+								"no steps"
+							exit
+						}
+						if (cpu <= 0) cpu = 1e-9
+						if (outlet == 1 && w0 + wi > 0)
+						{
+							e = (w - w0 - wi) / (w0 + wi)
+							e = sprintf("%.3e", (e < 0) ? -e : e)
+						}
+						else e = "-"
+						printf "%-36s %5s %6s %8d %8d %10.4g %10.4g %10.4g %10s %9d\n",
+							case, model, scheme, n, steps, cpu, steps / cpu,
+							steps * n / cpu, e, memory
+					}'
+			else
+				printf "%-36s %5s %6s %8d %8s\n" "$case" "$model" "$scheme" "$n" \
+					"failed"
+			fi | tee -a "$report"
+		done
+	done
+done
@@ -0,0 +1,249 @@
+/*
+SWOCS: a software to check the numerical performance of different models in
+	channel or furrow flows
+
+Copyright 2011-2014, Javier Burguete Tolosa.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Javier Burguete Tolosa ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL Javier Burguete Tolosa OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/**
+ * \file binary.c
+ * \brief Source file to define the binary results files.
+ *
+ * The binary results files avoid the formatting of the text files writing and
+ * reading the results. They are read mapping them in memory.
+ * \author Javier Burguete Tolosa.
+ * \copyright Copyright 2011-2014, Javier Burguete Tolosa.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "binary.h"
+
+/**
+ * \fn int binary_name(char *name)
+ * \brief Function to check if a file name selects the binary format (with the
+ *   ".bin" extension).
+ * \param name
+ * \brief file name.
+ * \return 1 on binary format, 0 on text format.
+ */
+int binary_name(char *name)
+{
+	size_t n;
+	n = strlen(name);
+	return n > 4 && !strcmp(name + n - 4, ".bin");
+}
+
+/**
+ * \fn int binary_write_header(FILE *file, unsigned int columnar, \
+ *   unsigned int columns, unsigned int rows, char **name)
+ * \brief Function to write the header and the field names of a binary results
+ *   file.
+ * \param file
+ * \brief output file.
+ * \param columnar
+ * \brief 1 on values stored by columns, 0 on values stored by rows.
+ * \param columns
+ * \brief number of fields.
+ * \param rows
+ * \brief number of values by field (0 if unknown, see binary_write_rows).
+ * \param name
+ * \brief array of field names.
+ * \return 0 on error, 1 on success.
+ */
+int binary_write_header(FILE *file, unsigned int columnar,
+	unsigned int columns, unsigned int rows, char **name)
+{
+	unsigned int i;
+	char buffer[BINARY_NAME_LENGTH];
+	BinaryHeader header[1];
+	memset(header, 0, sizeof(BinaryHeader));
+	memcpy(header->magic, BINARY_MAGIC, 8);
+	header->version = BINARY_VERSION;
+	header->size = sizeof(double);
+	header->columnar = columnar;
+	header->columns = columns;
+	header->rows = rows;
+	if (fwrite(header, sizeof(BinaryHeader), 1, file) != 1) return 0;
+	for (i = 0; i < columns; ++i)
+	{
+		memset(buffer, 0, BINARY_NAME_LENGTH);
+		strncpy(buffer, name[i], BINARY_NAME_LENGTH - 1);
+		if (fwrite(buffer, BINARY_NAME_LENGTH, 1, file) != 1) return 0;
+	}
+	return 1;
+}
+
+/**
+ * \fn void binary_write_rows(FILE *file, unsigned int rows)
+ * \brief Function to write the number of rows of a binary series file when it
+ *   is closed.
+ * \param file
+ * \brief output file.
+ * \param rows
+ * \brief number of rows.
+ */
+void binary_write_rows(FILE *file, unsigned int rows)
+{
+	fseek(file, offsetof(BinaryHeader, rows), SEEK_SET);
+	fwrite(&rows, sizeof(unsigned int), 1, file);
+	fseek(file, 0L, SEEK_END);
+}
+
+/**
+ * \fn int binary_open(Binary *binary, char *name)
+ * \brief Function to open a binary results file mapping it in memory.
+ *
+ * If the number of rows of a series file is not written, because the file is
+ * being written or the simulation was interrupted, the complete rows are read.
+ * \param binary
+ * \brief binary struct.
+ * \param name
+ * \brief file name.
+ * \return 0 on error, 1 on success.
+ */
+int binary_open(Binary *binary, char *name)
+{
+	size_t offset;
+	BinaryHeader *header;
+#ifdef _WIN32
+	FILE *file;
+	binary->header = NULL;
+	file = fopen(name, "rb");
+	if (!file) return 0;
+	fseek(file, 0L, SEEK_END);
+	binary->size = ftell(file);
+	rewind(file);
+	if (binary->size < sizeof(BinaryHeader)) goto bad;
+	binary->header = (BinaryHeader*)malloc(binary->size);
+	if (!binary->header
+		|| fread(binary->header, binary->size, 1, file) != 1) goto bad;
+	fclose(file);
+#else
+	int file;
+	struct stat status;
+	binary->header = NULL;
+	file = open(name, O_RDONLY);
+	if (file < 0) return 0;
+	if (fstat(file, &status) || status.st_size < sizeof(BinaryHeader))
+	{
+		close(file);
+		return 0;
+	}
+	binary->size = status.st_size;
+	binary->header = (BinaryHeader*)
+		mmap(NULL, binary->size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (binary->header == MAP_FAILED)
+	{
+		binary->header = NULL;
+		return 0;
+	}
+#endif
+	header = binary->header;
+	if (memcmp(header->magic, BINARY_MAGIC, 8)
+		|| header->version != BINARY_VERSION || header->size != sizeof(double))
+		goto bad2;
+	offset = sizeof(BinaryHeader) + header->columns * BINARY_NAME_LENGTH;
+	if (binary->size < offset) goto bad2;
+	binary->name = (char(*)[BINARY_NAME_LENGTH])((char*)header
+		+ sizeof(BinaryHeader));
+	binary->value = (double*)((char*)header + offset);
+	binary->rows = header->rows;
+	if (!binary->rows && !header->columnar && header->columns)
+		binary->rows = (binary->size - offset)
+			/ (header->columns * sizeof(double));
+	if (binary->size < offset
+		+ (size_t)binary->rows * header->columns * sizeof(double))
+		goto bad2;
+	return 1;
+
+#ifdef _WIN32
+bad:
+	fclose(file);
+#endif
+bad2:
+	binary_close(binary);
+	return 0;
+}
+
+/**
+ * \fn double binary_value(Binary *binary, unsigned int row, \
+ *   unsigned int column)
+ * \brief Function to get a value of a binary results file.
+ * \param binary
+ * \brief binary struct.
+ * \param row
+ * \brief row number.
+ * \param column
+ * \brief field number.
+ * \return value.
+ */
+double binary_value(Binary *binary, unsigned int row, unsigned int column)
+{
+	if (binary->header->columnar)
+		return binary->value[(size_t)column * binary->rows + row];
+	return binary->value[(size_t)row * binary->header->columns + column];
+}
+
+/**
+ * \fn int binary_field(Binary *binary, char *name)
+ * \brief Function to find a field of a binary results file by its name.
+ * \param binary
+ * \brief binary struct.
+ * \param name
+ * \brief field name.
+ * \return field number, -1 if not found.
+ */
+int binary_field(Binary *binary, char *name)
+{
+	unsigned int i;
+	for (i = 0; i < binary->header->columns; ++i)
+		if (!strncmp(binary->name[i], name, BINARY_NAME_LENGTH)) return i;
+	return -1;
+}
+
+/**
+ * \fn void binary_close(Binary *binary)
+ * \brief Function to close a binary results file.
+ * \param binary
+ * \brief binary struct.
+ */
+void binary_close(Binary *binary)
+{
+	if (!binary->header) return;
+#ifdef _WIN32
+	free(binary->header);
+#else
+	munmap(binary->header, binary->size);
+#endif
+	binary->header = NULL;
+}
@@ -0,0 +1,130 @@
+/*
+SWOCS: a software to check the numerical performance of different models in
+	channel or furrow flows
+
+Copyright 2011-2014, Javier Burguete Tolosa.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Javier Burguete Tolosa ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL Javier Burguete Tolosa OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/**
+ * \file binary.h
+ * \brief Header file to define the binary results files.
+ * \author Javier Burguete Tolosa.
+ * \copyright Copyright 2011-2014, Javier Burguete Tolosa.
+ */
+
+// in order to prevent multiple definitions
+#ifndef BINARY__H
+#define BINARY__H 1
+
+/**
+ * \def BINARY_MAGIC
+ * \brief identifier of the binary results files.
+ * \def BINARY_VERSION
+ * \brief version of the binary results files format.
+ * \def BINARY_NAME_LENGTH
+ * \brief length of the field names.
+ */
+#define BINARY_MAGIC "SWOCSBIN"
+#define BINARY_VERSION 1
+#define BINARY_NAME_LENGTH 16
+
+/**
+ * \struct _BinaryHeader
+ * \brief Struct to define the header of a binary results file.
+ *
+ * The header is followed by the field names, with BINARY_NAME_LENGTH
+ * characters each one, and by the values, as a matrix of doubles stored by
+ * columns (columnar files) or by rows (series files, where the rows are
+ * appended while the simulation advances). The header and the names lengths
+ * are multiple of the double size, so the values can be mapped in memory.
+ */
+struct _BinaryHeader
+{
+/**
+ * \var magic
+ * \brief file identifier (BINARY_MAGIC).
+ * \var version
+ * \brief format version (BINARY_VERSION).
+ * \var size
+ * \brief size of a value in bytes (dtype).
+ * \var columnar
+ * \brief 1 on values stored by columns, 0 on values stored by rows.
+ * \var columns
+ * \brief number of fields.
+ * \var rows
+ * \brief number of values by field.
+ * \var reserved
+ * \brief reserved for future use.
+ */
+	char magic[8];
+	unsigned int version, size, columnar, columns, rows, reserved;
+};
+
+/**
+ * \typedef BinaryHeader
+ */
+typedef struct _BinaryHeader BinaryHeader;
+
+/**
+ * \struct _Binary
+ * \brief Struct to define a binary results file mapped in memory.
+ */
+struct _Binary
+{
+/**
+ * \var header
+ * \brief pointer to the file header.
+ * \var name
+ * \brief array of field names.
+ * \var value
+ * \brief array of values.
+ * \var size
+ * \brief file size.
+ * \var rows
+ * \brief number of values by field.
+ */
+	BinaryHeader *header;
+	char (*name)[BINARY_NAME_LENGTH];
+	double *value;
+	size_t size;
+	unsigned int rows;
+};
+
+/**
+ * \typedef Binary
+ */
+typedef struct _Binary Binary;
+
+// member functions
+
+int binary_name(char *name);
+int binary_write_header(FILE *file, unsigned int columnar,
+	unsigned int columns, unsigned int rows, char **name);
+void binary_write_rows(FILE *file, unsigned int rows);
+int binary_open(Binary *binary, char *name);
+double binary_value(Binary *binary, unsigned int row, unsigned int column);
+int binary_field(Binary *binary, char *name);
+void binary_close(Binary *binary);
+
+#endif
@@ -0,0 +1,166 @@
+/*
+SWOCS: a software to check the numerical performance of different models in
+	channel or furrow flows
+
+Copyright 2011-2014, Javier Burguete Tolosa.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Javier Burguete Tolosa ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL Javier Burguete Tolosa OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/**
+ * \file block.c
+ * \brief Source file to define the block solver of the implicit numerical
+ *   schemes.
+ *
+ * The upwind implicit schemes solve, in every node, a 3x3 system with the
+ * matrix \f$I_i^{-1} = \Delta x_i + J_i\f$, being \f$J_i\f$ the implicit
+ * operator scaled by the time step size. The operators have the structure
+ * \f$\left(\begin{array}{ccc}a&b&0\\c&d&0\\e&f&g\end{array}\right)\f$. The
+ * systems are factorized once per iteration, storing the inverted matrices in
+ * contiguous arrays, and the forward and backward sweeps only multiply by them.
+ * \author Javier Burguete Tolosa.
+ * \copyright Copyright 2011-2014, Javier Burguete Tolosa.
+ */
+#include "block.h"
+
+/**
+ * \fn void block_multiply(double *m, double *v, double *r)
+ * \brief Function to multiply an implicit operator by a vector.
+ * \param m
+ * \brief multiplying implicit operator.
+ * \param v
+ * \brief vector to multiply.
+ * \param r
+ * \brief resulting vector.
+ */
+void block_multiply(double *m, double *v, double *r)
+{
+	r[0] = m[0] * v[0] + m[1] * v[1];
+	r[1] = m[3] * v[0] + m[4] * v[1];
+	r[2] = m[6] * v[0] + m[7] * v[1] + m[8] * v[2];
+}
+
+/**
+ * \fn void block_invert(double *m, double *i)
+ * \brief Function to invert an implicit operator.
+ * \param m
+ * \brief implicit operator to invert.
+ * \param i
+ * \brief invert operator.
+ */
+void block_invert(double *m, double *i)
+{
+	double d;
+	d = m[8] * (m[0] * m[4] - m[1] * m[3]);
+	i[0] = m[4] * m[8] / d;
+	i[3] = - m[3] * m[8] / d;
+	i[6] = (m[3] * m[7] - m[4] * m[6]) / d;
+	i[1] = - m[1] * m[8] / d;
+	i[4] = m[0] * m[8] / d;
+	i[7] = (m[1] * m[6] - m[0] * m[7]) / d;
+	i[2] = 0.;
+	i[5] = 0.;
+	i[8] = (m[0] * m[4] - m[1] * m[3]) / d;
+}
+
+/**
+ * \fn void block_factorize(double *J, double dx, double *I)
+ * \brief Function to factorize the system matrix of a node.
+ * \param J
+ * \brief implicit operator scaled by the time step size.
+ * \param dx
+ * \brief cell size.
+ * \param I
+ * \brief inverted system matrix.
+ */
+void block_factorize(double *J, double dx, double *I)
+{
+	unsigned int j;
+	double A[9];
+	for (j = 0; j < 9; ++j) A[j] = J[j];
+	A[0] += dx;
+	A[4] += dx;
+	A[8] += dx;
+	block_invert(A, I);
+}
+
+/**
+ * \fn void block_forward(double (*J)[9], double (*I)[9], double (*r)[3], \
+ *   double k, double (*x)[3], unsigned int n)
+ * \brief Function to make a forward sweep:
+ *   \f$x_i=I_i\left(J_{i-1}\,x_{i-1}-k\,r_{i-1}\right)\f$, \f$i=1,\cdots,n-1\f$.
+ * \param J
+ * \brief array of implicit operators scaled by the time step size.
+ * \param I
+ * \brief array of inverted system matrices.
+ * \param r
+ * \brief array of explicit flux differences (NULL if none).
+ * \param k
+ * \brief explicit flux differences coefficient.
+ * \param x
+ * \brief array of solution vectors, with the first one as input.
+ * \param n
+ * \brief number of nodes.
+ */
+void block_forward(double (*J)[9], double (*I)[9], double (*r)[3], double k,
+	double (*x)[3], unsigned int n)
+{
+	unsigned int i, j;
+	double D[3];
+	for (i = 0; ++i < n;)
+	{
+		block_multiply(J[i - 1], x[i - 1], D);
+		if (r) for (j = 0; j < 3; ++j) D[j] -= k * r[i - 1][j];
+		block_multiply(I[i], D, x[i]);
+	}
+}
+
+/**
+ * \fn void block_backward(double (*J)[9], double (*I)[9], double (*r)[3], \
+ *   double k, double (*x)[3], unsigned int n)
+ * \brief Function to make a backward sweep:
+ *   \f$x_i=I_i\left(J_{i+1}\,x_{i+1}-k\,r_i\right)\f$, \f$i=n-2,\cdots,0\f$.
+ * \param J
+ * \brief array of implicit operators scaled by the time step size.
+ * \param I
+ * \brief array of inverted system matrices.
+ * \param r
+ * \brief array of explicit flux differences (NULL if none).
+ * \param k
+ * \brief explicit flux differences coefficient.
+ * \param x
+ * \brief array of solution vectors, with the last one as input.
+ * \param n
+ * \brief number of nodes.
+ */
+void block_backward(double (*J)[9], double (*I)[9], double (*r)[3], double k,
+	double (*x)[3], unsigned int n)
+{
+	unsigned int i, j;
+	double D[3];
+	for (i = n - 1; i-- > 0;)
+	{
+		block_multiply(J[i + 1], x[i + 1], D);
+		if (r) for (j = 0; j < 3; ++j) D[j] -= k * r[i][j];
+		block_multiply(I[i], D, x[i]);
+	}
+}
@@ -1,133 +1,734 @@
-#include <stdlib.h>
+/*
+SWOCS: a software to check the numerical performance of different models in
+	channel or furrow flows
+
+Copyright 2011-2014, Javier Burguete Tolosa.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Javier Burguete Tolosa ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL Javier Burguete Tolosa OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/**
+ * \file calibrate.c
+ * \brief Source file to calibrate the friction and infiltration coefficients.
+ *
+ * The calibration cases are simulated in parallel in the same process. The
+ * errors of the advance, depth and concentration series are accumulated while
+ * simulating, comparing the simulated values with the reference series, and a
+ * Nelder-Mead optimizer searches the Manning and Kostiakov-Lewis coefficients
+ * minimizing the objective function.
+ * \author Javier Burguete Tolosa.
+ * \copyright Copyright 2011-2014, Javier Burguete Tolosa.
+ */
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
+#include "swocs.h"
+#include "calibrate.h"
+
+/**
+ * \fn int series_read(Series *series, FILE *file)
+ * \brief Function to read a reference series: the type, the probe, the
+ *   reference file name, the number of columns of the reference file, the
+ *   abscissa and value columns, the normalizing scale and the weight.
+ * \param series
+ * \brief series struct.
+ * \param file
+ * \brief calibration file.
+ * \return 0 on error, 1 on success.
+ */
+int series_read(Series *series, FILE *file)
+{
+	unsigned int i, columns, ix, iy;
+	char *name = NULL, *msg;
+	FILE *reference = NULL;
+	memset(series, 0, sizeof(Series));
+	if (fscanf(file, "%u%u%ms%u%u%u%lf%lf", &series->type, &series->probe,
+		&name, &columns, &ix, &iy, &series->scale, &series->weight) != 8
+		|| series->type < CALIBRATE_SERIES_ADVANCE
+		|| series->type > CALIBRATE_SERIES_CONCENTRATION
+		|| !ix || !iy || ix > columns || iy > columns
+		|| series->scale <= 0. || series->weight < 0.)
+	{
+		msg = "series: bad defined";
+		goto bad;
+	}
+	reference = fopen(name, "r");
+	if (!reference)
+	{
+		msg = "series: unable to open the reference file";
+		goto bad;
+	}
+	while (1)
+	{
+		double row[columns];
+		for (i = 0; i < columns; ++i)
+			if (fscanf(reference, "%lf", row + i) != 1) goto end;
+		series->x = (double*)realloc(series->x, (series->n + 1)
+			* sizeof(double));
+		series->f = (double*)realloc(series->f, (series->n + 1)
+			* sizeof(double));
+		if (!series->x || !series->f)
+		{
+			msg = "series: not enough memory";
+			goto bad;
+		}
+		series->x[series->n] = row[ix - 1];
+		series->f[series->n] = row[iy - 1];
+		if (series->n && series->x[series->n] < series->x[series->n - 1])
+		{
+			msg = "series: reference abscissas not increasing";
+			goto bad;
+		}
+		++series->n;
+	}
+
+end:
+	if (!series->n)
+	{
+		msg = "series: empty reference file";
+		goto bad;
+	}
+	fclose(reference);
+	free(name);
+	return 1;
+
+bad:
+	if (reference) fclose(reference);
+	free(name);
+	series_delete(series);
+	print_error(msg);
+	return 0;
+}
+
+/**
+ * \fn void series_delete(Series *series)
+ * \brief Function to free the memory used by a reference series.
+ * \param series
+ * \brief series struct.
+ */
+void series_delete(Series *series)
+{
+	free(series->x);
+	free(series->f);
+	series->x = series->f = NULL;
+	series->n = 0;
+}
+
+/**
+ * \fn void series_sample(Series *series, Error *error, double x, double f)
+ * \brief Function to compare a simulated sample with the reference points
+ *   reached, interpolating linearly from the last simulated sample.
+ * \param series
+ * \brief series struct.
+ * \param error
+ * \brief error struct.
+ * \param x
+ * \brief abscissa of the simulated sample.
+ * \param f
+ * \brief value of the simulated sample.
+ */
+void series_sample(Series *series, Error *error, double x, double f)
+{
+	double k;
+	for (; error->i < series->n && series->x[error->i] <= x; ++error->i)
+	{
+		if (error->samples && x > error->x)
+			k = interpolate(series->x[error->i], error->x, x, error->f, f);
+		else k = f;
+		k -= series->f[error->i];
+		error->sum += k * k;
+	}
+	error->x = x;
+	error->f = f;
+	error->samples = 1;
+}
+
+/**
+ * \fn double series_error(Series *series, Error *error)
+ * \brief Function to end the comparison of a series, using the last simulated
+ *   sample for the reference points not reached.
+ * \param series
+ * \brief series struct.
+ * \param error
+ * \brief error struct.
+ * \return root mean square error.
+ */
+double series_error(Series *series, Error *error)
+{
+	double k;
+	for (; error->i < series->n; ++error->i)
+	{
+		k = error->f - series->f[error->i];
+		error->sum += k * k;
+	}
+	return sqrt(error->sum / series->n);
+}
+
+/**
+ * \fn int case_read(Case *c, FILE *file)
+ * \brief Function to read a calibration case: the input data file name, the
+ *   probes file name ("-" without probes), the number of reference series and
+ *   the reference series.
+ * \param c
+ * \brief case struct.
+ * \param file
+ * \brief calibration file.
+ * \return 0 on error, 1 on success.
+ */
+int case_read(Case *c, FILE *file)
+{
+	unsigned int i;
+	long int size;
+	char *input = NULL, *probes = NULL, *msg;
+	FILE *data = NULL;
+	memset(c, 0, sizeof(Case));
+	if (fscanf(file, "%ms%ms%u", &input, &probes, &c->nseries) != 3)
+	{
+		msg = "case: bad defined";
+		goto bad;
+	}
+
+	// storing the input data file in memory
+	data = fopen(input, "rb");
+	if (!data || fseek(data, 0L, SEEK_END) || (size = ftell(data)) < 0L)
+	{
+		msg = "case: unable to read the input file";
+		goto bad;
+	}
+	rewind(data);
+	c->size = size;
+	c->data = (char*)malloc(c->size + 1);
+	if (!c->data)
+	{
+		msg = "case: not enough memory";
+		goto bad;
+	}
+	if (fread(c->data, 1, c->size, data) != c->size)
+	{
+		msg = "case: unable to read the input file";
+		goto bad;
+	}
+	fclose(data);
+
+	// reading the probes
+	data = NULL;
+	if (strcmp(probes, "-"))
+	{
+		data = fopen(probes, "r");
+		if (!data || fscanf(data, "%u", &c->nprobes) != 1)
+		{
+			msg = "case: unable to read the probes file";
+			goto bad;
+		}
+		c->probes = (double*)malloc(c->nprobes * sizeof(double));
+		if (c->nprobes && !c->probes)
+		{
+			msg = "case: not enough memory";
+			goto bad;
+		}
+		for (i = 0; i < c->nprobes; ++i)
+			if (fscanf(data, "%lf", c->probes + i) != 1)
+			{
+				msg = "case: bad probes file";
+				goto bad;
+			}
+		fclose(data);
+		data = NULL;
+	}
+
+	// reading the reference series
+	c->series = (Series*)calloc(c->nseries, sizeof(Series));
+	if (c->nseries && !c->series)
+	{
+		msg = "case: not enough memory";
+		goto bad;
+	}
+	for (i = 0; i < c->nseries; ++i)
+	{
+		if (!series_read(c->series + i, file)) goto bad2;
+		if (c->series[i].type != CALIBRATE_SERIES_ADVANCE
+			&& (!c->series[i].probe || c->series[i].probe > c->nprobes))
+		{
+			msg = "case: bad probe";
+			goto bad;
+		}
+	}
+	free(input);
+	free(probes);
+	return 1;
+
+bad:
+	print_error(msg);
+
+bad2:
+	if (data) fclose(data);
+	free(input);
+	free(probes);
+	case_delete(c);
+	return 0;
+}
+
+/**
+ * \fn void case_delete(Case *c)
+ * \brief Function to free the memory used by a calibration case.
+ * \param c
+ * \brief case struct.
+ */
+void case_delete(Case *c)
+{
+	unsigned int i;
+	if (c->series)
+		for (i = 0; i < c->nseries; ++i) series_delete(c->series + i);
+	free(c->series);
+	free(c->probes);
+	free(c->data);
+	c->series = NULL;
+	c->probes = NULL;
+	c->data = NULL;
+}
+
+/**
+ * \fn double case_error(Case *c, Calibration *calibration, double *parameters)
+ * \brief Function to simulate a calibration case with a set of parameters,
+ *   accumulating the errors of the reference series every time step.
+ * \param c
+ * \brief case struct.
+ * \param calibration
+ * \brief calibration struct.
+ * \param parameters
+ * \brief array of values of the calibrated parameters.
+ * \return sum of the weighted squared normalized errors (INFINITY on a failed
+ *   or stalled simulation).
+ */
+double case_error(Case *c, Calibration *calibration, double *parameters)
+{
+	int wet;
+	unsigned int i, j, stall;
+	double e, k, h[c->nprobes + 1], s[c->nprobes + 1];
+	Error error[c->nseries + 1];
+	Series *series;
+	Model model[1];
+
+	// opening the model with the calibrated parameters
+	if (!model_read_memory(model, c->data, c->size)) goto bad;
+	for (i = 0; i < calibration->nparameters; ++i)
+	{
+		j = calibration->type[i];
+		if (j == CALIBRATE_PARAMETER_FRICTION)
+			model->channel->friction_coefficient[0] = parameters[i];
+		else
+			model->channel->infiltration_coefficient
+				[j - CALIBRATE_PARAMETER_INFILTRATION] = parameters[i];
+	}
+	if (!model_init(model) || !model_probes_set(model, c->nprobes, c->probes))
+		goto bad;
 
-#define PESO_AVANCE 0.5
-#define PESO_CALADO 0.1
-#define PESO_CONCENTRACION 0.1
+	// simulating and comparing the samples of every time step
+	memset(error, 0, sizeof(error));
+	for (stall = 0; stall < CALIBRATE_STALL_STEPS;)
+	{
+		model_probes_values(model, h, s);
+		for (i = 0; i < c->nseries; ++i)
+		{
+			series = c->series + i;
+			switch (series->type)
+			{
+			case CALIBRATE_SERIES_ADVANCE:
+				wet = model->mesh->wet;
+				if (wet < 0) wet = 0;
+				series_sample(series, error + i, model->mesh->node[wet].x,
+					model->t);
+				break;
+			case CALIBRATE_SERIES_DEPTH:
+				series_sample(series, error + i, model->t,
+					h[series->probe - 1]);
+				break;
+			default:
+				series_sample(series, error + i, model->t,
+					s[series->probe - 1]);
+			}
+		}
+		if (model->t >= model->tfinal) break;
+		model_step(model);
+		if (model->dt < CALIBRATE_MINIMUM_DT * model->tfinal) ++stall;
+	}
+	if (stall == CALIBRATE_STALL_STEPS) goto bad;
+	model_delete(model);
+
+	// weighting the normalized errors
+	e = 0.;
+	for (i = 0; i < c->nseries; ++i)
+	{
+		series = c->series + i;
+		k = series_error(series, error + i) / series->scale;
+		e += series->weight * k * k;
+	}
+	if (isnan(e)) e = INFINITY;
+	return e;
+
+bad:
+	model_delete(model);
+	return INFINITY;
+}
 
-double file_mean_square_error
-	(char *namea,int ixa,int ifa,int na,char *namer,int ixr,int ifr,int nr)
+/**
+ * \fn int calibration_read(Calibration *calibration, char *name)
+ * \brief Function to read a calibration file.
+ *
+ * The calibration file contains the number of cases, the cases (see case_read
+ *   and series_read), the number of calibrated parameters, the type (1 Manning
+ *   coefficient, 2 to 5 Kostiakov-Lewis coefficients), the initial, minimum and
+ *   maximum values of every parameter and, with calibrated parameters, the
+ *   maximum number of iterations and the relative tolerance of the optimizer.
+ * \param calibration
+ * \brief calibration struct.
+ * \param name
+ * \brief calibration file name.
+ * \return 0 on error, 1 on success.
+ */
+int calibration_read(Calibration *calibration, char *name)
 {
-	int i,j,endr;
-	double k,k2,xa,fa,xr1,fr1,xr2,fr2,aa[na],ar[nr];
-	FILE *filea,*filer;
-	endr=i=0;
-	k=0.;
-	filea=fopen(namea,"r");
-	if (!filea) goto exit_mse;
-	filer=fopen(namer,"r");
-	if (!filer) goto exit_mse;
-	for (j=0; j<nr; ++j)
-		if (fscanf(filer,"%lf",ar+j)!=1) goto exit_mse;
-	xr1=ar[ixr-1];
-	fr1=ar[ifr-1];
-	for (j=0; j<nr; ++j)
-		if (fscanf(filer,"%lf",ar+j)!=1) endr=1;
-	xr2=ar[ixr-1];
-	fr2=ar[ifr-1];
-	for (i=0; !endr; ++i)
-	{
-		for (j=0; j<na; ++j)
-			if (fscanf(filea,"%lf",aa+j)!=1) goto exit_mse;
-		xa=aa[ixa-1];
-		fa=aa[ifa-1];
-		while (xa>xr2)
+	unsigned int i, n;
+	char *msg;
+	FILE *file;
+	memset(calibration, 0, sizeof(Calibration));
+	file = fopen(name, "r");
+	if (!file)
+	{
+		msg = "calibration: unable to open the file";
+		goto bad2;
+	}
+
+	// reading the cases
+	if (fscanf(file, "%u", &calibration->ncases) != 1 || !calibration->ncases)
+	{
+		msg = "calibration: bad cases number";
+		goto bad;
+	}
+	calibration->cases = (Case*)calloc(calibration->ncases, sizeof(Case));
+	if (!calibration->cases)
+	{
+		msg = "calibration: not enough memory";
+		goto bad;
+	}
+	for (i = 0; i < calibration->ncases; ++i)
+		if (!case_read(calibration->cases + i, file)) goto bad3;
+
+	// reading the calibrated parameters
+	if (fscanf(file, "%u", &n) != 1)
+	{
+		msg = "calibration: bad parameters number";
+		goto bad;
+	}
+	calibration->type = (unsigned int*)malloc(n * sizeof(unsigned int));
+	calibration->initial = (double*)malloc(3 * n * sizeof(double));
+	if (n && (!calibration->type || !calibration->initial))
+	{
+		msg = "calibration: not enough memory";
+		goto bad;
+	}
+	calibration->minimum = calibration->initial + n;
+	calibration->maximum = calibration->minimum + n;
+	calibration->nparameters = n;
+	for (i = 0; i < n; ++i)
+		if (fscanf(file, "%u%lf%lf%lf", calibration->type + i,
+			calibration->initial + i, calibration->minimum + i,
+			calibration->maximum + i) != 4
+			|| calibration->type[i] < CALIBRATE_PARAMETER_FRICTION
+			|| calibration->type[i] > CALIBRATE_PARAMETER_TYPES
+			|| calibration->minimum[i] > calibration->initial[i]
+			|| calibration->initial[i] > calibration->maximum[i])
 		{
-			xr1=xr2;
-			fr1=fr2;
-			for (j=0; j<nr; ++j) if (fscanf(filer,"%lf",ar+j)!=1)
+			msg = "calibration: bad parameter";
+			goto bad;
+		}
+	if (n && (fscanf(file, "%u%lf", &calibration->iterations,
+		&calibration->tolerance) != 2 || calibration->tolerance < 0.))
+	{
+		msg = "calibration: bad optimizer parameters";
+		goto bad;
+	}
+	fclose(file);
+	return 1;
+
+bad:
+	print_error(msg);
+
+bad3:
+	fclose(file);
+	calibration_delete(calibration);
+	return 0;
+
+bad2:
+	print_error(msg);
+	return 0;
+}
+
+/**
+ * \fn void calibration_delete(Calibration *calibration)
+ * \brief Function to free the memory used by a calibration.
+ * \param calibration
+ * \brief calibration struct.
+ */
+void calibration_delete(Calibration *calibration)
+{
+	unsigned int i;
+	if (calibration->cases)
+		for (i = 0; i < calibration->ncases; ++i)
+			case_delete(calibration->cases + i);
+	free(calibration->cases);
+	free(calibration->initial);
+	free(calibration->type);
+}
+
+/**
+ * \fn void calibration_evaluate(Calibration *calibration, unsigned int n, \
+ *   double *parameters, double *objective)
+ * \brief Function to evaluate the objective function for some sets of
+ *   parameters, simulating all the cases of all the sets in parallel.
+ * \param calibration
+ * \brief calibration struct.
+ * \param n
+ * \brief number of sets of parameters.
+ * \param parameters
+ * \brief array of sets of parameters.
+ * \param objective
+ * \brief array of values of the objective function.
+ */
+void calibration_evaluate(Calibration *calibration, unsigned int n,
+	double *parameters, double *objective)
+{
+	unsigned int i, j, ncases, nparameters;
+	ncases = calibration->ncases;
+	nparameters = calibration->nparameters;
+	double error[n * ncases];
+#pragma omp parallel for schedule(dynamic) if(n * ncases > 1)
+	for (i = 0; i < n * ncases; ++i)
+		error[i] = case_error(calibration->cases + i % ncases, calibration,
+			parameters + (i / ncases) * nparameters);
+	for (i = 0; i < n; ++i)
+	{
+		objective[i] = 0.;
+		for (j = 0; j < ncases; ++j) objective[i] += error[i * ncases + j];
+		objective[i] = sqrt(objective[i] / ncases);
+	}
+	calibration->evaluations += n;
+}
+
+/**
+ * \fn void calibration_bound(Calibration *calibration, double *x)
+ * \brief Function to bound a set of parameters in the allowed ranges.
+ * \param calibration
+ * \brief calibration struct.
+ * \param x
+ * \brief array of parameters.
+ */
+static void calibration_bound(Calibration *calibration, double *x)
+{
+	unsigned int i;
+	for (i = 0; i < calibration->nparameters; ++i)
+		x[i] = fmin(calibration->maximum[i],
+			fmax(calibration->minimum[i], x[i]));
+}
+
+/**
+ * \fn void calibration_point(Calibration *calibration, double *x, \
+ *   double *centroid, double *vertex, double coefficient)
+ * \brief Function to calculate a bounded point of the line joining the
+ *   centroid and a vertex of the simplex.
+ * \param calibration
+ * \brief calibration struct.
+ * \param x
+ * \brief array of parameters of the point.
+ * \param centroid
+ * \brief array of parameters of the centroid.
+ * \param vertex
+ * \brief array of parameters of the vertex.
+ * \param coefficient
+ * \brief position of the point (0 centroid, 1 vertex).
+ */
+static void calibration_point(Calibration *calibration, double *x,
+	double *centroid, double *vertex, double coefficient)
+{
+	unsigned int i;
+	for (i = 0; i < calibration->nparameters; ++i)
+		x[i] = centroid[i] + coefficient * (vertex[i] - centroid[i]);
+	calibration_bound(calibration, x);
+}
+
+/**
+ * \fn void calibration_optimize(Calibration *calibration, double *parameters, \
+ *   double *objective)
+ * \brief Function to search the parameters minimizing the objective function
+ *   with the Nelder-Mead method, bounding the points in the allowed ranges.
+ * \param calibration
+ * \brief calibration struct.
+ * \param parameters
+ * \brief array of optimal parameters.
+ * \param objective
+ * \brief optimal value of the objective function.
+ */
+void calibration_optimize(Calibration *calibration, double *parameters,
+	double *objective)
+{
+	unsigned int i, j, k, n, iteration;
+	double d;
+	n = calibration->nparameters;
+	double x[(n + 1) * n], f[n + 1], xo[n], xr[n], xc[n], fr, fc, t[n];
+
+	// initial simplex
+	for (i = 0; i <= n; ++i)
+		memcpy(x + i * n, calibration->initial, n * sizeof(double));
+	for (i = 0; i < n; ++i)
+	{
+		d = CALIBRATE_SIMPLEX_SIZE
+			* (calibration->maximum[i] - calibration->minimum[i]);
+		if (x[i] + d > calibration->maximum[i]) d = -d;
+		x[(i + 1) * n + i] += d;
+	}
+	calibration_evaluate(calibration, n + 1, x, f);
+
+	for (iteration = 0; ; ++iteration)
+	{
+		// sorting the vertices by the objective function
+		for (i = 1; i <= n; ++i)
+			for (j = i; j > 0 && f[j] < f[j - 1]; --j)
+			{
+				memcpy(t, x + j * n, n * sizeof(double));
+				memcpy(x + j * n, x + (j - 1) * n, n * sizeof(double));
+				memcpy(x + (j - 1) * n, t, n * sizeof(double));
+				d = f[j];
+				f[j] = f[j - 1];
+				f[j - 1] = d;
+			}
+		printf("calibrate: iteration=%u evaluations=%u objective=%.14lg",
+			iteration, calibration->evaluations, f[0]);
+		for (i = 0; i < n; ++i) printf(" %.14lg", x[i]);
+		printf("\n");
+		if (iteration == calibration->iterations
+			|| f[n] - f[0] <= calibration->tolerance * fabs(f[0]))
+			break;
+
+		// centroid of the best vertices
+		for (i = 0; i < n; ++i)
+		{
+			xo[i] = 0.;
+			for (j = 0; j < n; ++j) xo[i] += x[j * n + i];
+			xo[i] /= n;
+		}
+
+		// reflection
+		calibration_point(calibration, xr, xo, x + n * n, -1.);
+		calibration_evaluate(calibration, 1, xr, &fr);
+		if (fr < f[0])
+		{
+			// expansion
+			calibration_point(calibration, xc, xo, x + n * n, -2.);
+			calibration_evaluate(calibration, 1, xc, &fc);
+			if (fc < fr)
+			{
+				memcpy(x + n * n, xc, n * sizeof(double));
+				f[n] = fc;
+			}
+			else
 			{
-				endr=1;
-				goto end_filer;
+				memcpy(x + n * n, xr, n * sizeof(double));
+				f[n] = fr;
 			}
-			xr2=ar[ixr-1];
-			fr2=ar[ifr-1];
+			continue;
+		}
+		if (fr < f[n - 1])
+		{
+			memcpy(x + n * n, xr, n * sizeof(double));
+			f[n] = fr;
+			continue;
+		}
+
+		// outside or inside contraction
+		if (fr < f[n])
+		{
+			calibration_point(calibration, xc, xo, xr, 0.5);
+			calibration_evaluate(calibration, 1, xc, &fc);
+			k = (fc <= fr);
+		}
+		else
+		{
+			calibration_point(calibration, xc, xo, x + n * n, 0.5);
+			calibration_evaluate(calibration, 1, xc, &fc);
+			k = (fc < f[n]);
+		}
+		if (k)
+		{
+			memcpy(x + n * n, xc, n * sizeof(double));
+			f[n] = fc;
+			continue;
 		}
-end_filer:
-		if (!endr && xa>xr1)
-			k2=fa-fr1-(xa-xr1)*(fr2-fr1)/(xr2-xr1);
-		else k2=fa-fr1;
-		k+=k2*k2;
-	}
-	for (; 1; ++i)
-	{
-		for (j=0; j<na; ++j)
-			if (fscanf(filea,"%lf",aa+j)!=1) goto exit_mse;
-		xa=aa[ixa-1];
-		fa=aa[ifa-1];
-		k2=fa-fr1;
-		k+=k2*k2;
-	}
-exit_mse:
-	if (i==0) return 0.;
-	return sqrt(k/i);
+
+		// shrink towards the best vertex
+		for (i = 1; i <= n; ++i)
+			calibration_point(calibration, x + i * n, x, x + i * n, 0.5);
+		calibration_evaluate(calibration, n, x + n, f + 1);
+	}
+	memcpy(parameters, x, n * sizeof(double));
+	*objective = f[0];
 }
 
+/**
+ * \fn int main(int argn, char **argc)
+ * \brief Main function.
+ */
 int main(int argn, char **argc)
 {
-	int i,j;
-	double etotal,e[4][6];
-
-	// simulamos los 4 casos
-	system("./script_nery");
-
-	// errores en avance
-	e[0][0]=file_mean_square_error("nery/q1a",1,2,2,"nery/advances1.out",2,1,2);
-	e[1][0]=file_mean_square_error("nery/q2a",1,2,2,"nery/advances2.out",2,1,2);
-	e[2][0]=file_mean_square_error("nery/q3a",1,2,2,"nery/advances3.out",2,1,2);
-	e[3][0]=file_mean_square_error("nery/q4a",1,2,2,"nery/advances4.out",2,1,2);
-
-	// errores en calados aguas arriba
-	e[0][1]=file_mean_square_error("nery/h1",1,2,2,"nery/probes1.out",1,2,11);
-	e[1][1]=file_mean_square_error("nery/h2",1,2,2,"nery/probes2.out",1,2,11);
-	e[2][1]=file_mean_square_error("nery/h3",1,2,2,"nery/probes3.out",1,2,11);
-	e[3][1]=file_mean_square_error("nery/h4",1,2,2,"nery/probes4.out",1,2,11);
-
-	// errores en sondas de concentración
-	e[0][2]=file_mean_square_error("nery/q1c1",1,3,3,"nery/probes1.out",1,5,11);
-	e[1][2]=file_mean_square_error("nery/q2c1",1,3,3,"nery/probes2.out",1,5,11);
-	e[2][2]=file_mean_square_error("nery/q3c1",1,3,3,"nery/probes3.out",1,5,11);
-	e[3][2]=file_mean_square_error("nery/q4c1",1,3,3,"nery/probes4.out",1,5,11);
-	e[0][3]=file_mean_square_error("nery/q1c2",1,3,3,"nery/probes1.out",1,7,11);
-	e[1][3]=file_mean_square_error("nery/q2c2",1,3,3,"nery/probes2.out",1,7,11);
-	e[2][3]=file_mean_square_error("nery/q3c2",1,3,3,"nery/probes3.out",1,7,11);
-	e[3][3]=file_mean_square_error("nery/q4c2",1,3,3,"nery/probes4.out",1,7,11);
-	e[0][4]=file_mean_square_error("nery/q1c3",1,3,3,"nery/probes1.out",1,9,11);
-	e[1][4]=file_mean_square_error("nery/q2c3",1,3,3,"nery/probes2.out",1,9,11);
-	e[2][4]=file_mean_square_error("nery/q3c3",1,3,3,"nery/probes3.out",1,9,11);
-	e[3][4]=file_mean_square_error("nery/q4c3",1,3,3,"nery/probes4.out",1,9,11);
-	e[0][5]=file_mean_square_error("nery/q1c4",1,3,3,"nery/probes1.out",1,11,11);
-	e[1][5]=file_mean_square_error("nery/q2c4",1,3,3,"nery/probes2.out",1,11,11);
-	e[2][5]=file_mean_square_error("nery/q3c4",1,3,3,"nery/probes3.out",1,11,11);
-	e[3][5]=file_mean_square_error("nery/q4c4",1,3,3,"nery/probes4.out",1,11,11);
-
-	// normalizamos avances
-	double a[4]={2747.,1874.,1280.,978.};
-	for (i=0; i<4; ++i) e[i][0]/=a[i];
-
-	// normalizamos calados
-	double h[4]={0.0744,0.0703,0.111,0.0998};
-	for (i=0; i<4; ++i) e[i][1]/=h[i];
-
-	// normalizamos concentraciones
-	for (j=2; j<6; ++j)
-		for (i=0; i<4; ++i) e[i][j]/=10.6;
+	unsigned int i;
+	double objective;
+	Calibration calibration[1];
+	if (argn != 2)
+	{
+		printf("The syntax is:\n./calibrate calibration_file\n");
+		return 1;
+	}
+	if (!calibration_read(calibration, argc[1])) return 2;
+	double parameters[calibration->nparameters + 1];
 
-/*
-for (j=0; j<6; ++j)
-	for (i=0; i<4; ++i)
-		printf("i=%d j=%d e=%lg\n",i,j,e[i][j]);
-*/
+	// evaluating the objective function without calibrated parameters
+	if (!calibration->nparameters)
+	{
+		calibration_evaluate(calibration, 1, parameters, &objective);
+		printf("%lg\n", objective);
+	}
 
-	// pesamos los errores
-	etotal=0.;
-	for (i=0; i<4; ++i) etotal+=PESO_AVANCE*e[i][0]*e[i][0];
-	for (i=0; i<4; ++i) etotal+=PESO_CALADO*e[i][1]*e[i][1];
-	for (j=2; j<6; ++j)
-		for (i=0; i<4; ++i) etotal+=PESO_CONCENTRACION*e[i][j]*e[i][j];
+	// calibrating the parameters
+	else
+	{
+		calibration_optimize(calibration, parameters, &objective);
+		printf("calibrate: evaluations=%u objective=%.14lg parameters=",
+			calibration->evaluations, objective);
+		for (i = 0; i < calibration->nparameters; ++i)
+			printf(" %.14lg", parameters[i]);
+		printf("\n");
+	}
 
-	// escribimos en pantalla
-	printf("%lg\n",sqrt(etotal/4.));
+	calibration_delete(calibration);
 	return 0;
 }
@@ -0,0 +1,231 @@
+/*
+SWOCS: a software to check the numerical performance of different models in
+	channel or furrow flows
+
+Copyright 2011-2014, Javier Burguete Tolosa.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Javier Burguete Tolosa ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL Javier Burguete Tolosa OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/**
+ * \file calibrate.h
+ * \brief Header file to define the calibration of the friction and
+ *   infiltration coefficients.
+ * \author Javier Burguete Tolosa.
+ * \copyright Copyright 2011-2014, Javier Burguete Tolosa.
+ */
+
+// in order to prevent multiple definitions
+#ifndef CALIBRATE__H
+#define CALIBRATE__H 1
+
+/**
+ * \def CALIBRATE_SERIES_ADVANCE
+ * \brief series of advance times (reference abscissa: position, value: time).
+ * \def CALIBRATE_SERIES_DEPTH
+ * \brief series of depths at a probe (reference abscissa: time).
+ * \def CALIBRATE_SERIES_CONCENTRATION
+ * \brief series of solute concentrations at a probe (reference abscissa:
+ *   time).
+ */
+#define CALIBRATE_SERIES_ADVANCE 1
+#define CALIBRATE_SERIES_DEPTH 2
+#define CALIBRATE_SERIES_CONCENTRATION 3
+
+/**
+ * \def CALIBRATE_PARAMETER_FRICTION
+ * \brief Manning coefficient.
+ * \def CALIBRATE_PARAMETER_INFILTRATION
+ * \brief first Kostiakov-Lewis coefficient (the other three follow it).
+ * \def CALIBRATE_PARAMETER_TYPES
+ * \brief number of types of calibrated parameters.
+ */
+#define CALIBRATE_PARAMETER_FRICTION 1
+#define CALIBRATE_PARAMETER_INFILTRATION 2
+#define CALIBRATE_PARAMETER_TYPES 5
+
+/**
+ * \def CALIBRATE_SIMPLEX_SIZE
+ * \brief initial size of the Nelder-Mead simplex relative to the range of the
+ *   parameters.
+ */
+#define CALIBRATE_SIMPLEX_SIZE 0.25
+
+/**
+ * \def CALIBRATE_MINIMUM_DT
+ * \brief minimum time step size relative to the final time of a case.
+ * \def CALIBRATE_STALL_STEPS
+ * \brief number of time steps smaller than the minimum stopping a stalled
+ *   simulation as failed.
+ */
+#define CALIBRATE_MINIMUM_DT 1e-9
+#define CALIBRATE_STALL_STEPS 1000
+
+/**
+ * \struct _Series
+ * \brief Struct to define a reference series compared with the simulation.
+ */
+struct _Series
+{
+/**
+ * \var x
+ * \brief array of abscissas of the reference points (increasing).
+ * \var f
+ * \brief array of values of the reference points.
+ * \var scale
+ * \brief value normalizing the root mean square error.
+ * \var weight
+ * \brief weight of the normalized squared error in the objective function.
+ * \var n
+ * \brief number of reference points.
+ * \var type
+ * \brief type of series (CALIBRATE_SERIES_* macros).
+ * \var probe
+ * \brief index of the probe (not used in advance series).
+ */
+	double *x, *f, scale, weight;
+	unsigned int n, type, probe;
+};
+
+/**
+ * \typedef Series
+ */
+typedef struct _Series Series;
+
+/**
+ * \struct _Error
+ * \brief Struct to accumulate the error of a series while simulating.
+ */
+struct _Error
+{
+/**
+ * \var x
+ * \brief abscissa of the last simulated sample.
+ * \var f
+ * \brief value of the last simulated sample.
+ * \var sum
+ * \brief sum of the squared errors.
+ * \var i
+ * \brief next reference point to compare.
+ * \var samples
+ * \brief 1 if a simulated sample has been stored, 0 else.
+ */
+	double x, f, sum;
+	unsigned int i, samples;
+};
+
+/**
+ * \typedef Error
+ */
+typedef struct _Error Error;
+
+/**
+ * \struct _Case
+ * \brief Struct to define a calibration case.
+ */
+struct _Case
+{
+/**
+ * \var data
+ * \brief buffer with the input data file.
+ * \var probes
+ * \brief array of x-coordinates of the probes.
+ * \var series
+ * \brief array of reference series.
+ * \var size
+ * \brief size of the input data buffer.
+ * \var nprobes
+ * \brief number of probes.
+ * \var nseries
+ * \brief number of reference series.
+ */
+	char *data;
+	double *probes;
+	Series *series;
+	size_t size;
+	unsigned int nprobes, nseries;
+};
+
+/**
+ * \typedef Case
+ */
+typedef struct _Case Case;
+
+/**
+ * \struct _Calibration
+ * \brief Struct to define a calibration of the friction and infiltration
+ *   coefficients.
+ */
+struct _Calibration
+{
+/**
+ * \var cases
+ * \brief array of calibration cases.
+ * \var initial
+ * \brief array of initial values of the parameters.
+ * \var minimum
+ * \brief array of minimum values of the parameters.
+ * \var maximum
+ * \brief array of maximum values of the parameters.
+ * \var tolerance
+ * \brief relative tolerance of the objective function to stop the optimizer.
+ * \var type
+ * \brief array of types of parameters (CALIBRATE_PARAMETER_* macros).
+ * \var ncases
+ * \brief number of cases.
+ * \var nparameters
+ * \brief number of calibrated parameters.
+ * \var iterations
+ * \brief maximum number of iterations of the optimizer.
+ * \var evaluations
+ * \brief number of evaluations of the objective function.
+ */
+	Case *cases;
+	double *initial, *minimum, *maximum, tolerance;
+	unsigned int *type, ncases, nparameters, iterations, evaluations;
+};
+
+/**
+ * \typedef Calibration
+ */
+typedef struct _Calibration Calibration;
+
+// member functions
+
+int series_read(Series *series, FILE *file);
+void series_delete(Series *series);
+void series_sample(Series *series, Error *error, double x, double f);
+double series_error(Series *series, Error *error);
+
+int case_read(Case *c, FILE *file);
+void case_delete(Case *c);
+double case_error(Case *c, Calibration *calibration, double *parameters);
+
+int calibration_read(Calibration *calibration, char *name);
+void calibration_delete(Calibration *calibration);
+void calibration_evaluate(Calibration *calibration, unsigned int n,
+	double *parameters, double *objective);
+void calibration_optimize(Calibration *calibration, double *parameters,
+	double *objective);
+
+#endif
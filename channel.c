@@ -97,7 +97,8 @@ int hydrogram_read(Hydrogram *hydrogram, FILE *file)
 #endif
 	hydrogram->t = (double*)malloc(hydrogram->n * sizeof(double));
 	hydrogram->Q = (double*)malloc(hydrogram->n * sizeof(double));
-	if (!hydrogram->t || !hydrogram->Q)
+	hydrogram->V = (double*)malloc(hydrogram->n * sizeof(double));
+	if (!hydrogram->t || !hydrogram->Q || !hydrogram->V)
 	{
 		msg = "hydrogram: not enough memory";
 		goto bad;
@@ -113,6 +114,14 @@ int hydrogram_read(Hydrogram *hydrogram, FILE *file)
 		printf("hydrogram: t=%lg Q=%lg\n", hydrogram->t[i], hydrogram->Q[i]);
 #endif
 	}
+
+	// cumulative volumes
+	hydrogram->V[0] = 0.;
+	for (i = 0; ++i < hydrogram->n;)
+		hydrogram->V[i] = hydrogram->V[i - 1] + 0.5
+			* (hydrogram->Q[i] + hydrogram->Q[i - 1])
+			* (hydrogram->t[i] - hydrogram->t[i - 1]);
+	hydrogram->i = 0;
 	return 1;
 
 bad:
@@ -120,6 +129,38 @@ bad:
 	return 0;
 }
 
+/**
+ * \fn void hydrogram_delete(Hydrogram *hydrogram)
+ * \brief Function to free the memory used by a hydrogram.
+ * \param hydrogram
+ * \brief hydrogram struct.
+ */
+void hydrogram_delete(Hydrogram *hydrogram)
+{
+	free(hydrogram->t);
+	free(hydrogram->Q);
+	free(hydrogram->V);
+}
+
+/**
+ * \fn unsigned int hydrogram_search(Hydrogram *hydrogram, double t)
+ * \brief Function to search the first point of a hydrogram with a time
+ *   greater or equal than a time, moving the cursor from the last search.
+ * \param hydrogram
+ * \brief hydrogram struct.
+ * \param t
+ * \brief time.
+ * \return point number (number of points if t is greater than all times).
+ */
+unsigned int hydrogram_search(Hydrogram *hydrogram, double t)
+{
+	unsigned int i;
+	i = hydrogram->i;
+	while (i > 0 && t <= hydrogram->t[i - 1]) --i;
+	while (i < hydrogram->n && t > hydrogram->t[i]) ++i;
+	return hydrogram->i = i;
+}
+
 /**
  * \fn double hydrogram_discharge(Hydrogram *hydrogram, double t)
  * \brief Function to calculate the discharge in a hydrogram.
@@ -135,7 +176,7 @@ double hydrogram_discharge(Hydrogram *hydrogram, double t)
 	n1 = hydrogram->n - 1;
 	if (n1 == 0 || t <= hydrogram->t[0]) return hydrogram->Q[0];
 	if (t >= hydrogram->t[n1]) return hydrogram->Q[n1];
-	for (i = 0; t > hydrogram->t[i];) ++i;
+	i = hydrogram_search(hydrogram, t);
 	return interpolate(t, hydrogram->t[i], hydrogram->t[i - 1],
 		hydrogram->Q[i], hydrogram->Q[i - 1]);
 }
@@ -158,8 +199,8 @@ double hydrogram_integrate(Hydrogram *hydrogram, double t1, double t2)
 	n1 = hydrogram->n - 1;
 	if (n1 == 0 || t2 <= hydrogram->t[0]) return hydrogram->Q[0] * (t2 - t1);
 	if (t1 >= hydrogram->t[n1]) return hydrogram->Q[n1] * (t2 - t1);
-	for (i = 0; t1 > hydrogram->t[i];) ++i;
-	for (j = i; j < hydrogram->n && t2 > hydrogram->t[j];) ++j;
+	i = hydrogram_search(hydrogram, t1);
+	j = hydrogram_search(hydrogram, t2);
 	if (i == j)
 	{
 		Q1 = interpolate(t1, hydrogram->t[i], hydrogram->t[i - 1],
@@ -178,21 +219,20 @@ double hydrogram_integrate(Hydrogram *hydrogram, double t1, double t2)
 			hydrogram->Q[i], hydrogram->Q[i - 1]);
 	}
 	I = 0.5 * (Q1 + hydrogram->Q[i]) * (hydrogram->t[i] - t1);
-	while (++i < j)
-	{
-		I += 0.5 * (hydrogram->Q[i] - hydrogram->Q[i - 1])
-			* (hydrogram->t[i] - hydrogram->t[i - 1]);
-	}
-	if (i == hydrogram->n)
+
+	// complete intervals from the cumulative volumes
+	I += hydrogram->V[j - 1] - hydrogram->V[i];
+
+	if (j == hydrogram->n)
 	{
 		Q2 = hydrogram->Q[n1];
 	}
 	else
 	{
-		Q2 = interpolate(t2, hydrogram->t[i], hydrogram->t[i - 1],
-			hydrogram->Q[i], hydrogram->Q[i - 1]);
+		Q2 = interpolate(t2, hydrogram->t[j], hydrogram->t[j - 1],
+			hydrogram->Q[j], hydrogram->Q[j - 1]);
 	}
-	return I + 0.5 * (Q2 + hydrogram->Q[i - 1]) * (t2 - hydrogram->t[i - 1]);
+	return I + 0.5 * (Q2 + hydrogram->Q[j - 1]) * (t2 - hydrogram->t[j - 1]);
 }
 
 /**
@@ -262,6 +302,21 @@ bad:
 	return 0;
 }
 
+/**
+ * \fn void geometry_delete(Geometry *geometry)
+ * \brief Function to free the memory used by a channel geometry.
+ * \param geometry
+ * \brief channel geometry struct.
+ */
+void geometry_delete(Geometry *geometry)
+{
+	free(geometry->x);
+	free(geometry->zb);
+	free(geometry->B0);
+	free(geometry->Z);
+	free(geometry->zmax);
+}
+
 /**
  * \fn int channel_friction_read_Manning(Channel *channel, FILE *file)
  * \brief Function to read the friction coefficient of the Manning model.
@@ -441,3 +496,16 @@ bad:
 	print_error(msg);
 	return 0;
 }
+
+/**
+ * \fn void channel_delete(Channel *channel)
+ * \brief Function to free the memory used by a channel.
+ * \param channel
+ * \brief channel struct.
+ */
+void channel_delete(Channel *channel)
+{
+	geometry_delete(channel->geometry);
+	hydrogram_delete(channel->water_inlet);
+	hydrogram_delete(channel->solute_inlet);
+}
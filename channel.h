@@ -48,11 +48,16 @@ struct _Hydrogram
  * \brief array of times.
  * \var Q
  * \brief array of discharges.
+ * \var V
+ * \brief array of cumulative volumes from the first point.
  * \var n
  * \brief number of points defining the hydrogram.
+ * \var i
+ * \brief cursor: first point with a time greater or equal than the last
+ *   searched time.
  */
-	double *t, *Q;
-	unsigned int n;
+	double *t, *Q, *V;
+	unsigned int n, i;
 };
 
 /**
@@ -141,14 +146,18 @@ void print_error(char *msg);
 double interpolate(double x, double x1, double x2, double y1, double y2);
 
 int hydrogram_read(Hydrogram *hydrogram, FILE *file);
+void hydrogram_delete(Hydrogram *hydrogram);
+unsigned int hydrogram_search(Hydrogram *hydrogram, double t);
 double hydrogram_discharge(Hydrogram *hydrogram, double t);
 double hydrogram_integrate(Hydrogram *hydrogram, double t1, double t2);
 
 int geometry_read(Geometry *geometry, FILE *file);
+void geometry_delete(Geometry *geometry);
 
 int channel_friction_read_Manning(Channel *channel, FILE *file);
 int channel_infiltration_read_KostiakovLewis(Channel *channel, FILE *file);
 int channel_diffusion_read_Rutherford(Channel *channel, FILE *file);
 int channel_read(Channel *channel,FILE *file);
+void channel_delete(Channel *channel);
 
 #endif
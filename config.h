@@ -43,4 +43,68 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #define G 9.81
 
+/**
+ * \def CRITICAL_DEPTH_TOLERANCE
+ * \brief Default relative accuracy calculating the critical depth.
+ */
+#define CRITICAL_DEPTH_TOLERANCE 1e-6
+
+/**
+ * \def FAST_POWERS
+ * \brief 1 to calculate the 4/3 and 2/3 powers of the friction models with a
+ *   fast cube root (relative error lower than 1e-14), 0 to use the mathematical
+ *   library.
+ */
+#define FAST_POWERS 0
+
+/**
+ * \def SPECIALIZED_KERNELS
+ * \brief 1 to calculate the node parameters and the allowed time step size
+ *   with loops specialized for every model type and friction model, allowing
+ *   the compiler to inline the full node pipeline, 0 to call the model
+ *   functions through pointers.
+ */
+#define SPECIALIZED_KERNELS 0
+
+/**
+ * \def PARALLEL_MINIMUM_NODES
+ * \brief Minimum number of mesh nodes to calculate the loops in parallel.
+ */
+#define PARALLEL_MINIMUM_NODES 10000
+
+/**
+ * \def MULTIRATE_MAXIMUM_LEVELS
+ * \brief Maximum number of time step levels of the local time stepping allowed
+ *   in the input data file.
+ */
+#define MULTIRATE_MAXIMUM_LEVELS 10
+
+/**
+ * \def RUNGE_KUTTA_ORDER
+ * \brief Order of the strong stability preserving Runge-Kutta time
+ *   integration of the explicit upwind and TVD schemes of the hydrodynamic
+ *   model (1 forward Euler, 2 or 3).
+ */
+#define RUNGE_KUTTA_ORDER 1
+
+/**
+ * \def ACTIVE_MARGIN
+ * \brief Number of dry nodes after the last wet node in the active window of
+ *   the mesh with the explicit schemes. The implicit schemes add two nodes by
+ *   iteration.
+ */
+#define ACTIVE_MARGIN 4
+
+/**
+ * \def REFINEMENT_MAXIMUM_LEVELS
+ * \brief Maximum number of refinement levels of an adaptive mesh.
+ */
+#define REFINEMENT_MAXIMUM_LEVELS 12
+
+/**
+ * \def OUTPUT_RECORDS
+ * \brief Number of records of each block of the advance and probes writer.
+ */
+#define OUTPUT_RECORDS 1024
+
 #endif
@@ -0,0 +1,141 @@
+#!/bin/sh
+# Check of the fast powers of the friction models (FAST_POWERS in config.h).
+#
+# The syntax is:
+#   sh fast-powers.sh [report_file]
+# The sources are built with FAST_POWERS 1 and 0 in a temporary directory. The
+# maximum relative errors of the fast cube root and of the 4/3, -4/3 and 2/3
+# powers against the mathematical library are checked on numbers spread over
+# the double precision range (the 2/3 power, square of the cube root, doubles
+# the cube root error). Then the bundled cases are simulated with both
+# executables and the maximum difference of the output variables, relative to
+# the maximum absolute value of every file, is checked. The report contains a
+# row by function and by case. The exit status is 0 if every check passes, 1
+# if any check fails and 2 on build errors.
+#
+# Environment variables:
+#   FAST_POWERS_CASES: input files of the cases.
+#   FAST_POWERS_ERROR: maximum relative error of the cube root.
+#   FAST_POWERS_TOLERANCE: maximum relative difference of the output variables.
+#   FAST_POWERS_TIMEOUT: maximum time of a simulation in seconds.
+
+report=${1:-fast-powers.txt}
+cases=${FAST_POWERS_CASES:-"dambreak/i-1-1-1-0.1-10 dambreak/i-2-1-1-0.1-10
+	rankine-hugoniot/case1-1-1 rankine-hugoniot/case1-1-3
+	normal-gaussian/case1-1-1 normal-gaussian/case1-1-3
+	normal-gaussian/case1-1-4 normal-sinusoidal/case1-1-1
+	normal-sinusoidal/case2-1-1 normal-sinusoidal/case3-1-1
+	normal-sinusoidal/case4-1-1 normal-rankine-hugoniot/case1-1-1
+	normal-rankine-hugoniot/case1-1-3 normal-rankine-hugoniot/case1-4-1"}
+error=${FAST_POWERS_ERROR:-1e-14}
+tolerance=${FAST_POWERS_TOLERANCE:-1e-9}
+timeout=${FAST_POWERS_TIMEOUT:-600}
+
+run=
+if command -v timeout > /dev/null 2>&1; then run="timeout $timeout"; fi
+dir=$(mktemp -d "${TMPDIR:-/tmp}/swocs-fast-powers.XXXXXX") || exit 2
+trap 'rm -rf "$dir"' EXIT
+trap 'exit 2' INT TERM
+
+# building the library and the executable with FAST_POWERS 1 and 0
+for fast in 1 0; do
+	mkdir "$dir/$fast"
+	cp ./*.c ./*.h makefile "$dir/$fast" || exit 2
+	sed "s/^#define FAST_POWERS .*/#define FAST_POWERS $fast/" config.h \
+		> "$dir/$fast/config.h"
+	if ! make -C "$dir/$fast" swocs lib > "$dir/build" 2>&1; then
+		cat "$dir/build"
+		echo "fast-powers: unable to build with FAST_POWERS $fast"
+		exit 2
+	fi
+done
+
+# relative errors of the fast functions, the references calculated with long
+# double precision from the cube root of the mathematical library
+cat > "$dir/error.c" << 'EOF'
+#include <math.h>
+#include "swocs.h"
+
+static double error(double y, long double r)
+{
+	return fabsl((y - r) / r);
+}
+
+int main()
+{
+	int e;
+	unsigned int i, seed = 1;
+	double x, m, e1 = 0., e2 = 0., e3 = 0., e4 = 0.;
+	long double c;
+	for (e = -700; e <= 700; ++e)
+		for (i = 0; i < 1000; ++i)
+		{
+			seed = 1103515245 * seed + 12345;
+			m = 1. + (seed >> 8) / 16777216.;
+			x = ldexp(m, e);
+			c = cbrtl(x);
+			e1 = fmax(e1, error(node_cbrt(x), c));
+			e2 = fmax(e2, error(node_power_4_3(x), x * c));
+			e3 = fmax(e3, error(node_power_m4_3(x), 1.L / (x * c)));
+			e4 = fmax(e4, error(node_power_2_3(x), c * c));
+		}
+	printf("node_cbrt %.3e 1\nnode_power_4_3 %.3e 1\n", e1, e2);
+	printf("node_power_m4_3 %.3e 1\nnode_power_2_3 %.3e 2\n", e3, e4);
+	return 0;
+}
+EOF
+if ! gcc -O2 -flto -fopenmp -I"$dir/1" "$dir/error.c" "$dir/1/libswocs.a" \
+	-lm -o "$dir/error" > "$dir/build" 2>&1; then
+	cat "$dir/build"
+	echo "fast-powers: unable to build the error check"
+	exit 2
+fi
+
+status=0
+{
+	echo "# SWOCS fast powers check $(date -u '+%Y-%m-%d %H:%M:%S UTC')"
+	echo "# version: $(git rev-parse --short HEAD 2> /dev/null || echo unknown)"
+	echo "# maximum error: $error, tolerance: $tolerance"
+	printf "%-40s %10s %6s\n" "#function/case" "error" "check"
+} > "$report"
+cat "$report"
+
+"$dir/error" | awk -v m="$error" '{
+	printf "%-40s %10.3e %6s\n", $1, $2, ($2 <= $3 * m) ? "ok" : "failed"
+}' | tee -a "$report"
+
+for case in $cases; do
+	if [ ! -f "$case" ]; then
+		echo "fast-powers: unable to find the case $case"
+		continue
+	fi
+	for fast in 1 0; do
+		rm -f "$dir/variables-$fast"
+		OMP_NUM_THREADS=1 $run "$dir/$fast/swocs" "$case" \
+			"$dir/variables-$fast" > /dev/null 2>&1
+	done
+	if [ -s "$dir/variables-1" ] && [ -s "$dir/variables-0" ]; then
+		paste "$dir/variables-1" "$dir/variables-0" \
+			| awk -v case="$case" -v m="$tolerance" '
+			{
+				n = NF / 2
+				for (i = 1; i <= n; ++i)
+				{
+					d = $i - $(i + n)
+					if (d < 0) d = -d
+					if (d > dmax) dmax = d
+					a = ($(i + n) < 0) ? -$(i + n) : $(i + n)
+					if (a > amax) amax = a
+				}
+			}
+			END {
+				e = (amax > 0) ? dmax / amax : dmax
+				printf "%-40s %10.3e %6s\n", case, e, (e <= m) ? "ok" : "failed"
+			}'
+	else
+		printf "%-40s %10s %6s\n" "$case" "-" "failed"
+	fi | tee -a "$report"
+done
+
+grep -q "failed$" "$report" && status=1
+exit $status
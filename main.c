@@ -33,268 +33,486 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  * \copyright Copyright 2011-2014, Javier Burguete Tolosa.
  */
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <time.h>
-#include "config.h"
-#include "channel.h"
-#include "node.h"
-#include "mesh.h"
-#include "model.h"
-#include "model_hydrodynamic.h"
-#include "model_zero_advection.h"
-#include "model_zero_inertia.h"
-#include "model_kinematic.h"
-#include "model_hydrodynamic_upwind.h"
-#include "model_zero_advection_upwind.h"
-#include "model_zero_inertia_upwind.h"
-#include "model_kinematic_upwind.h"
-#include "model_hydrodynamic_LaxFriedrichs.h"
-#include "model_zero_advection_LaxFriedrichs.h"
-//#include "model_zero_inertia_LaxFriedrichs.h"
-//#include "model_kinematic_LaxFriedrichs.h"
-#include "model_hydrodynamic_implicit.h"
-#include "model_zero_advection_implicit.h"
-#include "model_zero_inertia_implicit.h"
-#include "model_kinematic_implicit.h"
-#include "model_hydrodynamic_tvd.h"
+#include <signal.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "swocs.h"
 
 /**
- * \var critical_depth_tolerance
- * \brief Accuracy calculating the critical depth.
+ * \def main_clock
+ * \brief Macro to get the time in seconds to measure the calculation time (the
+ *   wall time in the shared-memory parallel mode because the processor time
+ *   adds the times of all threads).
  */
-double critical_depth_tolerance = 0.001;
+#ifdef _OPENMP
+#define main_clock() omp_get_wtime()
+#else
+#define main_clock() (clock() / ((double)CLOCKS_PER_SEC))
+#endif
 
 /**
- * \fn int main(int argn, char **argc)
- * \brief Main function
+ * \def MANIFEST_LINE_LENGTH
+ * \brief Maximum length of a line in a batch manifest file.
  */
-int main(int argn, char **argc)
-{
-	unsigned int i;
-	FILE *file, *file_advance, *file_probes;
-	clock_t cpu;
-	Model model[1];
-	if (argn < 3 || argn == 6 || argn > 7)
-	{
-		printf("The syntax is:\n./SWOCS input_file "
-			"output_variables_file "
-			"[output_flows_file] [output_advance_file]"
-			"[input_probes_file output_probes_file]\n");
-		return 1;
-	}
-
-	if (!model_read(model, argc[1])) return 2;
+#define MANIFEST_LINE_LENGTH 4096
 
-	model->theta = 1.;
+/**
+ * \var main_signal
+ * \brief last signal received asking for a checkpoint (0 if none).
+ */
+static volatile sig_atomic_t main_signal = 0;
 
-	switch (model->type_model)
-	{
-	case 1:
-		model->model_node_parameters_centre
-			= model->model_node_parameters_right
-			= model->model_node_parameters_left
-			= model_node_parameters_hydrodynamic;
-		model->node_1dt_max = node_1dt_max_hydrodynamic;
-		model->model_inlet_dtmax = model_inlet_dtmax_hydrodynamic;
-		goto hydrodynamic;
-	case 2:
-		model->model_node_parameters_centre
-			= model->model_node_parameters_right
-			= model->model_node_parameters_left
-			= model_node_parameters_zero_advection;
-		model->node_1dt_max = node_1dt_max_zero_advection;
-		model->model_inlet_dtmax = model_inlet_dtmax_zero_advection;
-		goto zero_advection;
-	case 3:
-		model->node_discharge_centre = node_discharge_centre_zero_inertia;
-		model->node_discharge_right = node_discharge_right_zero_inertia;
-		model->node_discharge_left = node_discharge_left_zero_inertia;
-		model->model_node_parameters_centre
-			= model_node_parameters_centre_zero_inertia;
-		model->model_node_parameters_right
-			= model_node_parameters_right_zero_inertia;
-		model->model_node_parameters_left
-			= model_node_parameters_left_zero_inertia;
-		model->node_1dt_max = node_1dt_max_zero_inertia;
-		model->model_inlet_dtmax = model_inlet_dtmax_zero_inertia;
-		goto zero_inertia;
-	case 4:
-		model->node_discharge_centre = node_discharge_centre_kinematic;
-		model->node_discharge_right = node_discharge_right_kinematic;
-		model->node_discharge_left = node_discharge_left_kinematic;
-		model->model_node_parameters_centre
-			= model_node_parameters_centre_kinematic;
-		model->model_node_parameters_right
-			= model_node_parameters_right_kinematic;
-		model->model_node_parameters_left
-			= model_node_parameters_left_kinematic;
-		model->node_1dt_max = node_1dt_max_kinematic;
-		model->model_inlet_dtmax = model_inlet_dtmax_kinematic;
-		goto kinematic;
-	default:
-		printf("model: bad type (%u)\n", model->type_model);
-		return 2;
-	}
+/**
+ * \fn void main_signal_handler(int sig)
+ * \brief Function to handle the signals asking for a checkpoint: SIGUSR1 to
+ *   write a checkpoint and to continue, SIGINT or SIGTERM to write a checkpoint
+ *   and to stop the simulation.
+ * \param sig
+ * \brief signal number.
+ */
+static void main_signal_handler(int sig)
+{
+	main_signal = sig;
+}
 
-hydrodynamic:
-	switch (model->type_surface_flow)
+/**
+ * \fn FILE* main_series_open(char *name, char *restart)
+ * \brief Function to open an advance or probes series file.
+ *
+ * On a restarted simulation the former file is opened to be continued: a text
+ * file in append mode and a binary file in update mode, because the number of
+ * rows of the header is rewritten.
+ * \param name
+ * \brief file name.
+ * \param restart
+ * \brief checkpoint file name to restart the simulation (NULL to start from
+ *   the initial conditions).
+ * \return file pointer, NULL on error.
+ */
+static FILE* main_series_open(char *name, char *restart)
+{
+	FILE *file;
+	if (binary_name(name))
 	{
-	case 1:
-		model->model_surface_flow = model_surface_flow_hydrodynamic_upwind;
-		goto calculate;
-	case 2:
-		model->model_surface_flow =
-			model_surface_flow_hydrodynamic_LaxFriedrichs;
-		goto calculate;
-	case 3:
-		model->model_surface_flow = model_surface_flow_hydrodynamic_implicit;
-		goto calculate;
-	case 4:
-		model->model_surface_flow = model_surface_flow_hydrodynamic_tvd;
-		goto calculate;
-	default:
-		printf("model: bad surface flow type\n");
-		return 2;
+		if (restart && (file = fopen(name, "r+b"))) return file;
+		return fopen(name, "wb");
 	}
+	return fopen(name, restart ? "a+" : "w");
+}
 
-zero_advection:
-	switch (model->type_surface_flow)
-	{
-	case 1:
-		model->model_surface_flow = model_surface_flow_zero_advection_upwind;
-		goto calculate;
-	case 2:
-		model->model_surface_flow =
-			model_surface_flow_zero_advection_LaxFriedrichs;
-		goto calculate;
-	case 3:
-		model->model_surface_flow = model_surface_flow_zero_advection_implicit;
-		goto calculate;
-	default:
-		printf("model: bad surface flow type\n");
-		return 2;
-	}
+/**
+ * \fn int main_case(int argn, char **argc, unsigned int batch, \
+ *   char *checkpoint, double checkpoint_interval, char *restart, \
+ *   char *profile_file, unsigned int profile_sample, unsigned int steps)
+ * \brief Function to simulate a case.
+ * \param argn
+ * \brief number of case arguments.
+ * \param argc
+ * \brief array of case arguments, with the same meaning than the main
+ *   function arguments.
+ * \param batch
+ * \brief 1 on a batch simulation, 0 else.
+ * \param checkpoint
+ * \brief checkpoint file name (NULL without checkpoints).
+ * \param checkpoint_interval
+ * \brief time interval between checkpoints (only on signals if not positive).
+ * \param restart
+ * \brief checkpoint file name to restart the simulation (NULL to start from
+ *   the initial conditions).
+ * \param profile_file
+ * \brief profile file name (NULL without instrumentation).
+ * \param profile_sample
+ * \brief number of time steps between profile samples (0 to write only the
+ *   summary).
+ * \param steps
+ * \brief maximum number of time steps (0 to simulate until the final time).
+ * \return 0 on success, 2 on error.
+ */
+int main_case(int argn, char **argc, unsigned int batch, char *checkpoint,
+	double checkpoint_interval, char *restart, char *profile_file,
+	unsigned int profile_sample, unsigned int steps)
+{
+	unsigned int i;
+	FILE *file, *file_advance, *file_probes, *file_profile = NULL;
+	double cpu, checkpoint_time, t0;
+	Model model[1];
+	Output output[1];
+	Profile profile[1];
 
-zero_inertia:
-	switch (model->type_surface_flow)
-	{
-	case 1:
-		model->model_surface_flow = model_surface_flow_zero_inertia_upwind;
-		break;
-//	case 2:
-//		model->model_surface_flow = model_surface_flow_zero_inertia_LaxFriedrichs;
-//		break;
-	case 3:
-		model->model_surface_flow = model_surface_flow_zero_inertia_implicit;
-		model->node_1dt_max = node_1dt_max_hydrodynamic;
-		goto calculate;
-	default:
-		printf("model: bad surface flow type\n");
-		return 2;
-	}
+	if (!model_open(model, argc[1])) goto bad;
 
-kinematic:
-	switch (model->type_surface_flow)
-	{
-	case 1:
-		model->model_surface_flow = model_surface_flow_kinematic_upwind;
-		break;
-//	case 2:
-//		model->model_surface_flow = model_surface_flow_kinematic_LaxFriedrichs;
-//		break;
-	case 3:
-		model->model_surface_flow = model_surface_flow_kinematic_implicit;
-		goto calculate;
-	default:
-		printf("model: bad surface flow type\n");
-		return 2;
-	}
-
-calculate:
-	switch (model->type_diffusion)
-	{
-	case 1:
-		model->model_diffusion = model_diffusion_explicit;
-		break;
-	case 2:
-		model->model_diffusion = model_diffusion_implicit;
-		break;
-	default:
-		printf("model: bad diffusion type\n");
-		return 2;
-	}
+	// restoring the model state
+	if (restart && !model_checkpoint_read(model, restart)) goto bad;
+	checkpoint_time = model->t + checkpoint_interval;
 
 	if (argn > 4)
 	{
-		// opening the advance file
-		file_advance = fopen(argc[4], "w");
+		// opening the advance file, continuing it on a restart
+		file_advance = main_series_open(argc[4], restart);
+		if (!file_advance)
+		{
+			printf("model: unable to open the advance output file\n");
+			goto bad;
+		}
 
+		file_probes = NULL;
 		if (argn > 6)
 		{
 			// opening the probes files
-			if (!model_probes_read(model, argc[5])) return 2;
-			file_probes = fopen(argc[6], "w");
+			if (!model_probes_read(model, argc[5]))
+			{
+				fclose(file_advance);
+				goto bad;
+			}
+			file_probes = main_series_open(argc[6], restart);
 			if (!file_probes)
 			{
 				printf("model: unable to open the probes output file\n");
-				return 2;
+				fclose(file_advance);
+				goto bad;
 			}
 		}
+
+		// starting the advance and probes writer
+		if (!output_open(output, model, file_advance, binary_name(argc[4]),
+			file_probes, argn > 6 && binary_name(argc[6]), restart != NULL))
+		{
+			fclose(file_advance);
+			if (file_probes) fclose(file_probes);
+			goto bad;
+		}
 	}
 
-	// reset the clock
-	cpu = clock();
+	// starting the instrumentation
+	if (profile_file)
+	{
+		file_profile = fopen(profile_file, "w");
+		if (!file_profile)
+		{
+			print_error("profile: unable to open the file");
+			goto bad_output;
+		}
+		if (!profile_open(profile, model, file_profile, profile_sample))
+		{
+			fclose(file_profile);
+			goto bad_output;
+		}
+	}
 
-	// init model parameters
-	model_parameters(model);
+	// reset the clock
+	cpu = main_clock();
 
 	// main calculation bucle
-	for (model->t = 0, i = 0; model->t < model->tfinal; ++i)
+	for (i = 0; model->t < model->tfinal && (!steps || i < steps); ++i)
 	{
+		// storing the advance and the probes
 		if (argn > 4)
 		{
-			// writing the advance
-			model_write_advance(model, file_advance);
-
-			// writing the probes
-			if (argn > 6) model_write_probes(model, file_probes);
+			if (file_profile) t0 = profile_clock();
+			output_push(output, model);
+			if (file_profile) profile_phase(profile, PROFILE_PHASE_OUTPUT, t0);
 		}
 
 		// model step
 		model_step(model);
 //		model_print(model, i);
+
+		// stopping the simulation on a signal
+		if (!checkpoint) continue;
+#ifdef SIGUSR1
+		if (main_signal && main_signal != SIGUSR1)
+#else
+		if (main_signal)
+#endif
+		{
+			++i;
+			break;
+		}
+
+		// writing a checkpoint
+		if (main_signal
+			|| (checkpoint_interval > 0. && model->t >= checkpoint_time))
+		{
+			model_checkpoint_write(model, checkpoint);
+			if (checkpoint_interval > 0.)
+				checkpoint_time = checkpoint_interval
+					* (floor(model->t / checkpoint_interval) + 1.);
+			main_signal = 0;
+		}
 	}
 
+	// writing the final checkpoint
+	if (checkpoint) model_checkpoint_write(model, checkpoint);
+
 	// printing main results
-	printf("cpu=%lg ", (clock() - cpu) / ((double)CLOCKS_PER_SEC));
-	model_print(model, i);
+	cpu = main_clock() - cpu;
+#pragma omp critical(main_print)
+	{
+		if (batch) printf("%s: ", argc[1]);
+		printf("cpu=%lg ", cpu);
+		model_print(model, i);
+	}
 
 	// writing result variables
-	file = fopen(argc[2], "w");
-	mesh_write_variables(model->mesh, file);
+	file = fopen(argc[2], binary_name(argc[2]) ? "wb" : "w");
+	if (!file)
+	{
+		print_error("model: unable to open the variables output file");
+		goto bad_profile;
+	}
+	if (binary_name(argc[2])) mesh_write_variables_binary(model->mesh, file);
+	else mesh_write_variables(model->mesh, file);
 	fclose(file);
 
 	// writing result flows
 	if (argn > 3)
 	{
-		file = fopen(argc[3], "w");
-		mesh_write_flows(model->mesh, file);
+		file = fopen(argc[3], binary_name(argc[3]) ? "wb" : "w");
+		if (!file)
+		{
+			print_error("model: unable to open the flows output file");
+			goto bad_profile;
+		}
+		if (binary_name(argc[3])) mesh_write_flows_binary(model->mesh, file);
+		else mesh_write_flows(model->mesh, file);
 		fclose(file);
 
 		if (argn > 4)
 		{
-			// closing the advance
-			model_write_advance(model, file_advance);
+			// closing the advance and the probes
+			if (file_profile) t0 = profile_clock();
+			output_close(output, model);
+			if (file_profile) profile_phase(profile, PROFILE_PHASE_OUTPUT, t0);
 			fclose(file_advance);
+			if (file_probes) fclose(file_probes);
+		}
+	}
 
-			if (argn > 6)
+	// writing the profile summary
+	if (file_profile)
+	{
+		profile_close(profile, model);
+		fclose(file_profile);
+	}
+
+	model_delete(model);
+	return 0;
+
+bad_profile:
+	if (file_profile)
+	{
+		profile_close(profile, model);
+		fclose(file_profile);
+	}
+
+bad_output:
+	if (argn > 4)
+	{
+		output_close(output, model);
+		fclose(file_advance);
+		if (file_probes) fclose(file_probes);
+	}
+
+bad:
+	model_delete(model);
+	return 2;
+}
+
+/**
+ * \fn static void main_batch_free(int *case_argn, char ***case_argc, \
+ *   unsigned int n)
+ * \brief Function to free the arguments of the cases of a batch.
+ * \param case_argn
+ * \brief array of numbers of case arguments.
+ * \param case_argc
+ * \brief array of arrays of case arguments.
+ * \param n
+ * \brief number of cases.
+ */
+static void main_batch_free(int *case_argn, char ***case_argc, unsigned int n)
+{
+	unsigned int i;
+	for (i = 0; i < n; ++i)
+	{
+		while (--case_argn[i] > 0) free(case_argc[i][case_argn[i]]);
+		free(case_argc[i]);
+	}
+	free(case_argc);
+	free(case_argn);
+}
+
+/**
+ * \fn int main_batch(char *name)
+ * \brief Function to simulate a batch of cases defined in a manifest file.
+ *
+ * Every non empty line of the manifest file, excepting the comment lines
+ * beginning with '#', defines a case with the same files than the command line
+ * of a single simulation: input_file output_variables_file [output_flows_file]
+ * [output_advance_file] [input_probes_file output_probes_file]. The cases are
+ * dynamically distributed between the threads, each one simulating its own
+ * model.
+ * \param name
+ * \brief manifest file name.
+ * \return 0 on success, 2 on error.
+ */
+int main_batch(char *name)
+{
+	unsigned int i, n, nerrors;
+	int *case_argn, *argn;
+	char *buffer, *token, *msg, **argc, ***case_argc;
+	void *p;
+	FILE *file;
+	double cpu;
+
+	n = nerrors = 0;
+	case_argn = NULL;
+	case_argc = NULL;
+	buffer = (char*)malloc(MANIFEST_LINE_LENGTH);
+	file = fopen(name, "r");
+	if (!buffer || !file)
+	{
+		msg = "batch: unable to open the manifest file";
+		goto bad;
+	}
+	while (fgets(buffer, MANIFEST_LINE_LENGTH, file))
+	{
+		token = strtok(buffer, " \t\r\n");
+		if (!token || token[0] == '#') continue;
+		// the arrays are updated only on success to free them on errors
+		p = realloc(case_argn, (n + 1) * sizeof(int));
+		if (p)
+		{
+			case_argn = (int*)p;
+			p = realloc(case_argc, (n + 1) * sizeof(char**));
+		}
+		if (!p)
+		{
+			msg = "batch: not enough memory";
+			goto bad;
+		}
+		case_argc = (char***)p;
+		argc = case_argc[n] = (char**)malloc(7 * sizeof(char*));
+		if (!argc)
+		{
+			msg = "batch: not enough memory";
+			goto bad;
+		}
+		argc[0] = name;
+		argn = case_argn + n++;
+		for (*argn = i = 1; token; token = strtok(NULL, " \t\r\n"))
+		{
+			if (i == 7)
+			{
+				msg = "batch: bad case";
+				goto bad;
+			}
+			argc[i] = strdup(token);
+			if (!argc[i])
 			{
-				// closing the probes
-				model_write_probes(model, file_probes);
-				fclose(file_probes);
+				msg = "batch: not enough memory";
+				goto bad;
 			}
+			*argn = ++i;
+		}
+		if (i < 3 || i == 6)
+		{
+			msg = "batch: bad case";
+			goto bad;
 		}
 	}
+	fclose(file);
+	free(buffer);
 
-	return 0;
+	cpu = main_clock();
+#pragma omp parallel for schedule(dynamic) reduction(+:nerrors)
+	for (i = 0; i < n; ++i)
+		if (main_case(case_argn[i], case_argc[i], 1, NULL, 0., NULL, NULL, 0,
+			0))
+			++nerrors;
+	printf("batch: cases=%u errors=%u cpu=%lg\n",
+		n, nerrors, main_clock() - cpu);
+
+	main_batch_free(case_argn, case_argc, n);
+	return nerrors ? 2 : 0;
+
+bad:
+	if (file) fclose(file);
+	free(buffer);
+	main_batch_free(case_argn, case_argc, n);
+	print_error(msg);
+	return 2;
+}
+
+/**
+ * \fn int main(int argn, char **argc)
+ * \brief Main function
+ */
+int main(int argn, char **argc)
+{
+	char *checkpoint = NULL, *restart = NULL, *profile_file = NULL;
+	double checkpoint_interval = 0.;
+	unsigned int profile_sample = 0, steps = 0;
+	if (argn == 3 && !strcmp(argc[1], "-b")) return main_batch(argc[2]);
+
+	// reading the checkpoint, profile and steps options
+	while (argn > 1 && argc[1][0] == '-')
+	{
+		if (argn > 3 && !strcmp(argc[1], "-c"))
+		{
+			checkpoint = argc[2];
+			checkpoint_interval = atof(argc[3]);
+			argc += 3;
+			argn -= 3;
+		}
+		else if (argn > 2 && !strcmp(argc[1], "-r"))
+		{
+			restart = argc[2];
+			argc += 2;
+			argn -= 2;
+		}
+		else if (argn > 2 && !strcmp(argc[1], "-s"))
+		{
+			steps = atoi(argc[2]);
+			argc += 2;
+			argn -= 2;
+		}
+		else if (argn > 3 && !strcmp(argc[1], "-p"))
+		{
+			profile_file = argc[2];
+			profile_sample = atoi(argc[3]);
+			argc += 3;
+			argn -= 3;
+		}
+		else break;
+	}
+
+	if (argn < 3 || argn == 6 || argn > 7 || argc[1][0] == '-')
+	{
+		printf("The syntax is:\n./SWOCS [-c checkpoint_file checkpoint_interval] "
+			"[-r restart_file] [-p profile_file profile_sample_steps] "
+			"[-s maximum_steps] "
+			"input_file output_variables_file "
+			"[output_flows_file] [output_advance_file]"
+			"[input_probes_file output_probes_file]\n"
+			"or, to simulate a batch of cases:\n./SWOCS -b manifest_file\n");
+		return 1;
+	}
+
+	// handling the signals asking for a checkpoint
+	if (checkpoint)
+	{
+		signal(SIGINT, main_signal_handler);
+		signal(SIGTERM, main_signal_handler);
+#ifdef SIGUSR1
+		signal(SIGUSR1, main_signal_handler);
+#endif
+	}
+
+	return main_case(argn, argc, 0, checkpoint, checkpoint_interval, restart,
+		profile_file, profile_sample, steps);
 }
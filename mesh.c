@@ -34,12 +34,14 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #include <stdio.h>
 #include <stdlib.h>
-#include <math.h>
 #include <string.h>
+#include <limits.h>
+#include <math.h>
 #include "config.h"
 #include "channel.h"
 #include "node.h"
 #include "mesh.h"
+#include "binary.h"
 
 /**
  * \define DEBUG_MESH
@@ -48,40 +50,50 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define DEBUG_MESH 0
 
 /**
- * \fn int mesh_open(Mesh *mesh, Channel *channel)
- * \brief Function to open a mesh.
+ * \fn void mesh_nodes(Mesh *mesh, Channel *channel, double *x)
+ * \brief Function to set the coordinates, the cell sizes and the geometry of
+ *   the nodes of a mesh.
  * \param mesh
  * \brief mesh struct.
  * \param channel
  * \brief channel struct.
- * \return 0 on error, 1 on success.
+ * \param x
+ * \brief array of increasing node coordinates (NULL on a uniform mesh).
  */
-int mesh_open(Mesh *mesh, Channel *channel)
+void mesh_nodes(Mesh *mesh, Channel *channel, double *x)
 {
 	unsigned int i;
 	double ix;
-	Node *node;
-	mesh->node = node = (Node*)malloc(mesh->n * sizeof(Node));
-	if (!mesh->node)
+	Node *node = mesh->node;
+	if (!x)
 	{
-		print_error("mesh: not enough memory");
-		return 0;
+		ix = channel->length / (mesh->n - 1);
+		for (i = 0; i < mesh->n; ++i)
+		{
+			node[i].ix = ix;
+			node[i].x = i * ix;
+		}
+		node[0].dx = node[mesh->n - 1].dx = 0.5 * ix;
+		for (i = 0; ++i < mesh->n - 1;) node[i].dx = ix;
+	}
+	else
+	{
+		// cell distances to the next node and cell sizes of a non-uniform mesh
+		for (i = 0; i < mesh->n; ++i) node[i].x = x[i];
+		for (i = 0; i < mesh->n - 1; ++i) node[i].ix = x[i + 1] - x[i];
+		node[mesh->n - 1].ix = node[mesh->n - 2].ix;
+		node[0].dx = 0.5 * node[0].ix;
+		node[mesh->n - 1].dx = 0.5 * node[mesh->n - 2].ix;
+		for (i = 0; ++i < mesh->n - 1;)
+			node[i].dx = 0.5 * (node[i - 1].ix + node[i].ix);
 	}
-	ix = channel->length / (mesh->n - 1);
 	for (i = 0; i < mesh->n; ++i)
 	{
-		node[i].ix = ix;
-		node[i].x = i * ix;
 		node_init(node + i, channel->geometry);
-		memcpy(node[i].friction_coefficient, channel->friction_coefficient,
-			3 * sizeof(double));
-		memcpy(node[i].infiltration_coefficient,
-			channel->infiltration_coefficient, 4 * sizeof(double));
-		memcpy(node[i].diffusion_coefficient, channel->diffusion_coefficient,
-			sizeof(double));
+		node[i].friction_coefficient = channel->friction_coefficient;
+		node[i].infiltration_coefficient = channel->infiltration_coefficient;
+		node[i].diffusion_coefficient = channel->diffusion_coefficient;
 	}
-	node[0].dx = node[mesh->n - 1].dx = 0.5 * ix;
-	for (i = 0; ++i < mesh->n - 1;) node[i].dx = ix;
 #if DEBUG_MESH
 	for (i=0; i < mesh->n; ++i)
 		printf("node %u:\nx=%lg ix=%lg dx=%lg\nzb=%lg B0=%lg Z=%lg zmax=%lg\n",
@@ -94,9 +106,101 @@ int mesh_open(Mesh *mesh, Channel *channel)
 			node[i].Z,
 			node[i].zmax);
 #endif
+}
+
+/**
+ * \fn int mesh_open(Mesh *mesh, Channel *channel, double *x)
+ * \brief Function to open a mesh.
+ *
+ * The arrays are allocated with the actual number of nodes, that is the
+ * maximum number of nodes of an adaptive mesh.
+ * \param mesh
+ * \brief mesh struct.
+ * \param channel
+ * \brief channel struct.
+ * \param x
+ * \brief array of increasing node coordinates (NULL on a uniform mesh).
+ * \return 0 on error, 1 on success.
+ */
+int mesh_open(Mesh *mesh, Channel *channel, double *x)
+{
+	unsigned int i;
+	mesh->nmax = mesh->n;
+	mesh->node = (Node*)malloc(mesh->n * sizeof(Node));
+	for (i = 0; i < 5; ++i)
+		mesh->U[i] = (double*)calloc(mesh->n, sizeof(double));
+	mesh->V[0] = (double*)calloc(9 * mesh->n, sizeof(double));
+	if (mesh->V[0])
+		for (i = 1; i < 9; ++i) mesh->V[i] = mesh->V[i - 1] + mesh->n;
+	mesh->h = (double*)calloc(mesh->n, sizeof(double));
+	mesh->u = (double*)calloc(mesh->n, sizeof(double));
+	mesh->c = (double*)calloc(mesh->n, sizeof(double));
+	mesh->Sf = (double*)calloc(mesh->n, sizeof(double));
+	mesh->dF = (double(*)[3])calloc(mesh->n, 3 * sizeof(double));
+	mesh->dFl = (double(*)[3])calloc(mesh->n, 3 * sizeof(double));
+	mesh->dFr = (double(*)[3])calloc(mesh->n, 3 * sizeof(double));
+	mesh->dWl = (double(*)[3])calloc(mesh->n, 3 * sizeof(double));
+	mesh->dWr = (double(*)[3])calloc(mesh->n, 3 * sizeof(double));
+	mesh->l = (double(*)[3])calloc(mesh->n, 3 * sizeof(double));
+	mesh->Un = (double(*)[3])calloc(mesh->n, 3 * sizeof(double));
+	mesh->Ui = (double(*)[3])calloc(mesh->n, 3 * sizeof(double));
+	mesh->dU = (double(*)[3])calloc(mesh->n, 3 * sizeof(double));
+	mesh->Jp = (double(*)[9])calloc(mesh->n, 9 * sizeof(double));
+	mesh->Jn = (double(*)[9])calloc(mesh->n, 9 * sizeof(double));
+	mesh->Ip = (double(*)[9])calloc(mesh->n, 9 * sizeof(double));
+	mesh->In = (double(*)[9])calloc(mesh->n, 9 * sizeof(double));
+	mesh->Sfn = (double*)calloc(mesh->n, sizeof(double));
+	mesh->level = (unsigned int*)calloc(mesh->n, sizeof(unsigned int));
+	mesh->na = mesh->n;
+	if (!mesh->node || !mesh->U[0] || !mesh->U[1] || !mesh->U[2] || !mesh->U[3]
+		|| !mesh->U[4] || !mesh->V[0] || !mesh->h || !mesh->u || !mesh->c
+		|| !mesh->Sf || !mesh->dF || !mesh->dFl || !mesh->dFr || !mesh->dWl
+		|| !mesh->dWr || !mesh->l || !mesh->Un || !mesh->Ui || !mesh->dU
+		|| !mesh->Jp || !mesh->Jn || !mesh->Ip || !mesh->In || !mesh->Sfn
+		|| !mesh->level)
+	{
+		print_error("mesh: not enough memory");
+		return 0;
+	}
+	mesh_nodes(mesh, channel, x);
 	return 1;
 }
 
+/**
+ * \fn void mesh_delete(Mesh *mesh)
+ * \brief Function to free the memory used by a mesh.
+ * \param mesh
+ * \brief mesh struct.
+ */
+void mesh_delete(Mesh *mesh)
+{
+	unsigned int i;
+	free(mesh->node);
+	for (i = 0; i < 5; ++i) free(mesh->U[i]);
+	free(mesh->V[0]);
+	free(mesh->h);
+	free(mesh->u);
+	free(mesh->c);
+	free(mesh->Sf);
+	free(mesh->dF);
+	free(mesh->dFl);
+	free(mesh->dFr);
+	free(mesh->dWl);
+	free(mesh->dWr);
+	free(mesh->l);
+	free(mesh->Un);
+	free(mesh->Ui);
+	free(mesh->dU);
+	free(mesh->Jp);
+	free(mesh->Jn);
+	free(mesh->Ip);
+	free(mesh->In);
+	free(mesh->Sfn);
+	free(mesh->level);
+	free(mesh->refinement->x);
+	free(mesh->refinement->level);
+}
+
 /**
  * \fn void mesh_initial_conditions_dry(Mesh *mesh) 
  * \brief Function to read dry initial conditions.
@@ -105,11 +209,8 @@ int mesh_open(Mesh *mesh, Channel *channel)
  */
 void mesh_initial_conditions_dry(Mesh *mesh)
 {
-	unsigned int i;
-	Node *node = mesh->node;
-	for (i = 0; i < mesh->n; ++i)
-		node[i].U[0] = node[i].U[1] = node[i].U[2] = node[i].U[3] = node[i].U[4]
-			= 0.; 
+	unsigned int j;
+	for (j = 0; j < 5; ++j) memset(mesh->U[j], 0, mesh->n * sizeof(double));
 }
 
 /**
@@ -126,6 +227,7 @@ int mesh_initial_conditions_profile(Mesh *mesh, FILE *file)
 	double dx, *x, *A, *Q, *s;
 	char *msg;
 	Node *node = mesh->node;
+	double **U = mesh->U;
 	if (fscanf(file, "%u", &n) != 1 || n < 1)
 	{
 		msg = "mesh initial conditions profile: bad points number";
@@ -167,32 +269,32 @@ int mesh_initial_conditions_profile(Mesh *mesh, FILE *file)
 		}
 		if (node[i].x <= x[0])
 		{
-			node[i].U[0] = A[0];
-			node[i].U[1] = Q[0];
-			node[i].U[2] = A[0] * s[0];
+			U[0][i] = A[0];
+			U[1][i] = Q[0];
+			U[2][i] = A[0] * s[0];
 		}
 		else if (node[i].x >= x[n])
 		{
-			node[i].U[0] = A[n];
-			node[i].U[1] = Q[n];
-			node[i].U[2] = A[n] * s[n];
+			U[0][i] = A[n];
+			U[1][i] = Q[n];
+			U[2][i] = A[n] * s[n];
 		}
 		else
 		{
 			dx = (node[i].x - x[j]) / (x[j - 1] - x[j]);
-			node[i].U[0] = A[j] + dx * (A[j - 1] - A[j]);
-			node[i].U[1] = Q[j] + dx * (Q[j - 1] - Q[j]);
-			node[i].U[2] = node[i].U[0] * (s[j] + dx * (s[j - 1] - s[j]));
+			U[0][i] = A[j] + dx * (A[j - 1] - A[j]);
+			U[1][i] = Q[j] + dx * (Q[j - 1] - Q[j]);
+			U[2][i] = U[0][i] * (s[j] + dx * (s[j - 1] - s[j]));
 		}
-		node[i].U[3] = node[i].U[4] = 0.;
+		U[3][i] = U[4][i] = 0.;
 	}
 #if DEBUG_MESH
 	for (i=0; i < mesh->n; ++i)
 		printf("node:\nx=%lg A=%lg Q=%lg As=%lg\n",
 			node[i].x,
-			node[i].U[0],
-			node[i].U[1],
-			node[i].U[2]);
+			U[0][i],
+			U[1][i],
+			U[2][i]);
 #endif
 	return 1;
 
@@ -204,6 +306,235 @@ bad2:
 	return 0;
 }
 
+/**
+ * \fn double mesh_size(double x, double *X, double *H, unsigned int m)
+ * \brief Function to calculate the node size function of a graded mesh.
+ * \param x
+ * \brief coordinate.
+ * \param X
+ * \brief array of increasing coordinates of the node size function points.
+ * \param H
+ * \brief array of node sizes of the node size function points.
+ * \param m
+ * \brief number of points of the node size function.
+ * \return node size.
+ */
+static double mesh_size(double x, double *X, double *H, unsigned int m)
+{
+	unsigned int j;
+	if (x <= X[0]) return H[0];
+	for (j = 1; j < m; ++j)
+		if (x <= X[j]) return interpolate(x, X[j - 1], X[j], H[j - 1], H[j]);
+	return H[m - 1];
+}
+
+/**
+ * \fn void mesh_graded(double *x, unsigned int n, double *X, double *H, \
+ *   unsigned int m)
+ * \brief Function to calculate the node coordinates of a graded mesh.
+ *
+ * The node size function \f$h(x)\f$ is linearly interpolated between the
+ * points (X, H) (constant out of the points) and the nodes equidistribute
+ * \f$\int dx/h\f$, calculated analytically in every linear segment, so the
+ * distance between the nodes is proportional to \f$h\f$.
+ * \param x
+ * \brief array of node coordinates. The first and the last must be set to the
+ *   channel ends.
+ * \param n
+ * \brief number of nodes.
+ * \param X
+ * \brief array of increasing coordinates of the node size function points.
+ * \param H
+ * \brief array of positive node sizes of the node size function points.
+ * \param m
+ * \brief number of points of the node size function.
+ */
+void mesh_graded(double *x, unsigned int n, double *X, double *H,
+	unsigned int m)
+{
+	unsigned int i, j, ns;
+	double total, g, d, r, xs[m + 2], hs[m + 2], Gs[m + 2];
+
+	// segments between the channel ends and the inner points
+	xs[0] = x[0];
+	for (j = 0, ns = 1; j < m; ++j)
+		if (X[j] > x[0] && X[j] < x[n - 1]) xs[ns++] = X[j];
+	xs[ns] = x[n - 1];
+	for (j = 0; j <= ns; ++j) hs[j] = mesh_size(xs[j], X, H, m);
+
+	// cumulative integrals of 1/h
+	Gs[0] = 0.;
+	for (j = 0; j < ns; ++j)
+	{
+		d = xs[j + 1] - xs[j];
+		r = (hs[j + 1] - hs[j]) / hs[j];
+		if (fabs(r) < 1e-6) Gs[j + 1] = Gs[j] + d / hs[j] * (1. - 0.5 * r);
+		else Gs[j + 1] = Gs[j] + d * log1p(r) / (hs[j + 1] - hs[j]);
+	}
+
+	// inverting the integral at the nodes
+	total = Gs[ns];
+	for (i = 1, j = 0; i < n - 1; ++i)
+	{
+		g = total * i / (n - 1);
+		while (j < ns - 1 && g > Gs[j + 1]) ++j;
+		g -= Gs[j];
+		d = xs[j + 1] - xs[j];
+		r = (hs[j + 1] - hs[j]) / hs[j];
+		if (fabs(r) < 1e-6) x[i] = xs[j] + g * hs[j];
+		else
+			x[i] = xs[j] + d * expm1(g * (hs[j + 1] - hs[j]) / d) / r;
+	}
+}
+
+/**
+ * \fn unsigned int mesh_refined(Mesh *mesh, double *x)
+ * \brief Function to calculate the node coordinates of an adaptive mesh from
+ *   the refinement levels of the base mesh intervals.
+ * \param mesh
+ * \brief mesh struct.
+ * \param x
+ * \brief array of node coordinates.
+ * \return number of nodes.
+ */
+unsigned int mesh_refined(Mesh *mesh, double *x)
+{
+	unsigned int i, j, k, m;
+	double d;
+	Refinement *refinement = mesh->refinement;
+	for (i = k = 0; i < refinement->n - 1; ++i)
+	{
+		m = 1 << refinement->level[i];
+		d = refinement->x[i + 1] - refinement->x[i];
+		for (j = 0; j < m; ++j, ++k) x[k] = refinement->x[i] + d * j / m;
+	}
+	x[k] = refinement->x[refinement->n - 1];
+	return k + 1;
+}
+
+/**
+ * \fn double* mesh_read_coordinates(Mesh *mesh, Channel *channel, FILE *file)
+ * \brief Function to read the node coordinates of a non-uniform mesh.
+ *
+ * The data are the spacing type and, with type 1, the number of nodes and the
+ * increasing node coordinates or, with type 2 (graded mesh), the number of
+ * nodes, the number of points of the node size function and the coordinate and
+ * the node size of every point or, with type 3 (adaptive mesh), the number of
+ * nodes of the uniform base mesh, the maximum refinement level, the number of
+ * time steps between adaptations and the relative depth and solute
+ * concentration jumps to refine. The adaptive mesh starts refined at the
+ * maximum level.
+ * \param mesh
+ * \brief mesh struct.
+ * \param channel
+ * \brief channel struct.
+ * \param file
+ * \brief input file.
+ * \return array of node coordinates on success, NULL on error.
+ */
+double* mesh_read_coordinates(Mesh *mesh, Channel *channel, FILE *file)
+{
+	unsigned int i, m, type;
+	double *x = NULL, *X = NULL, *H = NULL;
+	char *msg;
+	Geometry *geometry = channel->geometry;
+	Refinement *refinement = mesh->refinement;
+	if (fscanf(file, "%u%u", &type, &mesh->n) != 2 || mesh->n < 3)
+	{
+		msg = "mesh: bad nodes number";
+		goto bad;
+	}
+	x = (double*)malloc(mesh->n * sizeof(double));
+	if (!x)
+	{
+		msg = "mesh: not enough memory";
+		goto bad;
+	}
+	switch (type)
+	{
+	case 1:
+		for (i = 0; i < mesh->n; ++i)
+			if (fscanf(file, "%lf", x + i) != 1 || (i > 0 && x[i] <= x[i - 1]))
+			{
+				msg = "mesh: bad node coordinates";
+				goto bad;
+			}
+		break;
+	case 2:
+		if (fscanf(file, "%u", &m) != 1 || m < 1)
+		{
+			msg = "mesh: bad node size function";
+			goto bad;
+		}
+		X = (double*)malloc(m * sizeof(double));
+		H = (double*)malloc(m * sizeof(double));
+		if (!X || !H)
+		{
+			msg = "mesh: not enough memory";
+			goto bad;
+		}
+		for (i = 0; i < m; ++i)
+			if (fscanf(file, "%lf%lf", X + i, H + i) != 2 || H[i] <= 0.
+				|| (i > 0 && X[i] <= X[i - 1]))
+			{
+				msg = "mesh: bad node size function";
+				goto bad;
+			}
+		x[0] = geometry->x[0];
+		x[mesh->n - 1] = geometry->x[geometry->n - 1];
+		mesh_graded(x, mesh->n, X, H, m);
+		free(X);
+		free(H);
+		break;
+	case 3:
+		if (fscanf(file, "%u%u%lf%lf", &refinement->levels,
+			&refinement->interval, &refinement->depth,
+			&refinement->concentration) != 4 || !refinement->levels
+			|| refinement->levels > REFINEMENT_MAXIMUM_LEVELS
+			|| !refinement->interval || refinement->depth < 0.
+			|| refinement->concentration < 0.)
+		{
+			msg = "mesh: bad adaptive refinement";
+			goto bad;
+		}
+		refinement->n = mesh->n;
+		refinement->x = x;
+		refinement->level
+			= (unsigned int*)malloc((mesh->n - 1) * sizeof(unsigned int));
+		mesh->n = (mesh->n - 1) * (1 << refinement->levels) + 1;
+		x = (double*)malloc(mesh->n * sizeof(double));
+		if (!refinement->level || !x)
+		{
+			free(refinement->x);
+			free(refinement->level);
+			refinement->x = NULL;
+			refinement->level = NULL;
+			msg = "mesh: not enough memory";
+			goto bad;
+		}
+		for (i = 0; i < refinement->n; ++i)
+			refinement->x[i] = i * channel->length / (refinement->n - 1);
+		for (i = 0; i < refinement->n - 1; ++i)
+			refinement->level[i] = refinement->levels;
+		mesh_refined(mesh, x);
+		break;
+	default:
+		msg = "mesh: bad spacing type";
+		goto bad;
+	}
+#if DEBUG_MESH
+	for (i = 0; i < mesh->n; ++i) printf("mesh: x%u=%lg\n", i, x[i]);
+#endif
+	return x;
+
+bad:
+	free(x);
+	free(X);
+	free(H);
+	print_error(msg);
+	return NULL;
+}
+
 /**
  * \fn int mesh_read(Mesh *mesh, Channel *channel, FILE *file)
  * \brief Function to read a mesh.
@@ -217,13 +548,22 @@ bad2:
  */
 int mesh_read(Mesh *mesh, Channel *channel, FILE *file)
 {
+	int ok;
+	double *x = NULL;
 	char *msg;
 	if (fscanf(file, "%u%u", &mesh->n, &mesh->type) != 2)
 	{
 		msg = "mesh: bad defined";
 		goto bad;
 	}
-	if (mesh->n < 3)
+
+	// a null nodes number defines a non-uniform mesh
+	if (!mesh->n)
+	{
+		x = mesh_read_coordinates(mesh, channel, file);
+		if (!x) return 0;
+	}
+	else if (mesh->n < 3)
 	{
 		msg = "mesh: bad nodes number";
 		goto bad;
@@ -231,7 +571,9 @@ int mesh_read(Mesh *mesh, Channel *channel, FILE *file)
 #if DEBUG_MESH
 	printf("mesh: n=%u type=%u\n", mesh->n, mesh->type);
 #endif
-	if (!mesh_open(mesh, channel)) return 0;
+	ok = mesh_open(mesh, channel, x);
+	free(x);
+	if (!ok) return 0;
 	switch (mesh->type)
 	{
 	case 1:
@@ -267,20 +609,74 @@ void mesh_write_variables(Mesh *mesh, FILE *file)
 {
 	unsigned int i;
 	Node *node;
+	double **U = mesh->U;
 	for (i = 0; i < mesh->n; ++i)
 	{
 		node = mesh->node + i;
 		fprintf(file, "%.14le %.14le %.14le %.14le %.14le %.14le %.14le\n",
 			node->x,
-			node->U[0],
-			node->U[1],
-			node->U[2],
-			node->U[3],
-			node->U[4],
+			U[0][i],
+			U[1][i],
+			U[2][i],
+			U[3][i],
+			U[4][i],
 			node->zb);
 	}
 }
 
+/**
+ * \fn void mesh_write_variables_binary(Mesh *mesh, FILE *file)
+ * \brief Function to write the variables of a mesh in a binary file, stored by
+ *   columns.
+ * \param mesh
+ * \brief mesh struct.
+ * \param file
+ * \brief output file.
+ */
+void mesh_write_variables_binary(Mesh *mesh, FILE *file)
+{
+	unsigned int i, j;
+	double *v;
+	Node *node = mesh->node;
+	char *name[7] = {"x", "A", "Q", "As", "Ai", "Asi", "zb"};
+	v = (double*)malloc(mesh->n * sizeof(double));
+	if (!v)
+	{
+		print_error("mesh: not enough memory");
+		return;
+	}
+	binary_write_header(file, 1, 7, mesh->n, name);
+	for (i = 0; i < mesh->n; ++i) v[i] = node[i].x;
+	fwrite(v, sizeof(double), mesh->n, file);
+	for (j = 0; j < 5; ++j) fwrite(mesh->U[j], sizeof(double), mesh->n, file);
+	for (i = 0; i < mesh->n; ++i) v[i] = node[i].zb;
+	fwrite(v, sizeof(double), mesh->n, file);
+	free(v);
+}
+
+/**
+ * \fn void mesh_flows(Mesh *mesh, unsigned int i, double *f)
+ * \brief Function to calculate the flows between two nodes of a mesh.
+ * \param mesh
+ * \brief mesh struct.
+ * \param i
+ * \brief number of the left node.
+ * \param f
+ * \brief array of position and flows.
+ */
+void mesh_flows(Mesh *mesh, unsigned int i, double *f)
+{
+	Node *node = mesh->node;
+	double *A = mesh->U[0], *Q = mesh->U[1];
+	double *h = mesh->h, *u = mesh->u, *Sf = mesh->Sf;
+	f[0] = 0.5 * (node[i].x + node[i + 1].x);
+	f[1] = (Q[i + 1] * u[i + 1] - Q[i] * u[i]) / node[i].ix;
+	f[2] = 0.5 * G * (A[i + 1] + A[i]) * (node[i + 1].zb - node[i].zb)
+		/ node[i].ix;
+	f[3] = 0.5 * G * (A[i + 1] + A[i]) * (h[i + 1] - h[i]) / node[i].ix;
+	f[4] = 0.25 * G * (A[i + 1] + A[i]) * (Sf[i + 1] + Sf[i]);
+}
+
 /**
  * \fn int mesh_write_flows(Mesh *mesh, FILE *file)
  * \brief Function to write the flows of a mesh in a file.
@@ -292,23 +688,47 @@ void mesh_write_variables(Mesh *mesh, FILE *file)
 void mesh_write_flows(Mesh *mesh, FILE *file)
 {
 	unsigned int i, n1;
-	Node *node = mesh->node;
+	double f[5];
 	n1 = mesh->n - 1;
 	for (i = 0; i < n1; ++i)
 	{
+		mesh_flows(mesh, i, f);
 		fprintf(file, "%.14le %.14le %.14le %.14le %.14le\n",
-			0.5 * (node[i].x + node[i + 1].x),
-			(node[i + 1].U[1] * node[i + 1].u - node[i].U[1] * node[i].u)
-				/ node[i].ix,
-			0.5 * G * (node[i + 1].U[0] + node[i].U[0])
-				* (node[i + 1].zb - node[i].zb) / node[i].ix,
-			0.5 * G * (node[i + 1].U[0] + node[i].U[0])
-				* (node[i + 1].h - node[i].h) / node[i].ix,
-			0.25 * G * (node[i + 1].U[0] + node[i].U[0])
-				* (node[i + 1].Sf + node[i].Sf));
+			f[0], f[1], f[2], f[3], f[4]);
 	}
 }
 
+/**
+ * \fn void mesh_write_flows_binary(Mesh *mesh, FILE *file)
+ * \brief Function to write the flows of a mesh in a binary file, stored by
+ *   columns.
+ * \param mesh
+ * \brief mesh struct.
+ * \param file
+ * \brief output file.
+ */
+void mesh_write_flows_binary(Mesh *mesh, FILE *file)
+{
+	unsigned int i, j, n1;
+	double f[5], *v;
+	char *name[5] = {"x", "dQu", "gAdzb", "gAdh", "gASf"};
+	n1 = mesh->n - 1;
+	v = (double*)malloc(5 * n1 * sizeof(double));
+	if (!v)
+	{
+		print_error("mesh: not enough memory");
+		return;
+	}
+	for (i = 0; i < n1; ++i)
+	{
+		mesh_flows(mesh, i, f);
+		for (j = 0; j < 5; ++j) v[j * n1 + i] = f[j];
+	}
+	binary_write_header(file, 1, 5, n1, name);
+	fwrite(v, sizeof(double), 5 * n1, file);
+	free(v);
+}
+
 /**
  * \fn double mesh_water_mass(Mesh *mesh)
  * \brief Function to calculate the water mass in a mesh.
@@ -321,8 +741,9 @@ double mesh_water_mass(Mesh *mesh)
 	unsigned int i;
 	double mass = 0.;
 	Node *node = mesh->node;
+	double **U = mesh->U;
 	for (i = 0; i < mesh->n; ++i)
-		mass += node[i].dx * (node[i].U[0] + node[i].U[3]);
+		mass += node[i].dx * (U[0][i] + U[3][i]);
 	return mass;
 }
 
@@ -338,7 +759,168 @@ double mesh_solute_mass(Mesh *mesh)
 	unsigned int i;
 	double mass = 0.;
 	Node *node = mesh->node;
+	double **U = mesh->U;
 	for (i = 0; i < mesh->n; ++i)
-		mass += node[i].dx * (node[i].U[2] + node[i].U[4]);
+		mass += node[i].dx * (U[2][i] + U[4][i]);
 	return mass;
 }
+
+/**
+ * \fn void mesh_active(Mesh *mesh, unsigned int margin)
+ * \brief Function to update the active window of a mesh.
+ *
+ * The active window contains the nodes from the inlet to the last wet node plus
+ * a margin of dry nodes that the water can reach in a time step. The nodes
+ * beyond are dry and unchanged by the numerical schemes, so they are skipped.
+ * The last wet node is searched backwards from the end of the former window.
+ * \param mesh
+ * \brief mesh struct.
+ * \param margin
+ * \brief number of dry nodes after the last wet node.
+ */
+void mesh_active(Mesh *mesh, unsigned int margin)
+{
+	int i;
+	double *A = mesh->U[0];
+	for (i = mesh->na; --i >= 0 && A[i] == 0.;);
+	mesh->wet = i;
+	mesh->na = i + 1 + margin;
+	if (mesh->na > mesh->n) mesh->na = mesh->n;
+}
+
+/**
+ * \fn int mesh_adapt(Mesh *mesh, Channel *channel)
+ * \brief Function to adapt the refinement of an adaptive mesh.
+ *
+ * The base mesh intervals with a relative depth or solute concentration jump
+ * between two nodes greater than the thresholds, or with the wet front, are
+ * refined at the maximum level, keeping a buffer of intervals that the flow
+ * can reach before the next adaptation. The level decreases by one in every
+ * neighbour interval, so the cell size changes at most by a factor of 2. The
+ * conserved variables of the new cells are the integrals over the old cells
+ * overlapping them, conserving the water and solute masses without new
+ * extrema, excepting the discharges of the channel ends, kept to preserve the
+ * boundary conditions. The node parameters have to be updated after the
+ * adaptation.
+ * \param mesh
+ * \brief mesh struct.
+ * \param channel
+ * \brief channel struct.
+ * \return 1 if the mesh changes, 0 otherwise.
+ */
+int mesh_adapt(Mesh *mesh, Channel *channel)
+{
+	unsigned int i, j, k, m, nb, no, buffer, *level;
+	int front;
+	double hmax, smax, a, b, ao, bo, d, *x, *Uo[5], *co;
+	Refinement *refinement = mesh->refinement;
+	Node *node = mesh->node, *old;
+	double **U = mesh->U;
+	double *h = mesh->h;
+	nb = refinement->n - 1;
+	level = (unsigned int*)malloc(nb * sizeof(unsigned int));
+	x = (double*)malloc(mesh->nmax * sizeof(double));
+	old = (Node*)malloc(mesh->n * sizeof(Node));
+	Uo[0] = (double*)malloc(5 * mesh->n * sizeof(double));
+	co = (double*)malloc(mesh->n * sizeof(double));
+	if (!level || !x || !old || !Uo[0] || !co) goto end;
+
+	// intervals to refine
+	for (i = 0, hmax = smax = 0.; i < mesh->n; ++i)
+	{
+		hmax = fmax(hmax, h[i]);
+		smax = fmax(smax, node[i].s);
+	}
+	a = refinement->depth * hmax;
+	b = refinement->concentration * smax;
+	front = (mesh->wet < 0) ? 0 : mesh->wet;
+	for (i = k = 0; i < nb; ++i, k = m)
+	{
+		m = k + (1 << refinement->level[i]);
+		level[i] = (front >= k && front < m) ? 0 : UINT_MAX;
+		for (j = k; level[i] && j < m; ++j)
+			if ((a > 0. && fabs(h[j + 1] - h[j]) > a)
+				|| (b > 0. && fabs(node[j + 1].s - node[j].s) > b))
+				level[i] = 0;
+	}
+
+	// distances to the refined intervals and levels
+	for (i = 0; ++i < nb;)
+		if (level[i - 1] < level[i]) level[i] = level[i - 1] + 1;
+	for (i = nb - 1; i-- > 0;)
+		if (level[i + 1] < level[i]) level[i] = level[i + 1] + 1;
+	buffer = (refinement->interval >> refinement->levels) + 1;
+	for (i = 0; i < nb; ++i)
+	{
+		m = (level[i] > buffer) ? level[i] - buffer : 0;
+		level[i] = (m < refinement->levels) ? refinement->levels - m : 0;
+	}
+	for (i = 0; i < nb && level[i] == refinement->level[i]; ++i);
+	if (i == nb) goto end;
+
+	// new mesh
+	no = mesh->n;
+	memcpy(old, node, no * sizeof(Node));
+	for (j = 0; j < 5; ++j)
+	{
+		if (j > 0) Uo[j] = Uo[j - 1] + no;
+		memcpy(Uo[j], U[j], no * sizeof(double));
+	}
+	memcpy(co, mesh->c, no * sizeof(double));
+	free(refinement->level);
+	refinement->level = level;
+	level = NULL;
+	mesh->n = mesh_refined(mesh, x);
+	mesh_nodes(mesh, channel, x);
+
+	// conservative transfer of the variables
+	for (i = k = j = 0; i < mesh->n; ++i)
+	{
+		a = (i > 0) ? 0.5 * (x[i - 1] + x[i]) : x[0];
+		b = (i < mesh->n - 1) ? 0.5 * (x[i] + x[i + 1]) : x[mesh->n - 1];
+		while (k < no - 1 && 0.5 * (old[k].x + old[k + 1].x) <= a) ++k;
+		U[0][i] = U[1][i] = U[2][i] = U[3][i] = U[4][i] = 0.;
+		for (m = k; m < no; ++m)
+		{
+			ao = (m > 0) ? 0.5 * (old[m - 1].x + old[m].x) : old[0].x;
+			if (ao >= b) break;
+			bo = (m < no - 1) ? 0.5 * (old[m].x + old[m + 1].x) : old[m].x;
+			d = fmin(b, bo) - fmax(a, ao);
+			if (d > 0.)
+			{
+				U[0][i] += d * Uo[0][m];
+				U[1][i] += d * Uo[1][m];
+				U[2][i] += d * Uo[2][m];
+				U[3][i] += d * Uo[3][m];
+				U[4][i] += d * Uo[4][m];
+			}
+		}
+		d = 1. / node[i].dx;
+		U[0][i] *= d;
+		U[1][i] *= d;
+		U[2][i] *= d;
+		U[3][i] *= d;
+		U[4][i] *= d;
+
+		// critical velocity of the old node containing the new one
+		while (j < no - 1 && 0.5 * (old[j].x + old[j + 1].x) <= x[i]) ++j;
+		mesh->c[i] = co[j];
+	}
+
+	// the discharges of the channel ends are set by the boundary conditions
+	U[1][0] = Uo[1][0];
+	U[1][mesh->n - 1] = Uo[1][no - 1];
+	free(x);
+	free(old);
+	free(Uo[0]);
+	free(co);
+	return 1;
+
+end:
+	free(level);
+	free(x);
+	free(old);
+	free(Uo[0]);
+	free(co);
+	return 0;
+}
@@ -37,6 +37,40 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef MESH__H
 #define MESH__H 1
 
+/**
+ * \struct _Refinement
+ * \brief Struct to define the adaptive refinement of a mesh.
+ */
+struct _Refinement
+{
+/**
+ * \var x
+ * \brief array of node coordinates of the base mesh.
+ * \var level
+ * \brief array of refinement levels of the base mesh intervals (every interval
+ *   is divided in \f$2^{level}\f$ cells).
+ * \var depth
+ * \brief relative depth jump to refine.
+ * \var concentration
+ * \brief relative solute concentration jump to refine.
+ * \var n
+ * \brief number of nodes of the base mesh.
+ * \var levels
+ * \brief maximum refinement level (0 on a not adaptive mesh).
+ * \var interval
+ * \brief number of time steps between adaptations.
+ * \var steps
+ * \brief number of time steps since the last adaptation.
+ */
+	double *x, depth, concentration;
+	unsigned int *level, n, levels, interval, steps;
+};
+
+/**
+ * \typedef Refinement
+ */
+typedef struct _Refinement Refinement;
+
 /**
  * \struct _Mesh
  * \brief Struct to define a mesh.
@@ -46,13 +80,75 @@ struct _Mesh
 /**
  * \var node
  * \brief array of node structs.
+ * \var U
+ * \brief arrays of the conserved variables of the nodes (U[j][i] is the j-th
+ *   conserved variable of the i-th node).
+ * \var h
+ * \brief array of node depths.
+ * \var u
+ * \brief array of node velocities.
+ * \var c
+ * \brief array of node critical velocities.
+ * \var Sf
+ * \brief array of node friction slopes.
+ * \var V
+ * \brief arrays of node parameters gathered per field to vectorize the
+ *   interfaces loops (V[0] lateral wall slopes, V[1] surface widths, V[2]
+ *   surface solute concentrations, V[3] cell distances, V[4] first
+ *   eigenvalues, V[5] second eigenvalues and V[6], V[7], V[8] flux
+ *   differences).
+ * \var dF
+ * \brief array of flux difference vectors.
+ * \var dFl
+ * \brief array of left numerical flux difference vectors.
+ * \var dFr
+ * \brief array of right numerical flux difference vectors.
+ * \var dWl
+ * \brief array of high order left numerical flux difference vectors.
+ * \var dWr
+ * \brief array of high order right numerical flux difference vectors.
+ * \var l
+ * \brief array of jacobian eigenvalues vectors.
+ * \var Un
+ * \brief array of former time step conserved variables vectors.
+ * \var Ui
+ * \brief array of former iteration conserved variables vectors of the
+ *   implicit schemes.
+ * \var dU
+ * \brief array of conserved variables increment vectors.
+ * \var Jp
+ * \brief array of positive implicit operators.
+ * \var Jn
+ * \brief array of negative implicit operators.
+ * \var Ip
+ * \brief array of inverted system matrices of the positive implicit operators.
+ * \var In
+ * \brief array of inverted system matrices of the negative implicit operators.
+ * \var Sfn
+ * \brief array of former time step friction slopes.
+ * \var level
+ * \brief array of time step levels of the nodes with local time stepping.
+ * \var refinement
+ * \brief adaptive refinement struct.
  * \var n
  * \brief number of nodes.
+ * \var nmax
+ * \brief maximum number of nodes (allocated).
+ * \var na
+ * \brief number of nodes of the active window.
+ * \var wet
+ * \brief last wet node (-1 if all the mesh is dry).
  * \var type
  * \brief initial conditions type (1 dry, 2 longitudinal profile).
  */
 	Node *node;
-	int n, type;
+	double *U[5], *V[9], *h, *u, *c, *Sf;
+	double (*dF)[3], (*dFl)[3], (*dFr)[3], (*dWl)[3], (*dWr)[3], (*l)[3],
+		(*Un)[3], (*Ui)[3], (*dU)[3], (*Jp)[9], (*Jn)[9], (*Ip)[9], (*In)[9],
+		*Sfn;
+	unsigned int *level;
+	Refinement refinement[1];
+	int n, nmax, na, wet, type;
 };
 
 /**
@@ -62,11 +158,22 @@ typedef struct _Mesh Mesh;
 
 // member functions
 
-int mesh_open(Mesh *mesh, Channel *channel);
+int mesh_open(Mesh *mesh, Channel *channel, double *x);
+void mesh_delete(Mesh *mesh);
+void mesh_graded(double *x, unsigned int n, double *X, double *H,
+	unsigned int m);
+unsigned int mesh_refined(Mesh *mesh, double *x);
+void mesh_nodes(Mesh *mesh, Channel *channel, double *x);
+double* mesh_read_coordinates(Mesh *mesh, Channel *channel, FILE *file);
 int mesh_read(Mesh *mesh, Channel *channel, FILE *file);
 void mesh_write_variables(Mesh *mesh, FILE *file);
+void mesh_write_variables_binary(Mesh *mesh, FILE *file);
+void mesh_flows(Mesh *mesh, unsigned int i, double *f);
 void mesh_write_flows(Mesh *mesh, FILE *file);
+void mesh_write_flows_binary(Mesh *mesh, FILE *file);
 double mesh_water_mass(Mesh *mesh);
 double mesh_solute_mass(Mesh *mesh);
+void mesh_active(Mesh *mesh, unsigned int margin);
+int mesh_adapt(Mesh *mesh, Channel *channel);
 
 #endif
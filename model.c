@@ -35,11 +35,32 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdio.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 #include "config.h"
 #include "channel.h"
 #include "node.h"
 #include "mesh.h"
+#include "tridiagonal.h"
 #include "model.h"
+#include "binary.h"
+#include "model_hydrodynamic.h"
+#include "model_zero_advection.h"
+#include "model_zero_inertia.h"
+#include "model_kinematic.h"
+#include "model_hydrodynamic_upwind.h"
+#include "model_zero_advection_upwind.h"
+#include "model_zero_inertia_upwind.h"
+#include "model_kinematic_upwind.h"
+#include "model_hydrodynamic_LaxFriedrichs.h"
+#include "model_zero_advection_LaxFriedrichs.h"
+//#include "model_zero_inertia_LaxFriedrichs.h"
+//#include "model_kinematic_LaxFriedrichs.h"
+#include "model_hydrodynamic_implicit.h"
+#include "model_zero_advection_implicit.h"
+#include "model_zero_inertia_implicit.h"
+#include "model_kinematic_implicit.h"
+#include "model_hydrodynamic_tvd.h"
+#include "profile.h"
 
 /**
  * \define DEBUG_MODEL
@@ -47,6 +68,38 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #define DEBUG_MODEL 0
 
+/**
+ * \fn void model_parameters_calculate(Model *model)
+ * \brief Function to calculate the model parameters without profiling them.
+ * \param model
+ * \brief model struct.
+ */
+void model_parameters_calculate(Model *model)
+{
+#if SPECIALIZED_KERNELS
+	model->model_kernel_parameters(model);
+#else
+	unsigned int i, n1;
+	Mesh *mesh = model->mesh;
+	n1 = mesh->na - 1;
+	if (mesh->na < PARALLEL_MINIMUM_NODES)
+	{
+		for (i = 0; i < mesh->na; ++i) node_depth(mesh, i);
+		model->model_node_parameters_right(model, 0);
+		for (i = 1; i < n1; ++i) model->model_node_parameters_centre(model, i);
+	}
+	else
+	{
+#pragma omp parallel for
+		for (i = 0; i < mesh->na; ++i) node_depth(mesh, i);
+		model->model_node_parameters_right(model, 0);
+#pragma omp parallel for
+		for (i = 1; i < n1; ++i) model->model_node_parameters_centre(model, i);
+	}
+	model->model_node_parameters_left(model, n1);
+#endif
+}
+
 /**
  * \fn void model_parameters(Model *model)
  * \brief Function to calculate the model parameters.
@@ -55,23 +108,41 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 void model_parameters(Model *model)
 {
-	unsigned int i, n1;
-	Mesh *mesh = model->mesh;
-	Node *node = mesh->node;
+	double t0 = 0.;
 	#if DEBUG_MODEL
 		printf("Calculating parameters\n");
 	#endif
-	for (i = 0; i < mesh->n; ++i) node_depth(node + i);
-	model->model_node_parameters_right(model, node);
-	n1 = mesh->n - 1;
-	for (i = 0; ++i < n1;)
-		model->model_node_parameters_centre(model, node + i);
-	model->model_node_parameters_left(model, node + i);
+	if (model->profile) t0 = profile_clock();
+	model_parameters_calculate(model);
+	if (model->profile)
+		profile_phase(model->profile, PROFILE_PHASE_PARAMETERS, t0);
 	#if DEBUG_MODEL
 		printf("Parameters calculated\n");
 	#endif
 }
 
+/**
+ * \fn static void model_node_infiltration(Model *model, unsigned int i)
+ * \brief Function to make the infiltration model in a node.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief node number.
+ */
+static void model_node_infiltration(Model *model, unsigned int i)
+{
+	double Pidt;
+	Mesh *mesh = model->mesh;
+	Node *node = mesh->node;
+	double **U = mesh->U;
+	Pidt = fmin(node[i].Pi * model->dt, U[0][i]);
+	U[0][i] -= Pidt;
+	U[3][i] += Pidt;
+	Pidt *= node[i].s;
+	U[2][i] -= Pidt;
+	U[4][i] += Pidt;
+}
+
 /**
  * \fn void model_infiltration(Model *model)
  * \brief Function to make the infiltration model.
@@ -81,20 +152,53 @@ void model_parameters(Model *model)
 void model_infiltration(Model *model)
 {
 	unsigned int i;
-	double Pidt;
 	Mesh *mesh = model->mesh;
-	Node *node = mesh->node;
-	for (i = 0; i < mesh->n; ++i)
+	if (mesh->na < PARALLEL_MINIMUM_NODES)
+		for (i = 0; i < mesh->na; ++i) model_node_infiltration(model, i);
+	else
 	{
-		Pidt = fmin(node[i].Pi * model->dt, node[i].U[0]);
-		node[i].U[0] -= Pidt;
-		node[i].U[3] += Pidt;
-		Pidt *= node[i].s;
-		node[i].U[2] -= Pidt;
-		node[i].U[4] += Pidt;
+#pragma omp parallel for
+		for (i = 0; i < mesh->na; ++i) model_node_infiltration(model, i);
 	}
 }
 
+/**
+ * \fn double model_diffusion_explicit_flux(Model *model, unsigned int i)
+ * \brief Function to calculate the explicit diffusion flux between two nodes.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief number of the left node.
+ * \return diffusion flux by the time step size.
+ */
+double model_diffusion_explicit_flux(Model *model, unsigned int i)
+{
+	Node *node1 = model->mesh->node + i, *node2 = node1 + 1;
+	return model->dt * fmin(node2->KxA, node1->KxA)
+		* (node2->s - node1->s) / node1->ix;
+}
+
+/**
+ * \fn static void model_node_diffusion_explicit(Model *model, \
+ *   unsigned int i)
+ * \brief Function to make the explicit diffusion model in a node gathering the
+ *   fluxes of both cell interfaces to avoid write conflicts.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief node number.
+ */
+static void model_node_diffusion_explicit(Model *model, unsigned int i)
+{
+	Mesh *mesh = model->mesh;
+	Node *node = mesh->node;
+	double *As = mesh->U[2];
+	if (i > 0)
+		As[i] -= model_diffusion_explicit_flux(model, i - 1) / node[i].dx;
+	if (i < mesh->na - 1)
+		As[i] += model_diffusion_explicit_flux(model, i) / node[i].dx;
+}
+
 /**
  * \fn void model_diffusion_explicit(Model *model)
  * \brief Function to make the explicit diffusion model.
@@ -103,17 +207,14 @@ void model_infiltration(Model *model)
  */
 void model_diffusion_explicit(Model *model)
 {
-	unsigned int i, n1;
-	double dD;
+	unsigned int i;
 	Mesh *mesh = model->mesh;
-	Node *node = mesh->node;
-	n1 = mesh->n - 1;
-	for (i = 0; i < n1; ++i)
+	if (mesh->na < PARALLEL_MINIMUM_NODES)
+		for (i = 0; i < mesh->na; ++i) model_node_diffusion_explicit(model, i);
+	else
 	{
-		dD = model->dt * fmin(node[i + 1].KxA, node[i].KxA)
-			* (node[i + 1].s - node[i].s) / node[i].ix;
-		node[i].U[2] += dD / node[i].dx;
-		node[i + 1].U[2] -= dD / node[i + 1].dx;
+#pragma omp parallel for
+		for (i = 0; i < mesh->na; ++i) model_node_diffusion_explicit(model, i);
 	}
 }
 
@@ -128,13 +229,15 @@ void model_diffusion_implicit(Model *model)
 	unsigned int i, n1;
 	Mesh *mesh = model->mesh;
 	Node *node = mesh->node;
-	double k, C[mesh->n], D[mesh->n], E[mesh->n], H[mesh->n];
-	for (i = 0; i < mesh->n; ++i)
+	Tridiagonal *tridiagonal = model->tridiagonal;
+	double k, *C = tridiagonal->C, *D = tridiagonal->D, *E = tridiagonal->E,
+		*H = tridiagonal->H, *A = mesh->U[0], *As = mesh->U[2];
+	for (i = 0; i < mesh->na; ++i)
 	{
-		D[i] = node[i].U[0] * node[i].dx;
-		H[i] = node[i].U[2] * node[i].dx;
+		D[i] = A[i] * node[i].dx;
+		H[i] = As[i] * node[i].dx;
 	}
-	n1 = mesh->n - 1;
+	n1 = mesh->na - 1;
 	for (i = 0; i < n1; ++i)
 	{
 		k = model->dt * fmin(node[i + 1].KxA, node[i].KxA) / node[i].ix;
@@ -142,34 +245,508 @@ void model_diffusion_implicit(Model *model)
 		D[i] += k;
 		D[i + 1] += k;
 	}
-	for (i = 0; i < n1; ++i)
+	tridiagonal_solve(tridiagonal, mesh->na);
+	for (i = 0; i < mesh->na; ++i) As[i] = H[i] * A[i];
+}
+
+/**
+ * \fn static void model_node_surface_flow_update(Model *model, \
+ *   unsigned int i)
+ * \brief Function to update the variables of a node with the numerical flux
+ *   differences of an explicit surface flow scheme gathering the flux
+ *   differences of both cell interfaces to avoid write conflicts.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief node number.
+ */
+static void model_node_surface_flow_update(Model *model, unsigned int i)
+{
+	unsigned int j;
+	Mesh *mesh = model->mesh;
+	Node *node = mesh->node;
+	double **U = mesh->U;
+	double (*dFl)[3] = mesh->dFl, (*dFr)[3] = mesh->dFr;
+	if (i > 0)
+		for (j = 0; j < 3; ++j)
+			U[j][i] -= model->dt * dFl[i - 1][j] / node[i].dx;
+	if (i < mesh->na - 1)
+		for (j = 0; j < 3; ++j)
+			U[j][i] -= model->dt * dFr[i][j] / node[i].dx;
+}
+
+/**
+ * \fn void model_surface_flow_update(Model *model)
+ * \brief Function to update the variables with the numerical flux differences
+ *   of an explicit surface flow scheme.
+ * \param model
+ * \brief model struct.
+ */
+void model_surface_flow_update(Model *model)
+{
+	unsigned int i;
+	Mesh *mesh = model->mesh;
+	if (mesh->na < PARALLEL_MINIMUM_NODES)
+		for (i = 0; i < mesh->na; ++i) model_node_surface_flow_update(model, i);
+	else
+	{
+#pragma omp parallel for
+		for (i = 0; i < mesh->na; ++i) model_node_surface_flow_update(model, i);
+	}
+}
+
+#if RUNGE_KUTTA_ORDER > 1
+
+/**
+ * \fn void model_surface_flow_runge_kutta(Model *model)
+ * \brief Function to make the surface flow with a strong stability preserving
+ *   Runge-Kutta method of RUNGE_KUTTA_ORDER order.
+ *
+ * Every stage is a forward Euler step of the explicit scheme and the stages
+ * are combined in the Shu-Osher form with the conserved variables of the time
+ * step start, saved in the mesh Un array. The negative areas of a stage are
+ * infiltrated before the next one. The stages keep the time step interval, so
+ * the inlet and outlet contributions are the integrals of the time step and
+ * the water and solute masses are conserved.
+ * \param model
+ * \brief model struct.
+ */
+void model_surface_flow_runge_kutta(Model *model)
+{
+#if RUNGE_KUTTA_ORDER == 2
+	const double a[2] = {0., 0.5};
+#else
+	const double a[3] = {0., 0.75, 1./3.};
+#endif
+	unsigned int i, j, k;
+	Mesh *mesh = model->mesh;
+	double **U = mesh->U;
+	double (*Un)[3] = mesh->Un;
+	if (mesh->na < PARALLEL_MINIMUM_NODES)
+		for (i = 0; i < mesh->na; ++i)
+			for (j = 0; j < 3; ++j) Un[i][j] = U[j][i];
+	else
+	{
+#pragma omp parallel for private(j)
+		for (i = 0; i < mesh->na; ++i)
+			for (j = 0; j < 3; ++j) Un[i][j] = U[j][i];
+	}
+	model->model_surface_flow_stage(model);
+	for (k = 1; k < RUNGE_KUTTA_ORDER; ++k)
+	{
+		if (mesh->na < PARALLEL_MINIMUM_NODES)
+			for (i = 0; i < mesh->na; ++i) node_dry(mesh, i);
+		else
+		{
+#pragma omp parallel for
+			for (i = 0; i < mesh->na; ++i) node_dry(mesh, i);
+		}
+		model_parameters_calculate(model);
+		model->model_surface_flow_stage(model);
+		if (mesh->na < PARALLEL_MINIMUM_NODES)
+			for (i = 0; i < mesh->na; ++i)
+				for (j = 0; j < 3; ++j)
+					U[j][i] = a[k] * Un[i][j] + (1. - a[k]) * U[j][i];
+		else
+		{
+#pragma omp parallel for private(j)
+			for (i = 0; i < mesh->na; ++i)
+				for (j = 0; j < 3; ++j)
+					U[j][i] = a[k] * Un[i][j] + (1. - a[k]) * U[j][i];
+		}
+	}
+}
+
+#endif
+
+/**
+ * \fn static unsigned int model_node_multirate_level(Model *model, \
+ *   unsigned int i, double dt)
+ * \brief Function to calculate the time step level of a node with local time
+ *   stepping, before limiting the level differences of the neighbour nodes.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief node number.
+ * \param dt
+ * \brief minimum time step size.
+ * \return time step level.
+ */
+static unsigned int model_node_multirate_level(Model *model, unsigned int i,
+	double dt)
+{
+	unsigned int j, k;
+	double r;
+	Mesh *mesh = model->mesh;
+	double *h = mesh->h;
+	k = 0;
+	for (j = (i > 2) ? i - 2 : 0; j <= i + 2 && j < mesh->na; ++j)
+		if (h[j] <= model->minimum_depth) break;
+	if (j > i + 2 || j == mesh->na)
+	{
+		r = model->node_1dt_max(mesh, i);
+		if (i > 0) r = fmax(r, model->node_1dt_max(mesh, i - 1));
+		if (i + 1 < mesh->na) r = fmax(r, model->node_1dt_max(mesh, i + 1));
+		r *= dt;
+		while (k < model->multirate_levels && (2 << k) * r <= model->cfl) ++k;
+	}
+	return k;
+}
+
+/**
+ * \fn double model_multirate_levels(Model *model, double dt)
+ * \brief Function to calculate the time step levels of the nodes with local
+ *   time stepping.
+ *
+ * Every node takes the largest time step size \f$2^k\,dt\f$ allowed by its
+ * CFL condition, and the condition of its neighbours, up to the maximum
+ * number of levels.
+ * The inlet node and the nodes nearer than three nodes to a dry node take the
+ * minimum time step size, because the flow of a wet front is not positive with
+ * outdated depths, and the levels of neighbour nodes differ at most by one.
+ * The active window is enlarged with the nodes that the front can reach in the
+ * slowest time step.
+ * \param model
+ * \brief model struct.
+ * \param dt
+ * \brief minimum time step size.
+ * \return time step size of the slowest level.
+ */
+double model_multirate_levels(Model *model, double dt)
+{
+	unsigned int i, kmax, *level;
+	Mesh *mesh = model->mesh;
+	level = mesh->level;
+	mesh->na += 1 << model->multirate_levels;
+	if (mesh->na > mesh->n) mesh->na = mesh->n;
+	if (mesh->na < PARALLEL_MINIMUM_NODES)
+		for (i = 0; i < mesh->na; ++i)
+			level[i] = model_node_multirate_level(model, i, dt);
+	else
+	{
+#pragma omp parallel for
+		for (i = 0; i < mesh->na; ++i)
+			level[i] = model_node_multirate_level(model, i, dt);
+	}
+	level[0] = 0;
+	for (i = 0; ++i < mesh->na;)
+		if (level[i] > level[i - 1] + 1) level[i] = level[i - 1] + 1;
+	for (i = mesh->na - 1, kmax = level[i]; i-- > 0;)
+	{
+		if (level[i] > level[i + 1] + 1) level[i] = level[i + 1] + 1;
+		if (level[i] > kmax) kmax = level[i];
+	}
+
+	// limiting the slowest time step by the final time
+	while (kmax && (1 << kmax) * dt > model->tfinal - model->t) --kmax;
+	for (i = 0; i < mesh->na; ++i) if (level[i] > kmax) level[i] = kmax;
+	model->multirate_level = kmax;
+	return (1 << kmax) * dt;
+}
+
+/**
+ * \fn static void model_interface_multirate(Model *model, unsigned int i, \
+ *   unsigned int s, void (*model_interface)(Model*, unsigned int))
+ * \brief Function to calculate the flux differences of a cell interface with
+ *   local time stepping if it starts a time step.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief number of the left node of the interface.
+ * \param s
+ * \brief substep number.
+ * \param model_interface
+ * \brief pointer to the function calculating the flux differences.
+ */
+static void model_interface_multirate(Model *model, unsigned int i,
+	unsigned int s, void (*model_interface)(Model*, unsigned int))
+{
+	unsigned int k, *level = model->mesh->level;
+	k = (level[i] < level[i + 1]) ? level[i] : level[i + 1];
+	if (!(s & ((1 << k) - 1))) model_interface(model, i);
+}
+
+/**
+ * \fn static void model_node_multirate(Model *model, unsigned int i, \
+ *   unsigned int s, unsigned int ns, double dt)
+ * \brief Function to accumulate the flux differences of both cell interfaces of
+ *   a node with local time stepping, to avoid write conflicts, and to update
+ *   the node if it ends a time step.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief node number.
+ * \param s
+ * \brief substep number.
+ * \param ns
+ * \brief number of substeps.
+ * \param dt
+ * \brief substep size.
+ */
+static void model_node_multirate(Model *model, unsigned int i, unsigned int s,
+	unsigned int ns, double dt)
+{
+	unsigned int j, k, n1, *level;
+	Mesh *mesh = model->mesh;
+	Node *node = mesh->node;
+	double **U = mesh->U;
+	double (*dFl)[3] = mesh->dFl, (*dFr)[3] = mesh->dFr;
+	double (*dU)[3] = mesh->dU;
+	level = mesh->level;
+	n1 = mesh->na - 1;
+	if (i > 0)
+	{
+		k = (level[i - 1] < level[i]) ? level[i - 1] : level[i];
+		if (!(s & ((1 << k) - 1)))
+			for (j = 0; j < 3; ++j)
+				dU[i][j] += (1 << k) * dt * dFl[i - 1][j];
+	}
+	if (i < n1)
+	{
+		k = (level[i] < level[i + 1]) ? level[i] : level[i + 1];
+		if (!(s & ((1 << k) - 1)))
+			for (j = 0; j < 3; ++j)
+				dU[i][j] += (1 << k) * dt * dFr[i][j];
+	}
+	if ((s + 1) & ((1 << level[i]) - 1)) return;
+	for (j = 0; j < 3; ++j)
+	{
+		U[j][i] -= dU[i][j] / node[i].dx;
+		dU[i][j] = 0.;
+	}
+	if (s == ns - 1) return;
+	node_dry(mesh, i);
+	if (i > 0 && i < n1)
+	{
+		node_depth(mesh, i);
+		model->model_node_parameters_centre(model, i);
+		if (model->model_node_gather) model->model_node_gather(model, i);
+	}
+}
+
+/**
+ * \fn void model_surface_flow_multirate(Model *model)
+ * \brief Function to make the surface flow with local time stepping.
+ *
+ * The time step is divided in \f$2^k\f$ substeps, k the maximum level. The
+ * nodes of level l are updated every \f$2^l\f$ substeps. The flux
+ * differences of every cell interface are calculated at the rate of its faster
+ * node and accumulated in both nodes until their update, so the scheme is
+ * conservative. The high order fluxes, if any, are added to the flux
+ * differences of the interfaces once all the interfaces starting a time step
+ * are calculated. The inlet and outlet boundary conditions are applied every
+ * substep. The node parameters are updated after every substep but the last,
+ * as with a global time step.
+ * \param model
+ * \brief model struct.
+ */
+void model_surface_flow_multirate(Model *model)
+{
+	unsigned int i, n1, s, ns;
+	double t, t2, dt;
+	Mesh *mesh = model->mesh;
+	Node *node = mesh->node;
+	double **U = mesh->U;
+	double (*dU)[3] = mesh->dU;
+	t = model->t;
+	t2 = model->t2;
+	ns = 1 << model->multirate_level;
+	dt = model->dt / ns;
+	n1 = mesh->na - 1;
+	for (i = 0; i <= n1; ++i) dU[i][0] = dU[i][1] = dU[i][2] = 0.;
+	if (model->model_node_gather)
 	{
-		if (D[i] == 0.) k = 0; else k = C[i] / D[i];
-		D[i + 1] -= k * E[i];
-		H[i + 1] -= k * H[i];
+		if (mesh->na < PARALLEL_MINIMUM_NODES)
+			for (i = 0; i <= n1; ++i) model->model_node_gather(model, i);
+		else
+		{
+#pragma omp parallel for
+			for (i = 0; i <= n1; ++i) model->model_node_gather(model, i);
+		}
 	}
-	if (D[i] == 0.) H[i] = 0; else H[i] /= D[i];
-	node[i].U[2] = H[i] * node[i].U[0];
-	do
+	for (s = 0; s < ns; ++s)
 	{
-		--i;
-		if (D[i] == 0.) H[i] = 0; else H[i] = (H[i] - E[i] * H[i+1]) / D[i];
-		node[i].U[2] = H[i] * node[i].U[0];
+		model->t = t + s * dt;
+		model->t2 = (s == ns - 1) ? t2 : model->t + dt;
+		model->dt = model->t2 - model->t;
+		model->inlet_contribution[0] = - model->dt * U[1][0];
+		model->inlet_contribution[2] = - model->dt * node[0].T;
+
+		// flux differences of the interfaces starting a time step and
+		// accumulation in the nodes, updating the nodes ending a time step
+		if (mesh->na < PARALLEL_MINIMUM_NODES)
+		{
+			for (i = 0; i < n1; ++i)
+				model_interface_multirate(model, i, s, model->model_interface);
+			if (model->model_interface_high_order)
+				for (i = 0; i < n1; ++i)
+					model_interface_multirate(model, i, s,
+						model->model_interface_high_order);
+			for (i = 0; i <= n1; ++i) model_node_multirate(model, i, s, ns, dt);
+		}
+		else
+		{
+#pragma omp parallel for
+			for (i = 0; i < n1; ++i)
+				model_interface_multirate(model, i, s, model->model_interface);
+			if (model->model_interface_high_order)
+			{
+#pragma omp parallel for
+				for (i = 0; i < n1; ++i)
+					model_interface_multirate(model, i, s,
+						model->model_interface_high_order);
+			}
+#pragma omp parallel for
+			for (i = 0; i <= n1; ++i) model_node_multirate(model, i, s, ns, dt);
+		}
+
+		// boundary correction
+
+		model->model_inlet(model);
+		U[0][0] += model->inlet_contribution[0] / node[0].dx;
+		U[2][0] += model->inlet_contribution[2] / node[0].dx;
+		if (model->channel->type_inlet == 1)
+			node_subcritical_discharge(mesh, 0);
+		model->model_outlet(model);
+		if (s < ns - 1)
+		{
+			node_depth(mesh, 0);
+			model->model_node_parameters_right(model, 0);
+			node_depth(mesh, n1);
+			model->model_node_parameters_left(model, n1);
+			if (model->model_node_gather)
+			{
+				model->model_node_gather(model, 0);
+				model->model_node_gather(model, n1);
+			}
+		}
 	}
-	while (i > 0);
+	model->t = t;
+	model->t2 = t2;
+	model->dt = t2 - t;
+}
+
+/**
+ * \fn int model_implicit_iterate(Model *model, unsigned int iteration)
+ * \brief Function to check the convergence of the nonlinear iterations of an
+ *   implicit surface flow scheme.
+ *
+ * The residual is the relative norm of the change of the wetted cross sectional
+ * areas and discharges in the last iteration. The iterations stop when the
+ * residual is lower than the tolerance or when the maximum number of iterations
+ * is reached.
+ * \param model
+ * \brief model struct.
+ * \param iteration
+ * \brief number of made iterations.
+ * \return 1 to make another iteration, 0 to stop.
+ */
+int model_implicit_iterate(Model *model, unsigned int iteration)
+{
+	unsigned int i, j;
+	double d, r, u;
+	Mesh *mesh = model->mesh;
+	double **U = mesh->U;
+	double (*Ui)[3];
+	if (iteration >= model->implicit_iterations) goto end;
+	if (model->implicit_tolerance <= 0.) return 1;
+	if (iteration == 1) Ui = mesh->Un; else Ui = mesh->Ui;
+	r = u = 0.;
+	for (i = 0; i < mesh->na; ++i)
+		for (j = 0; j < 2; ++j)
+		{
+			d = U[j][i] - Ui[i][j];
+			r += d * d;
+			u += U[j][i] * U[j][i];
+		}
+	if (u > 0.) model->residual = sqrt(r / u); else model->residual = 0.;
+#if DEBUG_MODEL
+	printf("iteration=%u residual=%lg\n", iteration, model->residual);
+#endif
+	if (model->residual <= model->implicit_tolerance) goto end;
+	for (i = 0; i < mesh->na; ++i)
+		for (j = 0; j < 2; ++j) mesh->Ui[i][j] = U[j][i];
+	return 1;
+
+end:
+	model->iterations = iteration;
+	model->iterations_number += iteration;
+	return 0;
 }
 
 /**
- * \fn double model_node_diffusion_1dt_max(Node *node)
+ * \fn double model_node_diffusion_1dt_max(Mesh *mesh, unsigned int i)
  * \brief Function to calculate the allowed maximum time step size in a node
  *   with the diffusion model.
- * \param node
- * \brief node struct.
+ * \param mesh
+ * \brief mesh struct.
+ * \param i
+ * \brief node number.
  * \return inverse of the allowed maximum time step size.
  */
-double model_node_diffusion_1dt_max(Node *node)
+double model_node_diffusion_1dt_max(Mesh *mesh, unsigned int i)
+{
+	Node *node = mesh->node + i;
+	return (2 * node->Kx + fabs(mesh->u[i]) * node->dx) / (node->dx * node->dx);
+}
+
+/**
+ * \fn void model_active(Model *model)
+ * \brief Function to update the active window of the mesh with a margin
+ *   covering the nodes that the water can reach in a time step.
+ * \param model
+ * \brief model struct.
+ */
+void model_active(Model *model)
 {
-	return (2 * node->Kx + fabs(node->u) * node->dx) / (node->dx * node->dx);
+	mesh_active(model->mesh, ACTIVE_MARGIN + 2 * model->implicit_iterations);
+}
+
+/**
+ * \fn void model_adapt(Model *model)
+ * \brief Function to adapt the refinement of an adaptive mesh, updating the
+ *   node parameters of the new mesh, the active window and the probes.
+ * \param model
+ * \brief model struct.
+ */
+void model_adapt(Model *model)
+{
+	Mesh *mesh = model->mesh;
+	if (!mesh_adapt(mesh, model->channel)) return;
+	mesh->na = mesh->n;
+	model_parameters(model);
+	model_active(model);
+	model_probes_locate(model);
+}
+
+/**
+ * \fn double model_1dt_max(Model *model)
+ * \brief Function to calculate the inverse of the allowed maximum time step
+ *   size of the surface flow model.
+ * \param model
+ * \brief model struct.
+ * \return inverse of the allowed maximum time step size.
+ */
+double model_1dt_max(Model *model)
+{
+#if SPECIALIZED_KERNELS
+	return model->model_kernel_1dt_max(model);
+#else
+	unsigned int i;
+	double dtmax;
+	Mesh *mesh = model->mesh;
+	dtmax = 0.;
+	if (mesh->na < PARALLEL_MINIMUM_NODES)
+		for (i = 0; i < mesh->na; ++i)
+			dtmax = fmax(dtmax, model->node_1dt_max(mesh, i));
+	else
+	{
+#pragma omp parallel for reduction(max:dtmax)
+		for (i = 0; i < mesh->na; ++i)
+			dtmax = fmax(dtmax, model->node_1dt_max(mesh, i));
+	}
+	return dtmax;
+#endif
 }
 
 /**
@@ -180,82 +757,208 @@ double model_node_diffusion_1dt_max(Node *node)
  */
 void model_step(Model *model)
 {
-	unsigned int i;
-	double dtmax;
+	unsigned int i, inlet;
+	double dtmax, dtinlet, t0 = 0.;
 	Mesh *mesh = model->mesh;
-	Node *node = mesh->node;
-	for (i = 0, dtmax = 0; i < mesh->n; ++i)
-		dtmax = fmax(dtmax, model->node_1dt_max(node + i));
+	Refinement *refinement = mesh->refinement;
+	Profile *profile = model->profile;
+	if (profile) t0 = profile_clock();
+	dtmax = model_1dt_max(model);
 	if (model->type_diffusion == 1)
 	{
-		for (i = 0, dtmax = 0; i < mesh->n; ++i)
-			dtmax = fmax(dtmax, model_node_diffusion_1dt_max(node + i));
+		dtmax = 0.;
+		if (mesh->na < PARALLEL_MINIMUM_NODES)
+			for (i = 0; i < mesh->na; ++i)
+				dtmax = fmax(dtmax, model_node_diffusion_1dt_max(mesh, i));
+		else
+		{
+#pragma omp parallel for reduction(max:dtmax)
+			for (i = 0; i < mesh->na; ++i)
+				dtmax = fmax(dtmax, model_node_diffusion_1dt_max(mesh, i));
+		}
 	}
 	dtmax = 1. / dtmax;
-	dtmax = model->cfl * fmin(dtmax, model->model_inlet_dtmax(model));
+	dtinlet = model->model_inlet_dtmax(model);
+	inlet = dtinlet < dtmax;
+	dtmax = model->cfl * fmin(dtmax, dtinlet);
+	if (model->multirate_levels) dtmax = model_multirate_levels(model, dtmax);
 	model->t2 = fmin(model->tfinal, model->t + dtmax);
 	model->dt = model->t2 - model->t;
 #if DEBUG_MODEL
 	printf("tmax=%lg t=%lg dt=%lg\n", model->t2, model->t, model->dt);
 #endif
+	if (profile) t0 = profile_phase(profile, PROFILE_PHASE_TIME_STEP, t0);
 	model->model_surface_flow(model);
 #if DEBUG_MODEL
 	printf("SURFACE FLOW mass: water=%lg solute=%lg\n",
 		mesh_water_mass(mesh), mesh_solute_mass(mesh));
 #endif
+	if (profile) t0 = profile_phase(profile, PROFILE_PHASE_SURFACE_FLOW, t0);
 	model->model_diffusion(model);
 #if DEBUG_MODEL
 	printf("DIFFUSION mass: water=%lg solute=%lg\n",
 		mesh_water_mass(mesh), mesh_solute_mass(mesh));
 #endif
+	if (profile) t0 = profile_phase(profile, PROFILE_PHASE_DIFFUSION, t0);
 	model_infiltration(model);
 #if DEBUG_MODEL
 	printf("INFILTRATION mass: water=%lg solute=%lg\n",
 		mesh_water_mass(mesh), mesh_solute_mass(mesh));
 #endif
+	if (profile) profile_phase(profile, PROFILE_PHASE_INFILTRATION, t0);
 	model_parameters(model);
 #if DEBUG_MODEL
 	printf("PARAMETERS mass: water=%lg solute=%lg\n",
 		mesh_water_mass(mesh), mesh_solute_mass(mesh));
 #endif
+	if (profile) t0 = profile_clock();
+	model_active(model);
 	model->t = model->t2;
+	if (profile) t0 = profile_phase(profile, PROFILE_PHASE_ACTIVE, t0);
+	if (refinement->levels && ++refinement->steps == refinement->interval)
+	{
+		refinement->steps = 0;
+		model_adapt(model);
+		if (profile) profile_phase(profile, PROFILE_PHASE_ADAPT, t0);
+	}
+	if (profile) profile_step(profile, model, inlet);
 }
 
 /**
- * \fn int model_read(Model *model, char *file_name)
- * \brief Function to read the numerical model.
+ * \fn unsigned int model_advance(Model *model, double t)
+ * \brief Function to advance the numerical model to a time, limited by the
+ *   final time, adjusting the last time step size to reach it.
  * \param model
  * \brief model struct.
- * \param file_name
- * \brief name of the input data file
+ * \param t
+ * \brief time to reach.
+ * \return number of time steps.
+ */
+unsigned int model_advance(Model *model, double t)
+{
+	unsigned int nsteps;
+	double tfinal;
+	tfinal = model->tfinal;
+	model->tfinal = fmin(t, tfinal);
+	for (nsteps = 0; model->t < model->tfinal; ++nsteps) model_step(model);
+	model->tfinal = tfinal;
+	return nsteps;
+}
+
+/**
+ * \fn double model_time(Model *model)
+ * \brief Function to get the actual time of the numerical model.
+ * \param model
+ * \brief model struct.
+ * \return actual time.
+ */
+double model_time(Model *model)
+{
+	return model->t;
+}
+
+/**
+ * \fn unsigned int model_nodes_number(Model *model)
+ * \brief Function to get the number of mesh nodes of the numerical model.
+ * \param model
+ * \brief model struct.
+ * \return number of mesh nodes.
+ */
+unsigned int model_nodes_number(Model *model)
+{
+	return model->mesh->n;
+}
+
+/**
+ * \fn unsigned int model_iterations(Model *model)
+ * \brief Function to get the number of nonlinear iterations of the last time
+ *   step of an implicit surface flow scheme.
+ * \param model
+ * \brief model struct.
+ * \return number of nonlinear iterations.
+ */
+unsigned int model_iterations(Model *model)
+{
+	return model->iterations;
+}
+
+/**
+ * \fn int model_variable(Model *model, unsigned int type, double *value)
+ * \brief Function to get the actual values of a variable at the mesh nodes.
+ * \param model
+ * \brief model struct.
+ * \param type
+ * \brief type of variable (MODEL_VARIABLE_* macros).
+ * \param value
+ * \brief array of variable values, with model_nodes_number elements.
  * \return 0 on error, 1 on success.
  */
-int model_read(Model *model, char *file_name)
+int model_variable(Model *model, unsigned int type, double *value)
 {
-	char *msg;
-	FILE *file;
+	unsigned int i;
+	Mesh *mesh = model->mesh;
+	Node *node = mesh->node;
+	switch (type)
+	{
+	case MODEL_VARIABLE_POSITION:
+		for (i = 0; i < mesh->n; ++i) value[i] = node[i].x;
+		break;
+	case MODEL_VARIABLE_AREA:
+	case MODEL_VARIABLE_DISCHARGE:
+	case MODEL_VARIABLE_SOLUTE:
+	case MODEL_VARIABLE_INFILTRATED_WATER:
+	case MODEL_VARIABLE_INFILTRATED_SOLUTE:
+		type -= MODEL_VARIABLE_AREA;
+		for (i = 0; i < mesh->n; ++i) value[i] = mesh->U[type][i];
+		break;
+	case MODEL_VARIABLE_DEPTH:
+		for (i = 0; i < mesh->n; ++i) value[i] = mesh->h[i];
+		break;
+	case MODEL_VARIABLE_LEVEL:
+		for (i = 0; i < mesh->n; ++i) value[i] = node[i].zs;
+		break;
+	case MODEL_VARIABLE_VELOCITY:
+		for (i = 0; i < mesh->n; ++i) value[i] = mesh->u[i];
+		break;
+	case MODEL_VARIABLE_CONCENTRATION:
+		for (i = 0; i < mesh->n; ++i) value[i] = node[i].s;
+		break;
+	default:
+		print_error("model: bad variable type");
+		return 0;
+	}
+	return 1;
+}
 
+/**
+ * \fn int model_read_stream(Model *model, FILE *file)
+ * \brief Function to read the numerical model from a stream.
+ * \param model
+ * \brief model struct.
+ * \param file
+ * \brief input data stream.
+ * \return 0 on error, 1 on success.
+ */
+int model_read_stream(Model *model, FILE *file)
+{
 #if DEBUG_MODEL
 	printf("Reading model\n");
 #endif
 
-	file = fopen(file_name, "r");
-	if (!file)
-	{
-		msg = "model: unable to open the input file";
-		goto bad;
-	}
+	memset(model, 0, sizeof(Model));
+	model->critical_depth_tolerance = CRITICAL_DEPTH_TOLERANCE;
 
-	if (!channel_read(model->channel, file)) goto bad;
+	if (!channel_read(model->channel, file)) return 0;
 	switch (model->channel->friction_model)
 	{
 	case 1:
 		model->node_friction = node_friction_Manning;
-		node_normal_discharge = node_normal_discharge_Manning;
+		model->node_normal_discharge = node_normal_discharge_Manning;
 		break;
 	case 2:
 		model->node_friction = node_friction_Manning_minimizing_losses;
-		node_normal_discharge = node_normal_discharge_Manning_minimizing_losses;
+		model->node_normal_discharge =
+			node_normal_discharge_Manning_minimizing_losses;
 	}
 	switch (model->channel->infiltration_model)
 	{
@@ -268,7 +971,7 @@ int model_read(Model *model, char *file_name)
 		model->node_diffusion = node_diffusion_Rutherford;
 	}
 
-	if (!mesh_read(model->mesh, model->channel, file)) goto bad;
+	if (!mesh_read(model->mesh, model->channel, file)) return 0;
 
 	model->model_inlet = model_inlet;
 	switch (model->channel->type_outlet)
@@ -289,32 +992,394 @@ int model_read(Model *model, char *file_name)
 		&model->type_diffusion,
 		&model->type_model) != 7)
 	{
-		msg = "model: bad data";
-		goto bad;
+		print_error("model: bad data");
+		return 0;
+	}
+
+	// optional parameters of the nonlinear iterations of the implicit schemes
+	// and of the local time stepping
+	if (fscanf(file, "%u", &model->implicit_iterations) == 1)
+	{
+		if (fscanf(file, "%lf", &model->implicit_tolerance) != 1)
+			model->implicit_tolerance = 0.;
+		else if (fscanf(file, "%u", &model->multirate_levels) == 1
+			&& model->multirate_levels > MULTIRATE_MAXIMUM_LEVELS)
+		{
+			print_error("model: bad local time stepping levels");
+			return 0;
+		}
 	}
 #if DEBUG_MODEL
 	printf("model:\n"
 		"tfinal=%lg interval=%lg cfl=%lg\n"
-		"type_surface_flow=%u type_model=%u\n",
+		"type_surface_flow=%u type_model=%u\n"
+		"implicit_iterations=%u implicit_tolerance=%lg multirate_levels=%u\n",
 		model->tfinal,
 		model->interval,
 		model->cfl,
 		model->type_surface_flow,
-		model->type_model);
+		model->type_model,
+		model->implicit_iterations,
+		model->implicit_tolerance,
+		model->multirate_levels);
+	printf("Model readed\n");
 #endif
+	return 1;
+}
 
+/**
+ * \fn int model_read(Model *model, char *file_name)
+ * \brief Function to read the numerical model.
+ * \param model
+ * \brief model struct.
+ * \param file_name
+ * \brief name of the input data file
+ * \return 0 on error, 1 on success.
+ */
+int model_read(Model *model, char *file_name)
+{
+	int ok;
+	FILE *file;
+	file = fopen(file_name, "r");
+	if (!file)
+	{
+		memset(model, 0, sizeof(Model));
+		print_error("model: unable to open the input file");
+		return 0;
+	}
+	ok = model_read_stream(model, file);
 	fclose(file);
-#if DEBUG_MODEL
-	printf("Model readed\n");
+	return ok;
+}
+
+/**
+ * \fn int model_read_memory(Model *model, char *data, size_t size)
+ * \brief Function to read the numerical model from a memory buffer with the
+ *   same format than the input data file.
+ * \param model
+ * \brief model struct.
+ * \param data
+ * \brief input data buffer.
+ * \param size
+ * \brief size of the input data buffer.
+ * \return 0 on error, 1 on success.
+ */
+int model_read_memory(Model *model, char *data, size_t size)
+{
+	int ok;
+	FILE *file;
+	file = fmemopen(data, size, "r");
+	if (!file)
+	{
+		memset(model, 0, sizeof(Model));
+		print_error("model: unable to read the input data buffer");
+		return 0;
+	}
+	ok = model_read_stream(model, file);
+	fclose(file);
+	return ok;
+}
+
+/**
+ * \fn int model_init(Model *model)
+ * \brief Function to init a read numerical model: selecting the functions of
+ *   the model and the numerical schemes and calculating the initial
+ *   parameters.
+ * \param model
+ * \brief model struct.
+ * \return 0 on error, 1 on success.
+ */
+int model_init(Model *model)
+{
+	char *msg;
+
+	model->theta = 1.;
+
+	switch (model->type_model)
+	{
+	case 1:
+		model->model_node_parameters_centre
+			= model->model_node_parameters_right
+			= model->model_node_parameters_left
+			= model_node_parameters_hydrodynamic;
+		model->node_1dt_max = node_1dt_max_hydrodynamic;
+		model->model_inlet_dtmax = model_inlet_dtmax_hydrodynamic;
+#if SPECIALIZED_KERNELS
+		if (model->channel->friction_model == 1)
+			model->model_kernel_parameters
+				= model_parameters_hydrodynamic_Manning;
+		else
+			model->model_kernel_parameters
+				= model_parameters_hydrodynamic_Manning_minimizing_losses;
+		model->model_kernel_1dt_max = model_1dt_max_hydrodynamic;
+#endif
+		goto hydrodynamic;
+	case 2:
+		model->model_node_parameters_centre
+			= model->model_node_parameters_right
+			= model->model_node_parameters_left
+			= model_node_parameters_zero_advection;
+		model->node_1dt_max = node_1dt_max_zero_advection;
+		model->model_inlet_dtmax = model_inlet_dtmax_zero_advection;
+#if SPECIALIZED_KERNELS
+		if (model->channel->friction_model == 1)
+			model->model_kernel_parameters
+				= model_parameters_zero_advection_Manning;
+		else
+			model->model_kernel_parameters
+				= model_parameters_zero_advection_Manning_minimizing_losses;
+		model->model_kernel_1dt_max = model_1dt_max_zero_advection;
+#endif
+		goto zero_advection;
+	case 3:
+		model->node_discharge_centre = node_discharge_centre_zero_inertia;
+		model->node_discharge_right = node_discharge_right_zero_inertia;
+		model->node_discharge_left = node_discharge_left_zero_inertia;
+		model->model_node_parameters_centre
+			= model_node_parameters_centre_zero_inertia;
+		model->model_node_parameters_right
+			= model_node_parameters_right_zero_inertia;
+		model->model_node_parameters_left
+			= model_node_parameters_left_zero_inertia;
+		model->node_1dt_max = node_1dt_max_zero_inertia;
+		model->model_inlet_dtmax = model_inlet_dtmax_zero_inertia;
+#if SPECIALIZED_KERNELS
+		if (model->channel->friction_model == 1)
+			model->model_kernel_parameters
+				= model_parameters_zero_inertia_Manning;
+		else
+			model->model_kernel_parameters
+				= model_parameters_zero_inertia_Manning_minimizing_losses;
+		model->model_kernel_1dt_max = model_1dt_max_zero_inertia;
+#endif
+		goto zero_inertia;
+	case 4:
+		model->node_discharge_centre = node_discharge_centre_kinematic;
+		model->node_discharge_right = node_discharge_right_kinematic;
+		model->node_discharge_left = node_discharge_left_kinematic;
+		model->model_node_parameters_centre
+			= model_node_parameters_centre_kinematic;
+		model->model_node_parameters_right
+			= model_node_parameters_right_kinematic;
+		model->model_node_parameters_left
+			= model_node_parameters_left_kinematic;
+		model->node_1dt_max = node_1dt_max_kinematic;
+		model->model_inlet_dtmax = model_inlet_dtmax_kinematic;
+#if SPECIALIZED_KERNELS
+		if (model->channel->friction_model == 1)
+			model->model_kernel_parameters
+				= model_parameters_kinematic_Manning;
+		else
+			model->model_kernel_parameters
+				= model_parameters_kinematic_Manning_minimizing_losses;
+		model->model_kernel_1dt_max = model_1dt_max_kinematic;
+#endif
+		goto kinematic;
+	default:
+		msg = "model: bad type";
+		goto bad;
+	}
+
+hydrodynamic:
+	switch (model->type_surface_flow)
+	{
+	case 1:
+		model->model_surface_flow = model_surface_flow_hydrodynamic_upwind;
+		model->model_interface
+			= model_surface_flow_hydrodynamic_upwind_interface;
+		goto calculate;
+	case 2:
+		model->model_surface_flow =
+			model_surface_flow_hydrodynamic_LaxFriedrichs;
+		model->model_interface
+			= model_surface_flow_hydrodynamic_LaxFriedrichs_interface;
+		goto calculate;
+	case 3:
+		model->model_surface_flow = model_surface_flow_hydrodynamic_implicit;
+		if (!model->implicit_iterations) model->implicit_iterations = 2;
+		goto calculate;
+	case 4:
+		model->model_surface_flow = model_surface_flow_hydrodynamic_tvd;
+		model->model_interface = model_surface_flow_hydrodynamic_tvd_interface;
+		model->model_interface_high_order
+			= model_surface_flow_hydrodynamic_tvd_high_order;
+		model->model_node_gather = model_node_gather_hydrodynamic_tvd;
+		goto calculate;
+	default:
+		msg = "model: bad surface flow type";
+		goto bad;
+	}
+
+zero_advection:
+	switch (model->type_surface_flow)
+	{
+	case 1:
+		model->model_surface_flow = model_surface_flow_zero_advection_upwind;
+		model->model_interface
+			= model_surface_flow_zero_advection_upwind_interface;
+		goto calculate;
+	case 2:
+		model->model_surface_flow =
+			model_surface_flow_zero_advection_LaxFriedrichs;
+		model->model_interface
+			= model_surface_flow_zero_advection_LaxFriedrichs_interface;
+		goto calculate;
+	case 3:
+		model->model_surface_flow = model_surface_flow_zero_advection_implicit;
+		if (!model->implicit_iterations) model->implicit_iterations = 2;
+		goto calculate;
+	default:
+		msg = "model: bad surface flow type";
+		goto bad;
+	}
+
+zero_inertia:
+	switch (model->type_surface_flow)
+	{
+	case 1:
+		model->model_surface_flow = model_surface_flow_zero_inertia_upwind;
+		break;
+//	case 2:
+//		model->model_surface_flow = model_surface_flow_zero_inertia_LaxFriedrichs;
+//		break;
+	case 3:
+		model->model_surface_flow = model_surface_flow_zero_inertia_implicit;
+		if (!model->implicit_iterations) model->implicit_iterations = 1;
+		model->node_1dt_max = node_1dt_max_hydrodynamic;
+#if SPECIALIZED_KERNELS
+		model->model_kernel_1dt_max = model_1dt_max_hydrodynamic;
+#endif
+		goto calculate;
+	default:
+		msg = "model: bad surface flow type";
+		goto bad;
+	}
+
+kinematic:
+	switch (model->type_surface_flow)
+	{
+	case 1:
+		model->model_surface_flow = model_surface_flow_kinematic_upwind;
+		break;
+//	case 2:
+//		model->model_surface_flow = model_surface_flow_kinematic_LaxFriedrichs;
+//		break;
+	case 3:
+		model->model_surface_flow = model_surface_flow_kinematic_implicit;
+		if (!model->implicit_iterations) model->implicit_iterations = 1;
+		goto calculate;
+	default:
+		msg = "model: bad surface flow type";
+		goto bad;
+	}
+
+calculate:
+	switch (model->type_diffusion)
+	{
+	case 1:
+		model->model_diffusion = model_diffusion_explicit;
+		break;
+	case 2:
+		model->model_diffusion = model_diffusion_implicit;
+		break;
+	default:
+		msg = "model: bad diffusion type";
+		goto bad;
+	}
+
+#if RUNGE_KUTTA_ORDER > 1
+	// Runge-Kutta stages of the explicit upwind and TVD schemes of the
+	// hydrodynamic model
+	if (model->type_model == 1
+		&& (model->type_surface_flow == 1 || model->type_surface_flow == 4))
+	{
+		model->model_surface_flow_stage = model->model_surface_flow;
+		model->model_surface_flow = model_surface_flow_runge_kutta;
+		model->model_interface = NULL;
+	}
 #endif
+
+	// local time stepping, only with the explicit schemes calculating the flux
+	// differences by cell interface and not with an explicit diffusion scheme
+	// limiting the time step size of every node, else all the nodes advance
+	// with the same time step size
+	if (model->multirate_levels)
+	{
+		if (model->model_interface && model->type_diffusion == 2)
+			model->model_surface_flow = model_surface_flow_multirate;
+		else model->multirate_levels = 0;
+	}
+
+	// workspace of the tridiagonal systems with a right hand side by solute
+	if (!tridiagonal_open(model->tridiagonal, model->mesh->nmax, 1)) return 0;
+
+	// init model parameters
+	model->t = 0.;
+	model_parameters(model);
+	model_active(model);
+
+	// an adaptive mesh starts at the maximum level and is adapted to the
+	// initial conditions
+	if (model->mesh->refinement->levels) model_adapt(model);
 	return 1;
 
 bad:
-	if (file) fclose(file);
 	print_error(msg);
 	return 0;
 }
 
+/**
+ * \fn int model_open(Model *model, char *file_name)
+ * \brief Function to open a numerical model: reading the input data file and
+ *   initing the model.
+ *
+ * All the model state is stored in the model struct, so different models can
+ * be simulated concurrently in different threads. The model is advanced in
+ * time with model_step or model_advance and its memory is freed with
+ * model_delete.
+ * \param model
+ * \brief model struct.
+ * \param file_name
+ * \brief name of the input data file
+ * \return 0 on error, 1 on success.
+ */
+int model_open(Model *model, char *file_name)
+{
+	return model_read(model, file_name) && model_init(model);
+}
+
+/**
+ * \fn int model_open_memory(Model *model, char *data, size_t size)
+ * \brief Function to open a numerical model from a memory buffer with the same
+ *   format than the input data file.
+ * \param model
+ * \brief model struct.
+ * \param data
+ * \brief input data buffer.
+ * \param size
+ * \brief size of the input data buffer.
+ * \return 0 on error, 1 on success.
+ */
+int model_open_memory(Model *model, char *data, size_t size)
+{
+	return model_read_memory(model, data, size) && model_init(model);
+}
+
+/**
+ * \fn void model_delete(Model *model)
+ * \brief Function to free the memory used by a numerical model.
+ * \param model
+ * \brief model struct.
+ */
+void model_delete(Model *model)
+{
+	free(model->probes->x);
+	free(model->probes->node);
+	tridiagonal_delete(model->tridiagonal);
+	mesh_delete(model->mesh);
+	channel_delete(model->channel);
+}
+
 /**
  * \fn void model_print(Model *model, unsigned int nsteps)
  * \brief Function to print a model stat.
@@ -326,69 +1391,205 @@ bad:
 void model_print(Model *model, unsigned int nsteps)
 {
 	printf(
-		"main: steps number=%u t=%.14lg water mass=%.14lg solute mass=%.14lg\n",
+		"main: steps number=%u t=%.14lg water mass=%.14lg solute mass=%.14lg",
 		nsteps,
 		model->t,
 		mesh_water_mass(model->mesh),
 		mesh_solute_mass(model->mesh));
+	if (model->iterations_number)
+		printf(" implicit iterations=%u", model->iterations_number);
+	printf("\n");
 }
 
 /**
- * \fn void model_write_advance(Model *model, FILE *file)
- * \brief Function to write in a file the channel water advance.
+ * \fn int model_checkpoint_write(Model *model, char *name)
+ * \brief Function to write the state of a numerical model in a binary
+ *   checkpoint file.
+ *
+ * The file is written with a temporary name and renamed at the end, so a
+ * former checkpoint file is not lost if the simulation is interrupted while
+ * writing.
  * \param model
  * \brief model struct.
- * \param file
- * \brief output file.
+ * \param name
+ * \brief checkpoint file name.
+ * \return 0 on error, 1 on success.
  */
-void model_write_advance(Model *model, FILE *file)
+int model_checkpoint_write(Model *model, char *name)
 {
-	unsigned int i;
+	unsigned int i, j, header[6];
+	double v[6];
+	char buffer[strlen(name) + 5];
 	Mesh *mesh = model->mesh;
-	Node *node;
+	FILE *file;
+	snprintf(buffer, sizeof(buffer), "%s.tmp", name);
+	file = fopen(buffer, "wb");
+	if (!file) goto bad;
+	header[0] = MODEL_CHECKPOINT_VERSION;
+	header[1] = mesh->n;
+	header[2] = model->type_model;
+	header[3] = model->type_surface_flow;
+	header[4] = model->type_diffusion;
+	header[5] = model->iterations_number;
+	fwrite(MODEL_CHECKPOINT_MAGIC, 1, 8, file);
+	fwrite(header, sizeof(unsigned int), 6, file);
+	fwrite(&model->t, sizeof(double), 1, file);
+	fwrite(model->inlet_contribution, sizeof(double), 3, file);
+	fwrite(model->outlet_contribution, sizeof(double), 3, file);
+	if (mesh->refinement->levels)
+	{
+		fwrite(mesh->refinement->level, sizeof(unsigned int),
+			mesh->refinement->n - 1, file);
+		fwrite(&mesh->refinement->steps, sizeof(unsigned int), 1, file);
+	}
 	for (i = 0; i < mesh->n; ++i)
 	{
-		node = mesh->node + i;
-		if (node->U[0] == 0) break;
+		for (j = 0; j < 5; ++j) v[j] = mesh->U[j][i];
+		v[5] = mesh->c[i];
+		fwrite(v, sizeof(double), 6, file);
 	}
-	if (i) --i;
-	fprintf(file, "%lg %lg\n", model->t, mesh->node[i].x);
+	if (fclose(file)) goto bad;
+#ifdef _WIN32
+	remove(name);
+#endif
+	if (rename(buffer, name)) goto bad;
+	return 1;
+
+bad:
+	print_error("model: unable to write the checkpoint file");
+	return 0;
 }
 
 /**
- * \fn int model_probes_read(Model *model, char *name)
- * \brief Function to read the model probes in a file.
+ * \fn int model_checkpoint_read(Model *model, char *name)
+ * \brief Function to restore the state of an opened numerical model from a
+ *   binary checkpoint file.
+ *
+ * The model has to be opened with the same input data file used to write the
+ * checkpoint file. The derived node variables are recalculated, excepting the
+ * critical velocity, saved because the boundary conditions of some schemes
+ * use the value of the former time step. The nodes of an adaptive mesh are
+ * rebuilt from the saved refinement levels and the time steps since the last
+ * adaptation are restored, so the next adaptation keeps its time step.
  * \param model
  * \brief model struct.
  * \param name
- * \brief input file name.
+ * \brief checkpoint file name.
  * \return 0 on error, 1 on success.
  */
-int model_probes_read(Model *model, char *name)
+int model_checkpoint_read(Model *model, char *name)
 {
-	unsigned int i, j, k;
-	double d, dmin, *x;
-	char *msg;
+	unsigned int i, j, steps, header[6], *level;
+	double *x, v[6];
+	char magic[8], *msg;
+	Mesh *mesh = model->mesh;
+	Refinement *refinement = mesh->refinement;
 	FILE *file;
-	Probes *probes = model->probes;
-	Node *node = model->mesh->node;
-	file = fopen(name, "r");
+	file = fopen(name, "rb");
 	if (!file)
 	{
-		msg = "probes: unable to open the input file";
+		msg = "model: unable to open the checkpoint file";
+		goto bad;
+	}
+	msg = "model: bad checkpoint file";
+	if (fread(magic, 1, 8, file) != 8
+		|| memcmp(magic, MODEL_CHECKPOINT_MAGIC, 8)
+		|| fread(header, sizeof(unsigned int), 6, file) != 6
+		|| header[0] != MODEL_CHECKPOINT_VERSION)
+		goto bad2;
+	if (header[1] > mesh->nmax || header[2] != model->type_model
+		|| header[3] != model->type_surface_flow
+		|| header[4] != model->type_diffusion)
+	{
+		msg = "model: checkpoint file of a different model";
+		goto bad2;
+	}
+	if (fread(&model->t, sizeof(double), 1, file) != 1
+		|| fread(model->inlet_contribution, sizeof(double), 3, file) != 3
+		|| fread(model->outlet_contribution, sizeof(double), 3, file) != 3)
+		goto bad2;
+	if (refinement->levels)
+	{
+		// rebuilding the nodes of an adaptive mesh
+		x = (double*)malloc(mesh->nmax * sizeof(double));
+		if (!x || fread(x, sizeof(unsigned int), refinement->n - 1, file)
+			!= refinement->n - 1) goto bad3;
+		level = (unsigned int*)x;
+		for (i = 0; i < refinement->n - 1; ++i)
+			if (level[i] > refinement->levels) goto bad3;
+		if (fread(&steps, sizeof(unsigned int), 1, file) != 1
+			|| steps >= refinement->interval) goto bad3;
+		memcpy(refinement->level, level,
+			(refinement->n - 1) * sizeof(unsigned int));
+		refinement->steps = steps;
+		mesh->n = mesh_refined(mesh, x);
+		mesh_nodes(mesh, model->channel, x);
+		free(x);
+		model_probes_locate(model);
+	}
+	if (header[1] != mesh->n)
+	{
+		msg = "model: checkpoint file of a different model";
 		goto bad2;
 	}
-	if (fscanf(file, "%u", &probes->n) != 1) goto bad;
-	probes->x = x = (double*)malloc(probes->n * sizeof(double));
-	probes->node = (unsigned int*)malloc(probes->n * sizeof(int));
+	for (i = 0; i < mesh->n; ++i)
+	{
+		if (fread(v, sizeof(double), 6, file) != 6) goto bad2;
+		for (j = 0; j < 5; ++j) mesh->U[j][i] = v[j];
+		mesh->c[i] = v[5];
+	}
+	fclose(file);
+	model->iterations_number = header[5];
+
+	// updating the parameters of the whole mesh and the active window
+	mesh->na = mesh->n;
+	model_parameters(model);
+	model_active(model);
+	return 1;
+
+bad3:
+	free(x);
+bad2:
+	fclose(file);
+bad:
+	print_error(msg);
+	return 0;
+}
+
+/**
+ * \fn void model_write_advance_header(Model *model, FILE *file)
+ * \brief Function to write the header of a binary file of the channel water
+ *   advance.
+ * \param model
+ * \brief model struct.
+ * \param file
+ * \brief output file.
+ */
+void model_write_advance_header(Model *model, FILE *file)
+{
+	char *name[2] = {"t", "x"};
+	binary_write_header(file, 0, 2, 0, name);
+}
+
+/**
+ * \fn void model_probes_locate(Model *model)
+ * \brief Function to locate the nearest mesh nodes to the model probes.
+ * \param model
+ * \brief model struct.
+ */
+void model_probes_locate(Model *model)
+{
+	unsigned int i, j, k;
+	double d, dmin;
+	Probes *probes = model->probes;
+	Node *node = model->mesh->node;
 	for (i = 0; i < probes->n; ++i)
 	{
-		if (fscanf(file, "%lf", x + i) != 1) goto bad;
 		k = 0;
-		dmin = fabs(x[i] - node[0].x);
+		dmin = fabs(probes->x[i] - node[0].x);
 		for (j = 0; ++j < model->mesh->n;)
 		{
-			d = fabs(x[i] - node[j].x);
+			d = fabs(probes->x[i] - node[j].x);
 			if (d < dmin)
 			{
 				dmin = d;
@@ -397,10 +1598,74 @@ int model_probes_read(Model *model, char *name)
 		}
 		probes->node[i] = k;
 	}
+}
+
+/**
+ * \fn int model_probes_set(Model *model, unsigned int n, double *x)
+ * \brief Function to set the model probes.
+ * \param model
+ * \brief model struct.
+ * \param n
+ * \brief number of probes.
+ * \param x
+ * \brief array of x-coordinates of the probes.
+ * \return 0 on error, 1 on success.
+ */
+int model_probes_set(Model *model, unsigned int n, double *x)
+{
+	unsigned int i;
+	Probes *probes = model->probes;
+	free(probes->x);
+	free(probes->node);
+	probes->n = n;
+	probes->x = (double*)malloc(n * sizeof(double));
+	probes->node = (unsigned int*)malloc(n * sizeof(int));
+	if (n && (!probes->x || !probes->node))
+	{
+		probes->n = 0;
+		print_error("probes: not enough memory");
+		return 0;
+	}
+	for (i = 0; i < n; ++i) probes->x[i] = x[i];
+	model_probes_locate(model);
 	return 1;
+}
+
+/**
+ * \fn int model_probes_read(Model *model, char *name)
+ * \brief Function to read the model probes in a file.
+ * \param model
+ * \brief model struct.
+ * \param name
+ * \brief input file name.
+ * \return 0 on error, 1 on success.
+ */
+int model_probes_read(Model *model, char *name)
+{
+	unsigned int i, n;
+	int ok;
+	double *x = NULL;
+	char *msg;
+	FILE *file;
+	file = fopen(name, "r");
+	if (!file)
+	{
+		msg = "probes: unable to open the input file";
+		goto bad2;
+	}
+	if (fscanf(file, "%u", &n) != 1) goto bad;
+	x = (double*)malloc(n * sizeof(double));
+	if (n && !x) goto bad;
+	for (i = 0; i < n; ++i)
+		if (fscanf(file, "%lf", x + i) != 1) goto bad;
+	fclose(file);
+	ok = model_probes_set(model, n, x);
+	free(x);
+	return ok;
 
 bad:
 	msg = "probes: bad data";
+	free(x);
 	fclose(file);
 
 bad2:
@@ -409,29 +1674,70 @@ bad2:
 }
 
 /**
- * \fn void model_write_probes(Model *model, FILE *file)
- * \brief Function to write the model probes in a file.
+ * \fn void model_probes_values(Model *model, double *h, double *s)
+ * \brief Function to get the actual depths and solute concentrations at the
+ *   model probes.
  * \param model
  * \brief model struct.
- * \param file
- * \brief output file.
+ * \param h
+ * \brief array of depths of the probes.
+ * \param s
+ * \brief array of solute concentrations of the probes.
  */
-void model_write_probes(Model *model, FILE *file)
+void model_probes_values(Model *model, double *h, double *s)
 {
 	unsigned int i;
 	Probes *probes = model->probes;
-	Node *node;
-
-	// writing the time
-	fprintf(file, "%lg ", model->t);
+	Mesh *mesh = model->mesh;
 	for (i = 0; i < probes->n; ++i)
 	{
-		//writing the depth and the concentration of the i-th probe
-		node = model->mesh->node + probes->node[i];
-		fprintf(file, "%lg %lg ", node->h, node->s);
+		h[i] = mesh->h[probes->node[i]];
+		s[i] = mesh->node[probes->node[i]].s;
+	}
+}
+
+/**
+ * \fn void model_write_probes_header(Model *model, FILE *file)
+ * \brief Function to write the header of a binary file of the model probes.
+ * \param model
+ * \brief model struct.
+ * \param file
+ * \brief output file.
+ */
+void model_write_probes_header(Model *model, FILE *file)
+{
+	unsigned int i, n;
+	n = 1 + 2 * model->probes->n;
+	char buffer[n][BINARY_NAME_LENGTH], *name[n];
+	name[0] = "t";
+	for (i = 1; i < n; ++i)
+	{
+		snprintf(buffer[i], BINARY_NAME_LENGTH, "%c%u",
+			(i & 1) ? 'h' : 's', (i + 1) / 2);
+		name[i] = buffer[i];
+	}
+	binary_write_header(file, 0, n, 0, name);
+}
+
+/**
+ * \fn double model_inlet_critical_depth(Model *model, double Q)
+ * \brief Function to calculate the critical depth at the inlet, saved while
+ *   the inlet discharge does not change.
+ * \param model
+ * \brief model struct.
+ * \param Q
+ * \brief inlet discharge.
+ * \return critical depth.
+ */
+double model_inlet_critical_depth(Model *model, double Q)
+{
+	if (Q != model->inlet_discharge)
+	{
+		model->inlet_discharge = Q;
+		model->inlet_critical_depth = node_critical_depth(model->mesh->node, Q,
+			model->critical_depth_tolerance);
 	}
-	// writing a new row
-	fprintf(file, "\n");
+	return model->inlet_critical_depth;
 }
 
 /**
@@ -460,8 +1766,8 @@ void model_inlet(Model *model)
 */
 void model_outlet_closed(Model *model)
 {
-	Node *node = model->mesh->node + model->mesh->n - 1;
-	node->U[1] = 0.;
+	Mesh *mesh = model->mesh;
+	mesh->U[1][mesh->n - 1] = 0.;
 	model->outlet_contribution[0] = - model->outlet_contribution[0];
 	model->outlet_contribution[1] = - model->outlet_contribution[1];
 	model->outlet_contribution[2] = - model->outlet_contribution[2];
@@ -475,11 +1781,12 @@ void model_outlet_closed(Model *model)
  */
 void model_outlet_open(Model *model)
 {
-	Node *node = model->mesh->node + model->mesh->n - 1;
-	node_depth(node);
-	node_width(node);
-	node_critical_velocity(node);
-	node->U[1] = fmax(node->U[1], node->U[0] * node->c);
+	Mesh *mesh = model->mesh;
+	unsigned int i = mesh->n - 1;
+	node_depth(mesh, i);
+	node_width(mesh, i);
+	node_critical_velocity(mesh, i);
+	mesh->U[1][i] = fmax(mesh->U[1][i], mesh->U[0][i] * mesh->c[i]);
 	model->outlet_contribution[0] = model->outlet_contribution[1] =
 		model->outlet_contribution[2] = 0.;
 }
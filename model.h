@@ -37,6 +37,48 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef MODEL__H
 #define MODEL__H 1
 
+/**
+ * \def MODEL_VARIABLE_POSITION
+ * \brief position of the mesh nodes.
+ * \def MODEL_VARIABLE_AREA
+ * \brief wetted cross sectional area.
+ * \def MODEL_VARIABLE_DISCHARGE
+ * \brief discharge.
+ * \def MODEL_VARIABLE_SOLUTE
+ * \brief surface solute by length unit.
+ * \def MODEL_VARIABLE_INFILTRATED_WATER
+ * \brief infiltrated water by length unit.
+ * \def MODEL_VARIABLE_INFILTRATED_SOLUTE
+ * \brief infiltrated solute by length unit.
+ * \def MODEL_VARIABLE_DEPTH
+ * \brief depth.
+ * \def MODEL_VARIABLE_LEVEL
+ * \brief surface level.
+ * \def MODEL_VARIABLE_VELOCITY
+ * \brief velocity.
+ * \def MODEL_VARIABLE_CONCENTRATION
+ * \brief surface solute concentration.
+ */
+#define MODEL_VARIABLE_POSITION 0
+#define MODEL_VARIABLE_AREA 1
+#define MODEL_VARIABLE_DISCHARGE 2
+#define MODEL_VARIABLE_SOLUTE 3
+#define MODEL_VARIABLE_INFILTRATED_WATER 4
+#define MODEL_VARIABLE_INFILTRATED_SOLUTE 5
+#define MODEL_VARIABLE_DEPTH 6
+#define MODEL_VARIABLE_LEVEL 7
+#define MODEL_VARIABLE_VELOCITY 8
+#define MODEL_VARIABLE_CONCENTRATION 9
+
+/**
+ * \def MODEL_CHECKPOINT_MAGIC
+ * \brief identifier of the checkpoint files.
+ * \def MODEL_CHECKPOINT_VERSION
+ * \brief version of the checkpoint files format.
+ */
+#define MODEL_CHECKPOINT_MAGIC "SWOCSCKP"
+#define MODEL_CHECKPOINT_VERSION 2
+
 /**
  * \struct _Probes
  * \brief Struct to define probes to save the evolution of the variables at a
@@ -74,6 +116,8 @@ struct _Model
  * \brief channel struct.
  * \var probes
  * \brief probes struct.
+ * \var tridiagonal
+ * \brief workspace of the tridiagonal systems of the implicit schemes.
  * \var t
  * \brief actual time.
  * \var t2 
@@ -90,6 +134,17 @@ struct _Model
  * \brief time interval to save the data.
  * \var minimum_depth
  * \brief minimum depth allowing the water movement.
+ * \var critical_depth_tolerance
+ * \brief relative accuracy calculating the critical depth.
+ * \var inlet_discharge
+ * \brief inlet discharge of the saved inlet critical depth.
+ * \var inlet_critical_depth
+ * \brief saved inlet critical depth.
+ * \var implicit_tolerance
+ * \brief tolerance of the nonlinear iterations of the implicit schemes (0 to
+ *   make always the maximum number of iterations).
+ * \var residual
+ * \brief residual of the last nonlinear iteration of the implicit schemes.
  * \var inlet_contribution
  * \brief inlet contribution vector to ensure global conservation.
  * \var outlet_contribution
@@ -118,6 +173,9 @@ struct _Model
  * \var node_discharge_left
  * \brief pointer to the function calculating the node discharge in an left
  *   upwind form.
+ * \var node_normal_discharge
+ * \brief pointer to the function calculating the node normal discharge with
+ *   the friction model.
  * \var node_friction
  * \brief pointer to the function calculating the node friction.
  * \var node_infiltration
@@ -130,36 +188,85 @@ struct _Model
  * \brief pointer to the function calculating the outlet.
  * \var model_surface_flow
  * \brief pointer to the function defining the numerical surface flow scheme.
+ * \var model_surface_flow_stage
+ * \brief pointer to the function making a forward Euler stage of the
+ *   numerical surface flow scheme (only with RUNGE_KUTTA_ORDER > 1).
  * \var model_diffusion
  * \brief pointer to the function defining the numerical diffusion scheme.
+ * \var model_interface
+ * \brief pointer to the function calculating the flux differences of a cell
+ *   interface with the explicit scheme (NULL if the scheme can not make local
+ *   time steps).
+ * \var model_interface_high_order
+ * \brief pointer to the function adding the high order fluxes to the flux
+ *   differences of a cell interface with local time stepping (NULL for a first
+ *   order scheme).
+ * \var model_node_gather
+ * \brief pointer to the function gathering the node parameters read by the
+ *   cell interfaces after updating them with local time stepping (NULL if the
+ *   scheme reads them from the nodes).
+ * \var model_kernel_parameters
+ * \brief pointer to the specialized function calculating the model parameters
+ *   (only with SPECIALIZED_KERNELS).
+ * \var model_kernel_1dt_max
+ * \brief pointer to the specialized function calculating the inverse of the
+ *   allowed maximum time step size (only with SPECIALIZED_KERNELS).
+ * \var profile
+ * \brief pointer to the profile struct instrumenting the model (NULL if not
+ *   profiled).
  * \var type_surface_flow
  * \brief type of numerical surface flow scheme (1 McCormack, 2 upwind).
  * \var type_diffusion
  * \brief type of numerical diffusion scheme (1 explicit, 2 implicit).
  * \var type_model
  * \brief type of model (1 hydrodynamic, 2 zero-inertia, 3 diffusive, 4 kinematic).
+ * \var implicit_iterations
+ * \brief maximum number of nonlinear iterations of the implicit schemes.
+ * \var iterations
+ * \brief number of nonlinear iterations of the last time step.
+ * \var iterations_number
+ * \brief total number of nonlinear iterations.
+ * \var multirate_levels
+ * \brief maximum number of time step levels of the local time stepping (0 to
+ *   advance all the nodes with the same time step size).
+ * \var multirate_level
+ * \brief maximum time step level of the actual time step with local time
+ *   stepping.
 */
 	Mesh mesh[1];
 	Channel channel[1];
 	Probes probes[1];
+	Tridiagonal tridiagonal[1];
 	double t, t2, dt, tfinal, cfl, theta, interval, minimum_depth,
+		critical_depth_tolerance, inlet_discharge, inlet_critical_depth,
+		implicit_tolerance, residual,
 		inlet_contribution[3], outlet_contribution[3];
-	void (*model_node_parameters_centre)(struct _Model *model, Node *node);
-	void (*model_node_parameters_right)(struct _Model *model, Node *node);
-	void (*model_node_parameters_left)(struct _Model *model, Node *node);
-	double (*node_1dt_max)(Node *node);
+	void (*model_node_parameters_centre)(struct _Model *model, unsigned int i);
+	void (*model_node_parameters_right)(struct _Model *model, unsigned int i);
+	void (*model_node_parameters_left)(struct _Model *model, unsigned int i);
+	double (*node_1dt_max)(Mesh *mesh, unsigned int i);
 	double (*model_inlet_dtmax)(struct _Model *model);
-	void (*node_discharge_centre)(Node *node);
-	void (*node_discharge_right)(Node *node);
-	void (*node_discharge_left)(Node *node);
-	void (*node_friction)(Node *node);
-	void (*node_infiltration)(Node *node);
-	void (*node_diffusion)(Node *node);
+	void (*node_discharge_centre)(struct _Model *model, unsigned int i);
+	void (*node_discharge_right)(struct _Model *model, unsigned int i);
+	void (*node_discharge_left)(struct _Model *model, unsigned int i);
+	double (*node_normal_discharge)(Mesh *mesh, unsigned int i, double S);
+	void (*node_friction)(Mesh *mesh, unsigned int i);
+	void (*node_infiltration)(Mesh *mesh, unsigned int i);
+	void (*node_diffusion)(Mesh *mesh, unsigned int i);
 	void (*model_inlet)(struct _Model *model);
 	void (*model_outlet)(struct _Model *model);
 	void (*model_surface_flow)(struct _Model *model);
+	void (*model_surface_flow_stage)(struct _Model *model);
 	void (*model_diffusion)(struct _Model *model);
-	unsigned int type_surface_flow, type_diffusion, type_model;
+	void (*model_interface)(struct _Model *model, unsigned int i);
+	void (*model_interface_high_order)(struct _Model *model, unsigned int i);
+	void (*model_node_gather)(struct _Model *model, unsigned int i);
+	void (*model_kernel_parameters)(struct _Model *model);
+	double (*model_kernel_1dt_max)(struct _Model *model);
+	struct _Profile *profile;
+	unsigned int type_surface_flow, type_diffusion, type_model,
+		implicit_iterations, iterations, iterations_number, multirate_levels,
+		multirate_level;
 };
 
 /**
@@ -167,19 +274,111 @@ struct _Model
  */
 typedef struct _Model Model;
 
+/**
+ * \def MODEL_PARAMETERS_KERNEL
+ * \brief Macro template defining a function to calculate the model parameters
+ *   with direct calls to the node functions, so they can be inlined.
+ * \param name
+ * \brief name of the defined function.
+ * \param parameters_right
+ * \brief function calculating the node parameters in a right upwind form.
+ * \param parameters_centre
+ * \brief function calculating the node parameters in a centred form.
+ * \param parameters_left
+ * \brief function calculating the node parameters in a left upwind form.
+ */
+#define MODEL_PARAMETERS_KERNEL(name, parameters_right, parameters_centre, \
+	parameters_left) \
+void name(Model *model) \
+{ \
+	unsigned int i, n1; \
+	Mesh *mesh = model->mesh; \
+	n1 = mesh->na - 1; \
+	if (mesh->na < PARALLEL_MINIMUM_NODES) \
+	{ \
+		for (i = 0; i < mesh->na; ++i) node_depth(mesh, i); \
+		parameters_right(model, 0); \
+		for (i = 1; i < n1; ++i) parameters_centre(model, i); \
+	} \
+	else \
+	{ \
+_Pragma("omp parallel for") \
+		for (i = 0; i < mesh->na; ++i) node_depth(mesh, i); \
+		parameters_right(model, 0); \
+_Pragma("omp parallel for") \
+		for (i = 1; i < n1; ++i) parameters_centre(model, i); \
+	} \
+	parameters_left(model, n1); \
+}
+
+/**
+ * \def MODEL_1DT_MAX_KERNEL
+ * \brief Macro template defining a function to calculate the inverse of the
+ *   allowed maximum time step size with a direct call to the node function.
+ * \param name
+ * \brief name of the defined function.
+ * \param node_1dt_max
+ * \brief function calculating the inverse of the allowed maximum time step
+ *   size in a node.
+ */
+#define MODEL_1DT_MAX_KERNEL(name, node_1dt_max) \
+double name(Model *model) \
+{ \
+	unsigned int i; \
+	double dtmax = 0.; \
+	Mesh *mesh = model->mesh; \
+	if (mesh->na < PARALLEL_MINIMUM_NODES) \
+		for (i = 0; i < mesh->na; ++i) \
+			dtmax = fmax(dtmax, node_1dt_max(mesh, i)); \
+	else \
+	{ \
+_Pragma("omp parallel for reduction(max:dtmax)") \
+		for (i = 0; i < mesh->na; ++i) \
+			dtmax = fmax(dtmax, node_1dt_max(mesh, i)); \
+	} \
+	return dtmax; \
+}
+
 // member functions
 
+void model_parameters_calculate(Model *model);
 void model_parameters(Model *model);
+double model_1dt_max(Model *model);
 void model_infiltration(Model *model);
+double model_diffusion_explicit_flux(Model *model, unsigned int i);
 void model_diffusion_explicit(Model *model);
 void model_diffusion_implicit(Model *model);
-double model_node_diffusion_1dt_max(Node *node);
+void model_surface_flow_update(Model *model);
+void model_surface_flow_runge_kutta(Model *model);
+double model_multirate_levels(Model *model, double dt);
+void model_surface_flow_multirate(Model *model);
+int model_implicit_iterate(Model *model, unsigned int iteration);
+double model_node_diffusion_1dt_max(Mesh *mesh, unsigned int i);
+void model_active(Model *model);
+void model_adapt(Model *model);
 void model_step(Model *model);
+unsigned int model_advance(Model *model, double t);
+double model_time(Model *model);
+unsigned int model_nodes_number(Model *model);
+unsigned int model_iterations(Model *model);
+int model_variable(Model *model, unsigned int type, double *value);
+int model_read_stream(Model *model, FILE *file);
 int model_read(Model *model, char *file_name);
+int model_read_memory(Model *model, char *data, size_t size);
+int model_init(Model *model);
+int model_open(Model *model, char *file_name);
+int model_open_memory(Model *model, char *data, size_t size);
+void model_delete(Model *model);
 void model_print(Model *model, unsigned int nsteps);
-void model_write_advance(Model *model, FILE *file);
+int model_checkpoint_write(Model *model, char *name);
+int model_checkpoint_read(Model *model, char *name);
+void model_write_advance_header(Model *model, FILE *file);
+void model_probes_locate(Model *model);
+int model_probes_set(Model *model, unsigned int n, double *x);
 int model_probes_read(Model *model, char *name);
-void model_write_probes(Model *model, FILE *file);
+void model_probes_values(Model *model, double *h, double *s);
+void model_write_probes_header(Model *model, FILE *file);
+double model_inlet_critical_depth(Model *model, double Q);
 void model_inlet(Model *model);
 void model_outlet_closed(Model *model);
 void model_outlet_open(Model *model);
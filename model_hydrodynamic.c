@@ -38,89 +38,129 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "channel.h"
 #include "node.h"
 #include "mesh.h"
+#include "tridiagonal.h"
 #include "model.h"
 #include "model_hydrodynamic.h"
 
 /**
- * \fn void model_node_parameters_hydrodynamic(Model *model, Node *node)
- * \brief Ffunction to calculate the numerical parameters of a node with the
- *   hydrodynamic model.
+ * \fn static inline void model_node_parameters_hydrodynamic_template \
+ *   (Model *model, unsigned int i, \
+ *   void (*node_friction)(Mesh*, unsigned int), \
+ *   void (*node_diffusion)(Mesh*, unsigned int), \
+ *   void (*node_infiltration)(Mesh*, unsigned int))
+ * \brief Function template to calculate the numerical parameters of a node
+ *   with the hydrodynamic model.
  * \param model
  * \brief model struct.
- * \param node
- * \brief node struct.
+ * \param i
+ * \brief node number.
+ * \param node_friction
+ * \brief pointer to the function calculating the node friction.
+ * \param node_diffusion
+ * \brief pointer to the function calculating the node diffusion.
+ * \param node_infiltration
+ * \brief pointer to the function calculating the node infiltration.
  */
-void model_node_parameters_hydrodynamic(Model *model, Node *node)
+static inline void model_node_parameters_hydrodynamic_template
+	(Model *model, unsigned int i, void (*node_friction)(Mesh*, unsigned int),
+	void (*node_diffusion)(Mesh*, unsigned int),
+	void (*node_infiltration)(Mesh*, unsigned int))
 {
 	double beta_u, cm;
-	node_width(node);
-	node_perimeter(node);
-	node_critical_velocity(node);
-	if (node->U[0] <= 0.)
+	Mesh *mesh = model->mesh;
+	Node *node = mesh->node + i;
+	double *A = mesh->U[0], *Q = mesh->U[1], *As = mesh->U[2];
+	double *h = mesh->h, *u = mesh->u, *c = mesh->c, *Sf = mesh->Sf;
+	node_width(mesh, i);
+	node_perimeter(mesh, i);
+	node_critical_velocity(mesh, i);
+	if (A[i] <= 0.)
 	{
-		node->s = node->U[1] = node->u = node->f = node->Sf = node->F = node->T
+		node->s = Q[i] = u[i] = node->f = Sf[i] = node->F = node->T
 			= node->Kx = node->KxA = beta_u = cm = 0.;
 		node->beta = 1.;
 	}
-	else if (node->h < model->minimum_depth)
+	else if (h[i] < model->minimum_depth)
 	{
-		node->s = node->U[2] / node->U[0];
-		node->U[1] = node->u = node->f = node->Sf = node->F = node->T = node->Kx
+		node->s = As[i] / A[i];
+		Q[i] = u[i] = node->f = Sf[i] = node->F = node->T = node->Kx
 			= node->KxA = beta_u = 0.;
 		node->beta = 1.;
-		cm = node->c;
+		cm = c[i];
 	}
 	else
 	{
-		node->s = node->U[2] / node->U[0];
-		node->u = node->U[1] / node->U[0];
-		model->node_friction(node);
-		beta_u = node->beta * node->u;
-		node->F = node->U[0] * beta_u * node->u + G * node->h * node->h
-			* (0.5 * node->B0 + 1./3. * node->Z * node->h);
-		node->T = node->U[1] * node->s;
-		model->node_diffusion(node);
-		node->KxA = node->Kx * node->U[0];
-		cm = sqrt(node->c * node->c + (node->beta - 1.) * beta_u * node->u);
+		node->s = As[i] / A[i];
+		u[i] = Q[i] / A[i];
+		node_friction(mesh, i);
+		beta_u = node->beta * u[i];
+		node->F = A[i] * beta_u * u[i] + G * h[i] * h[i]
+			* (0.5 * node->B0 + 1./3. * node->Z * h[i]);
+		node->T = Q[i] * node->s;
+		node_diffusion(mesh, i);
+		node->KxA = node->Kx * A[i];
+		cm = sqrt(c[i] * c[i] + (node->beta - 1.) * beta_u * u[i]);
 	}
 	node->l1 = beta_u + cm;
 	node->l2 = beta_u - cm;
-	model->node_infiltration(node);
+	node_infiltration(mesh, i);
 	node->Pi = node->P * node->i;
 }
 
 /**
- * \fn double node_1dt_max_hydrodynamic(Node *node)
+ * \fn void model_node_parameters_hydrodynamic(Model *model, unsigned int i)
+ * \brief Ffunction to calculate the numerical parameters of a node with the
+ *   hydrodynamic model.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief node number.
+ */
+void model_node_parameters_hydrodynamic(Model *model, unsigned int i)
+{
+	model_node_parameters_hydrodynamic_template(model, i,
+		model->node_friction, model->node_diffusion, model->node_infiltration);
+}
+
+/**
+ * \fn double node_1dt_max_hydrodynamic(Mesh *mesh, unsigned int i)
  * \brief Function to calculate the allowed maximum time step size in a node
  *   with the hydrodynamic model.
- * \param node
- * \brief node struct.
+ * \param mesh
+ * \brief mesh struct.
+ * \param i
+ * \brief node number.
  * \return inverse of the allowed maximum time step size.
  */
-double node_1dt_max_hydrodynamic(Node *node)
+double node_1dt_max_hydrodynamic(Mesh *mesh, unsigned int i)
 {
-	return (node->c + fabs(node->u)) / node->dx; 
+	return (mesh->c[i] + fabs(mesh->u[i])) / mesh->node[i].dx; 
 }
 
 /**
- * \fn void node_flows_hydrodynamic(Node *node1)
+ * \fn void node_flows_hydrodynamic(Mesh *mesh, unsigned int i, double *dF)
  * \brief Function to calculate the flux differences in a node with the
  *   hydrodynamic model.
- * \param node1
- * \brief node struct.
+ * \param mesh
+ * \brief mesh struct.
+ * \param i
+ * \brief number of the left node.
+ * \param dF
+ * \brief flux difference vector.
  */
-void node_flows_hydrodynamic(Node *node1)
+void node_flows_hydrodynamic(Mesh *mesh, unsigned int i, double *dF)
 {
 	double Am, dh;
-	Node *node2 = node1 + 1;
-	node1->dF[0] = node2->U[1] - node1->U[1];
-	Am = 0.5 * (node2->U[0] + node1->U[0]);
-//	dh = node2->h - node1->h;
+	Node *node1 = mesh->node + i, *node2 = node1 + 1;
+	double *A = mesh->U[0], *Q = mesh->U[1];
+	double *Sf = mesh->Sf;
+	dF[0] = Q[i + 1] - Q[i];
+	Am = 0.5 * (A[i + 1] + A[i]);
+//	dh = mesh->h[i + 1] - mesh->h[i];
 //	Am -= 1./12. * (node2->Z + node1->Z) * dh * dh;
-	node1->dF[1] = node2->F - node1->F + G * (Am * (node2->zb - node1->zb)
-		+ 0.5 * (node2->Sf * node2->U[0] + node1->Sf * node1->U[0])
-		* node1->ix);
-	node1->dF[2] = node2->T - node1->T;
+	dF[1] = node2->F - node1->F + G * (Am * (node2->zb - node1->zb)
+		+ 0.5 * (Sf[i + 1] * A[i + 1] + Sf[i] * A[i]) * node1->ix);
+	dF[2] = node2->T - node1->T;
 }
 
 /**
@@ -136,10 +176,63 @@ double model_inlet_dtmax_hydrodynamic(Model *model)
 	double A, Q, h, B, u, c;
 	Node *node = model->mesh->node;
 	Q = hydrogram_discharge(model->channel->water_inlet, model->t);
-	h = node_critical_depth(node, Q);
+	h = model_inlet_critical_depth(model, Q);
+	if (h <= 0.) return INFINITY;
 	A = h * (node->B0 + h * node->Z);
 	B = node->B0 + 2 * h * node->Z;
 	c = sqrt(G * A / B);
 	u = Q / A;
 	return node->ix / (c + fabs(u));
 }
+
+#if SPECIALIZED_KERNELS
+
+/**
+ * \fn static void model_node_parameters_hydrodynamic_Manning(Model *model, \
+ *   unsigned int i)
+ * \brief Function to calculate the numerical parameters of a node with the
+ *   hydrodynamic model and the Manning friction model.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief node number.
+ */
+static void model_node_parameters_hydrodynamic_Manning(Model *model,
+	unsigned int i)
+{
+	model_node_parameters_hydrodynamic_template(model, i,
+		node_friction_Manning, node_diffusion_Rutherford,
+		node_infiltration_KostiakovLewis);
+}
+
+/**
+ * \fn static void model_node_parameters_hydrodynamic_Manning_minimizing_losses\
+ *   (Model *model, unsigned int i)
+ * \brief Function to calculate the numerical parameters of a node with the
+ *   hydrodynamic model and the Manning friction model minimizing losses.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief node number.
+ */
+static void model_node_parameters_hydrodynamic_Manning_minimizing_losses
+	(Model *model, unsigned int i)
+{
+	model_node_parameters_hydrodynamic_template(model, i,
+		node_friction_Manning_minimizing_losses, node_diffusion_Rutherford,
+		node_infiltration_KostiakovLewis);
+}
+
+MODEL_PARAMETERS_KERNEL(model_parameters_hydrodynamic_Manning,
+	model_node_parameters_hydrodynamic_Manning,
+	model_node_parameters_hydrodynamic_Manning,
+	model_node_parameters_hydrodynamic_Manning)
+
+MODEL_PARAMETERS_KERNEL(model_parameters_hydrodynamic_Manning_minimizing_losses,
+	model_node_parameters_hydrodynamic_Manning_minimizing_losses,
+	model_node_parameters_hydrodynamic_Manning_minimizing_losses,
+	model_node_parameters_hydrodynamic_Manning_minimizing_losses)
+
+MODEL_1DT_MAX_KERNEL(model_1dt_max_hydrodynamic, node_1dt_max_hydrodynamic)
+
+#endif
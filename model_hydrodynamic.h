@@ -39,9 +39,14 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 // member functions
 
-void model_node_parameters_hydrodynamic(Model *model, Node *node);
-double node_1dt_max_hydrodynamic(Node *node);
-void node_flows_hydrodynamic(Node *node1);
+void model_node_parameters_hydrodynamic(Model *model, unsigned int i);
+double node_1dt_max_hydrodynamic(Mesh *mesh, unsigned int i);
+void node_flows_hydrodynamic(Mesh *mesh, unsigned int i, double *dF);
 double model_inlet_dtmax_hydrodynamic(Model *model);
+#if SPECIALIZED_KERNELS
+void model_parameters_hydrodynamic_Manning(Model *model);
+void model_parameters_hydrodynamic_Manning_minimizing_losses(Model *model);
+double model_1dt_max_hydrodynamic(Model *model);
+#endif
 
 #endif
@@ -39,10 +39,53 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "channel.h"
 #include "node.h"
 #include "mesh.h"
+#include "tridiagonal.h"
 #include "model.h"
 #include "model_hydrodynamic.h"
 #include "model_hydrodynamic_LaxFriedrichs.h"
 
+/**
+ * \fn void model_surface_flow_hydrodynamic_LaxFriedrichs_interface \
+ *   (Model *model, unsigned int i)
+ * \brief Function to calculate the flux differences of a cell interface with
+ *   the Lax-Friedrichs numerical scheme.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief number of the left node of the interface.
+ */
+void model_surface_flow_hydrodynamic_LaxFriedrichs_interface
+	(Model *model, unsigned int i)
+{
+	unsigned int j;
+	double k1, k2;
+	Mesh *mesh = model->mesh;
+	double **U = mesh->U;
+	double (*dF)[3] = mesh->dF, (*dFl)[3] = mesh->dFl, (*dFr)[3] = mesh->dFr;
+
+	node_flows_hydrodynamic(mesh, i, dF[i]);
+	dFr[i][0] = dFr[i][1] = dFr[i][2] = dFl[i][0]
+		= dFl[i][1] = dFl[i][2] = 0;
+	if (mesh->h[i] <= model->minimum_depth &&
+		mesh->h[i + 1] <= model->minimum_depth)
+			return;
+
+	// artificial viscosity
+
+	k1 = 0.5 * fmax(mesh->c[i + 1] + fabs(mesh->u[i + 1]),
+		mesh->c[i] + fabs(mesh->u[i]));
+
+	// wave decomposition
+
+	for (j = 0; j < 3; ++j)
+	{
+		dFr[i][j] = dFl[i][j] = 0.5 * dF[i][j];
+		k2 = k1 * (U[j][i + 1] - U[j][i]);
+		dFl[i][j] += k2;
+		dFr[i][j] -= k2;
+	}
+}
+
 /**
  * \fn void model_surface_flow_hydrodynamic_LaxFriedrichs(Model *model)
  * \brief Function to make the surface flow with the Lax-Friedrichs numerical
@@ -52,56 +95,34 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 void model_surface_flow_hydrodynamic_LaxFriedrichs(Model *model)
 {
-	unsigned int i, j, n1;
-	double k1, k2;
+	unsigned int i, n1;
 	Mesh *mesh = model->mesh;
 	Node *node = mesh->node;
+	double **U = mesh->U;
 
-	model->inlet_contribution[0] = - model->dt * node[0].U[1];
+	model->inlet_contribution[0] = - model->dt * U[1][0];
 	model->inlet_contribution[2] = - model->dt * node[0].T;
 
-	n1 = mesh->n - 1;
-	for (i = 0; i < n1; ++i)
+	n1 = mesh->na - 1;
+	if (mesh->na < PARALLEL_MINIMUM_NODES)
+		for (i = 0; i < n1; ++i)
+			model_surface_flow_hydrodynamic_LaxFriedrichs_interface(model, i);
+	else
 	{
-		node_flows_hydrodynamic(node + i);
-		node[i].dFr[0] = node[i].dFr[1] = node[i].dFr[2] = node[i].dFl[0]
-			= node[i].dFl[1] = node[i].dFl[2] = 0;
-		if (node[i].h <= model->minimum_depth &&
-			node[i + 1].h <= model->minimum_depth)
-				continue;
-
-		// artificial viscosity
-
-		k1 = 0.5 * fmax(node[i + 1].c + fabs(node[i + 1].u),
-			node[i].c + fabs(node[i].u));
-
-		// wave decomposition
-
-		for (j = 0; j < 3; ++j)
-		{
-			node[i].dFr[j] = node[i].dFl[j] = 0.5 * node[i].dF[j];
-			k2 = k1 * (node[i + 1].U[j] - node[i].U[j]);
-			node[i].dFl[j] += k2;
-			node[i].dFr[j] -= k2;
-		}
+#pragma omp parallel for
+		for (i = 0; i < n1; ++i)
+			model_surface_flow_hydrodynamic_LaxFriedrichs_interface(model, i);
 	}
 
 	// variables updating
 
-	for (i = 0; i < n1; ++i)
-	{
-		for (j = 0; j < 3; ++j)
-		{
-			node[i].U[j] -= model->dt * node[i].dFr[j] / node[i].dx;
-			node[i + 1].U[j] -= model->dt * node[i].dFl[j] / node[i + 1].dx;
-		}
-	}
+	model_surface_flow_update(model);
 
 	// boundary correction
 
 	model->model_inlet(model);
-	node[0].U[0] += model->inlet_contribution[0] / node[0].dx;
-	node[0].U[2] += model->inlet_contribution[2] / node[0].dx;
-	if (model->channel->type_inlet == 1) node_subcritical_discharge(node);
+	U[0][0] += model->inlet_contribution[0] / node[0].dx;
+	U[2][0] += model->inlet_contribution[2] / node[0].dx;
+	if (model->channel->type_inlet == 1) node_subcritical_discharge(mesh, 0);
 	model->model_outlet(model);
 }
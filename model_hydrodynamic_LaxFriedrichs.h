@@ -40,6 +40,8 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 // member functions
 
+void model_surface_flow_hydrodynamic_LaxFriedrichs_interface
+	(Model *model, unsigned int i);
 void model_surface_flow_hydrodynamic_LaxFriedrichs(Model *model);
 
 #endif
@@ -40,9 +40,6 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 // member functions
 
-void model_surface_flow_hydrodynamic_implicit_multiply
-	(double *m, double *v, double *r);
-void model_surface_flow_hydrodynamic_implicit_invert(double *m, double *i);
 void model_surface_flow_hydrodynamic_implicit(Model *model);
 
 #endif
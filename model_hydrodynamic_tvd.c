@@ -39,6 +39,7 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "channel.h"
 #include "node.h"
 #include "mesh.h"
+#include "tridiagonal.h"
 #include "model.h"
 #include "model_hydrodynamic.h"
 #include "model_hydrodynamic_tvd.h"
@@ -71,6 +72,260 @@ double model_surface_flow_hydrodynamic_limiter(double dW1, double dW2)
 #endif
 }
 
+/**
+ * \fn static void model_interface_flows_hydrodynamic_tvd(Model *model, \
+ *   unsigned int i)
+ * \brief Function to gather per field the flux differences of a cell interface
+ *   read by the TVD interfaces, to feed them with contiguous inputs.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief number of the left node of the interface.
+ */
+static void model_interface_flows_hydrodynamic_tvd(Model *model,
+	unsigned int i)
+{
+	double f[3];
+	Mesh *mesh = model->mesh;
+	node_flows_hydrodynamic(mesh, i, f);
+	mesh->V[6][i] = f[0];
+	mesh->V[7][i] = f[1];
+	mesh->V[8][i] = f[2];
+}
+
+/**
+ * \fn void model_node_gather_hydrodynamic_tvd(Model *model, unsigned int i)
+ * \brief Function to gather per field the node parameters read by the TVD
+ *   interfaces, to feed them with contiguous inputs.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief node number.
+ */
+void model_node_gather_hydrodynamic_tvd(Model *model, unsigned int i)
+{
+	Mesh *mesh = model->mesh;
+	Node *node = mesh->node;
+	mesh->V[0][i] = node[i].Z;
+	mesh->V[1][i] = node[i].B;
+	mesh->V[2][i] = node[i].s;
+	mesh->V[3][i] = node[i].ix;
+	mesh->V[4][i] = node[i].l1;
+	mesh->V[5][i] = node[i].l2;
+}
+
+/**
+ * \fn static inline void model_surface_flow_hydrodynamic_tvd_template \
+ *   (Model *model, unsigned int i, double dt)
+ * \brief Function template to calculate the first order flux differences and
+ *   the high order wave strengths of a cell interface with the TVD numerical
+ *   scheme.
+ *
+ * It is written without branches, selecting the results of the dry interfaces,
+ * the supercritical flows and the entropy correction, and declared with a SIMD
+ * version, so the interfaces loop is vectorized.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief number of the left node of the interface.
+ * \param dt
+ * \brief time step size of the interface.
+ */
+#pragma omp declare simd uniform(model, dt) linear(i)
+static inline void model_surface_flow_hydrodynamic_tvd_template
+	(Model *model, unsigned int i, double dt)
+{
+	int wet, subcritical;
+	double c, ur, s, l1, l2, sA1, sA2, k1, k2, dh, dtx, fl0, fl1, fl2, fr0,
+		fr1, fr2, lp[2], ln[2];
+	Mesh *mesh = model->mesh;
+	double **U = mesh->U;
+	double *A = U[0], *Q = U[1], *As = U[2], *Z = mesh->V[0], *B = mesh->V[1],
+		*S = mesh->V[2], *L1 = mesh->V[4], *L2 = mesh->V[5], *F0 = mesh->V[6],
+		*F1 = mesh->V[7], *F2 = mesh->V[8];
+	double *h = mesh->h, *u = mesh->u;
+	double (*dFl)[3] = mesh->dFl, (*dFr)[3] = mesh->dFr,
+		(*dWl)[3] = mesh->dWl, (*dWr)[3] = mesh->dWr, (*l)[3] = mesh->l;
+
+	wet = (h[i] > model->minimum_depth) | (h[i + 1] > model->minimum_depth);
+
+	// Roe's averages
+
+	dh = h[i + 1] - h[i];
+	c = sqrt(G * (A[i + 1] + A[i] - 1./3. * Z[i] * dh * dh)
+		/ (B[i + 1] + B[i]));
+	sA1 = sqrt(A[i]);
+	sA2 = sqrt(A[i + 1]);
+	k2 = sA1 + sA2;
+	k1 = sA1 / k2;
+	k2 = sA2 / k2;
+	ur = k1 * u[i] + k2 * u[i + 1];
+	l1 = ur + c;
+	l2 = ur - c;
+	s = k1 * S[i] + k2 * S[i + 1];
+	l[i][0] = wet ? l1 : 0.;
+	l[i][1] = wet ? l2 : 0.;
+	l[i][2] = wet ? s : 0.;
+
+	// first order wave decomposition
+
+	subcritical = wet & (ur < c);
+	fr0 = 0.5 * (l1 * F0[i] - F1[i]) / c;
+	fr0 = subcritical ? fr0 : 0.;
+	fr1 = subcritical ? l2 * fr0 : 0.;
+	fr2 = subcritical ? s * fr0 : 0.;
+	fl0 = wet ? F0[i] - fr0 : 0.;
+	fl1 = wet ? F1[i] - fr1 : 0.;
+	fl2 = wet ? F2[i] - fr2 : 0.;
+
+	// high order TVD correction (without the Lax-Wendroff time correction
+	// in the Runge-Kutta stages)
+
+#if RUNGE_KUTTA_ORDER > 1
+	dtx = 0.;
+#else
+	dtx = dt / mesh->V[3][i];
+#endif
+	lp[0] = l1 > 0. ? l1 : 0.;
+	lp[1] = l2 > 0. ? l2 : 0.;
+	ln[0] = l1 < 0. ? l1 : 0.;
+	ln[1] = l2 < 0. ? l2 : 0.;
+	k1 = 0.5 * (1. - lp[0] * dtx) * (fl1 - l2 * fl0) / c;
+	dWl[i][0] = wet ? k1 : 0.;
+	k1 = 0.5 * (1. - lp[1] * dtx) * (l1 * fl0 - fl1) / c;
+	dWl[i][1] = wet ? k1 : 0.;
+	dWl[i][2] = wet ? (1. - lp[1] * dtx) * (fl2 - s * fl0) : 0.;
+	k1 = 0.5 * (1. + ln[0] * dtx) * (fr1 - l2 * fr0) / c;
+	dWr[i][0] = wet ? k1 : 0.;
+	k1 = 0.5 * (1. + ln[1] * dtx) * (l1 * fr0 - fr1) / c;
+	dWr[i][1] = wet ? k1 : 0.;
+	dWr[i][2] = wet ? (1. + ln[1] * dtx) * (fr2 - s * fr0) : 0.;
+
+	// entropy correction
+
+	k1 = ((L1[i] < 0.) & (L1[i + 1] > 0.)) ?
+		0.25 * (L1[i + 1] - L1[i] - 2 * fabs(l1)) : 0.;
+	k1 = ((L2[i] < 0.) & (L2[i + 1] > 0.)) ?
+		0.25 * (L2[i + 1] - L2[i] - 2 * fabs(l2)) : k1;
+	k1 = wet ? k1 : 0.;
+	k2 = k1 * (A[i + 1] - A[i]);
+	dFl[i][0] = fl0 + k2;
+	dFr[i][0] = fr0 - k2;
+	k2 = k1 * (Q[i + 1] - Q[i]);
+	dFl[i][1] = fl1 + k2;
+	dFr[i][1] = fr1 - k2;
+	k2 = k1 * (As[i + 1] - As[i]);
+	dFl[i][2] = fl2 + k2;
+	dFr[i][2] = fr2 - k2;
+}
+
+/**
+ * \fn static void model_left_high_order_hydrodynamic_tvd(Mesh *mesh, \
+ *   unsigned int i, double dt2, double *F)
+ * \brief Function to calculate the high order TVD flux leaving a node through
+ *   its right cell interface.
+ * \param mesh
+ * \brief mesh struct.
+ * \param i
+ * \brief node number.
+ * \param dt2
+ * \brief half of the time step size.
+ * \param F
+ * \brief high order flux vector.
+ */
+static void model_left_high_order_hydrodynamic_tvd(Mesh *mesh, unsigned int i,
+	double dt2, double *F)
+{
+	unsigned int j;
+	double k, lp[3];
+	double (*dWl)[3] = mesh->dWl, (*l)[3] = mesh->l;
+	for (j = 0; j < 3; ++j)
+		lp[j] = dt2 * dWl[i - 1][j]
+			* model_surface_flow_hydrodynamic_limiter
+				(dWl[i][j], dWl[i - 1][j]);
+	k = lp[0] + lp[1];
+	F[0] = k;
+	F[2] = k * l[i][2] + lp[2];
+	F[1] = l[i][0] * lp[0] + l[i][1] * lp[1];
+}
+
+/**
+ * \fn static void model_right_high_order_hydrodynamic_tvd(Mesh *mesh, \
+ *   unsigned int i, double dt2, double *F)
+ * \brief Function to calculate the high order TVD flux leaving a node through
+ *   its left cell interface.
+ * \param mesh
+ * \brief mesh struct.
+ * \param i
+ * \brief node number.
+ * \param dt2
+ * \brief half of the time step size.
+ * \param F
+ * \brief high order flux vector.
+ */
+static void model_right_high_order_hydrodynamic_tvd(Mesh *mesh, unsigned int i,
+	double dt2, double *F)
+{
+	unsigned int j;
+	double k, ln[3];
+	double (*dWr)[3] = mesh->dWr, (*l)[3] = mesh->l;
+	for (j = 0; j < 3; ++j)
+		ln[j] = dt2 * dWr[i][j]
+			* model_surface_flow_hydrodynamic_limiter
+				(dWr[i - 1][j], dWr[i][j]);
+	k = ln[0] + ln[1];
+	F[0] = k;
+	F[2] = k * l[i][2] + ln[2];
+	F[1] = l[i][0] * ln[0] + l[i][1] * ln[1];
+}
+
+/**
+ * \fn static void model_node_fluxes_hydrodynamic_tvd(Model *model, \
+ *   unsigned int i, double dt2)
+ * \brief Function to calculate the high order TVD fluxes leaving a node,
+ *   reusing the first order flux difference arrays.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief node number.
+ * \param dt2
+ * \brief half of the time step size.
+ */
+static void model_node_fluxes_hydrodynamic_tvd(Model *model, unsigned int i,
+	double dt2)
+{
+	Mesh *mesh = model->mesh;
+	model_left_high_order_hydrodynamic_tvd(mesh, i, dt2, mesh->dFl[i]);
+	model_right_high_order_hydrodynamic_tvd(mesh, i, dt2, mesh->dFr[i]);
+}
+
+/**
+ * \fn static void model_node_high_order_hydrodynamic_tvd(Model *model, \
+ *   unsigned int i)
+ * \brief Function to correct the variables of a node with the high order TVD
+ *   fluxes gathering the fluxes of the neighbour nodes to avoid write
+ *   conflicts.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief node number.
+ */
+static void model_node_high_order_hydrodynamic_tvd(Model *model,
+	unsigned int i)
+{
+	unsigned int j;
+	Mesh *mesh = model->mesh;
+	Node *node = mesh->node;
+	double **U = mesh->U;
+	double (*dFl)[3] = mesh->dFl, (*dFr)[3] = mesh->dFr;
+	for (j = 0; j < 3; ++j)
+	{
+		U[j][i] -= (dFl[i][j] + dFr[i][j]) / node[i].dx;
+		if (i > 0) U[j][i] += dFl[i - 1][j] / node[i].dx;
+		if (i < mesh->na - 1) U[j][i] += dFr[i + 1][j] / node[i].dx;
+	}
+}
+
 /**
  * \fn void model_surface_flow_hydrodynamic_tvd(Model *model)
  * \brief Function to make the surface flow with the high order TVD numerical
@@ -81,142 +336,133 @@ double model_surface_flow_hydrodynamic_limiter(double dW1, double dW2)
 void model_surface_flow_hydrodynamic_tvd(Model *model)
 {
 	unsigned int i, j, n1;
-	double c, u, s, l1, l2, sA1, sA2, k1, k2, dh, dt2, lp[3], ln[3];
+	double dt, dt2;
 	Mesh *mesh = model->mesh;
 	Node *node = mesh->node;
+	double **U = mesh->U;
+	double (*dFl)[3] = mesh->dFl, (*dFr)[3] = mesh->dFr;
 
-	model->inlet_contribution[0] = - model->dt * node[0].U[1];
+	model->inlet_contribution[0] = - model->dt * U[1][0];
 	model->inlet_contribution[2] = - model->dt * node[0].T;
 
-	n1 = mesh->n - 1;
-	for (i = 0; i < n1; ++i)
+	n1 = mesh->na - 1;
+	dt = model->dt;
+	if (mesh->na < PARALLEL_MINIMUM_NODES)
 	{
-		node_flows_hydrodynamic(node + i);
-		node[i].dFr[0] = node[i].dFr[1] = node[i].dFr[2] = node[i].dFl[0]
-			= node[i].dFl[1] = node[i].dFl[2] = node[i].dWr[0] = node[i].dWr[1]
-		   	= node[i].dWr[2] = node[i].dWl[0] = node[i].dWl[1] = node[i].dWl[2]
-			= 0;
-		if (node[i].h <= model->minimum_depth &&
-			node[i + 1].h <= model->minimum_depth)
-				continue;
-
-		// Roe's averages
-
-		dh = node[i + 1].h - node[i].h;
-		c = sqrt(G * (node[i + 1].U[0] + node[i].U[0]
-			- 1./3. * node[i].Z * dh * dh) / (node[i + 1].B + node[i].B));
-		sA1 = sqrt(node[i].U[0]);
-		sA2 = sqrt(node[i + 1].U[0]);
-		k2 = sA1 + sA2;
-		k1 = sA1 / k2;
-		k2 = sA2 / k2;
-		u = k1 * node[i].u + k2 * node[i + 1].u;
-		l1 = u + c;
-		l2 = u - c;
-		s = k1 * node[i].s + k2 * node[i + 1].s;
-		node[i].l[0] = l1;
-		node[i].l[1] = l2;
-		node[i].l[2] = s;
-
-		// first order wave decomposition
-
-		if (u >= c)
-		{
-			for (j = 0; j < 3; ++j) node[i].dFl[j] = node[i].dF[j];
-		}
-		else
-		{
-			node[i].dFr[0] = 0.5 * (l1 * node[i].dF[0] - node[i].dF[1]) / c;
-			node[i].dFr[1] = l2 * node[i].dFr[0];
-			node[i].dFr[2] = s * node[i].dFr[0];
-			for (j = 0; j < 3; ++j)
-				node[i].dFl[j] = node[i].dF[j] - node[i].dFr[j];
-		}
-
-		// high order TVD correction
-
-		lp[0] = fmax(0., l1);
-		lp[1] = fmax(0., l2);
-		lp[2] = fmax(0., u);
-		ln[0] = fmin(0., l1);
-		ln[1] = fmin(0., l2);
-		ln[2] = fmin(0., u);
-		node[i].dWl[0] = 0.5 * (1. - lp[0] * model->dt / node[i].ix)
-			* (node[i].dFl[1] - l2 * node[i].dFl[0]) / c;
-		node[i].dWl[1] = 0.5 * (1. - lp[1] * model->dt / node[i].ix)
-			* (l1 * node[i].dFl[0] - node[i].dFl[1]) / c;
-		node[i].dWl[2] = (1. - lp[1] * model->dt / node[i].ix)
-			* (node[i].dFl[2] - s * node[i].dFl[0]);
-		node[i].dWr[0] = 0.5 * (1. + ln[0] * model->dt / node[i].ix)
-			* (node[i].dFr[1] - l2 * node[i].dFr[0]) / c;
-		node[i].dWr[1] = 0.5 * (1. + ln[1] * model->dt / node[i].ix)
-			* (l1 * node[i].dFr[0] - node[i].dFr[1]) / c;
-		node[i].dWr[2] = (1. + ln[1] * model->dt / node[i].ix)
-			* (node[i].dFr[2] - s * node[i].dFr[0]);
-
-		// entropy correction
-
-		if (node[i].l2 < 0. && node[i + 1].l2 > 0.)
-			k1 = 0.25 * (node[i + 1].l2 - node[i].l2 - 2 * fabs(l2));
-		else if (node[i].l1 < 0. && node[i + 1].l1 > 0.)
-			k1 = 0.25 * (node[i + 1].l1 - node[i].l1 - 2 * fabs(l1));
-		else continue;
-		for (j = 0; j < 3; ++j)
-		{
-			k2 = k1 * (node[i + 1].U[j] - node[i].U[j]);
-			node[i].dFl[j] += k2;
-			node[i].dFr[j] -= k2;
-		}
+		for (i = 0; i < n1; ++i)
+			model_interface_flows_hydrodynamic_tvd(model, i);
+		for (i = 0; i <= n1; ++i) model_node_gather_hydrodynamic_tvd(model, i);
+#pragma omp simd
+		for (i = 0; i < n1; ++i)
+			model_surface_flow_hydrodynamic_tvd_template(model, i, dt);
+	}
+	else
+	{
+#pragma omp parallel for
+		for (i = 0; i < n1; ++i)
+			model_interface_flows_hydrodynamic_tvd(model, i);
+#pragma omp parallel for
+		for (i = 0; i <= n1; ++i) model_node_gather_hydrodynamic_tvd(model, i);
+#pragma omp parallel for simd
+		for (i = 0; i < n1; ++i)
+			model_surface_flow_hydrodynamic_tvd_template(model, i, dt);
 	}
 
 	// variables updating
 
-	for (i = 0; i < n1; ++i)
-	{
-		for (j = 0; j < 3; ++j)
-		{
-			node[i].U[j] -= model->dt * node[i].dFr[j] / node[i].dx;
-			node[i + 1].U[j] -= model->dt * node[i].dFl[j] / node[i + 1].dx;
-
-		}
-	}
+	model_surface_flow_update(model);
 
-	// high order variables correction
+	// high order fluxes (the first order flux difference arrays are reused
+	// because they are no longer needed)
 
 	dt2 = 0.5 * model->dt;
-	for (i = 1; i < n1 - 1; ++i)
+	for (j = 0; j < 3; ++j)
+		dFl[0][j] = dFr[0][j] = dFl[n1 - 1][j] = dFr[n1 - 1][j] = dFl[n1][j]
+			= dFr[n1][j] = 0.;
+	if (mesh->na < PARALLEL_MINIMUM_NODES)
 	{
-		for (j = 0; j < 3; ++j)
-		{
-			lp[j] = dt2 * node[i - 1].dWl[j]
-				* model_surface_flow_hydrodynamic_limiter
-					(node[i].dWl[j], node[i - 1].dWl[j]);
-			ln[j] = dt2 * node[i].dWr[j]
-				* model_surface_flow_hydrodynamic_limiter
-					(node[i - 1].dWr[j], node[i].dWr[j]);
-		}
-		k1 = lp[0] + lp[1];
-		k2 = ln[0] + ln[1];
-		node[i + 1].U[0] += k1 / node[i + 1].dx;
-		node[i - 1].U[0] += k2 / node[i - 1].dx;
-		node[i].U[0] -= (k1 + k2) / node[i].dx;
-		k1 = k1 * node[i].l[2] + lp[2];
-		k2 = k2 * node[i].l[2] + ln[2];
-		node[i + 1].U[2] += k1 / node[i + 1].dx;
-		node[i - 1].U[2] += k2 / node[i - 1].dx;
-		node[i].U[2] -= (k1 + k2) / node[i].dx;
-		k1 = node[i].l[0] * lp[0] + node[i].l[1] * lp[1];
-		k2 = node[i].l[0] * ln[0] + node[i].l[1] * ln[1];
-		node[i + 1].U[1] += k1 / node[i + 1].dx;
-		node[i - 1].U[1] += k2 / node[i - 1].dx;
-		node[i].U[1] -= (k1 + k2) / node[i].dx;
+		for (i = 1; i < n1 - 1; ++i)
+			model_node_fluxes_hydrodynamic_tvd(model, i, dt2);
+		for (i = 0; i <= n1; ++i)
+			model_node_high_order_hydrodynamic_tvd(model, i);
+	}
+	else
+	{
+#pragma omp parallel for
+		for (i = 1; i < n1 - 1; ++i)
+			model_node_fluxes_hydrodynamic_tvd(model, i, dt2);
+#pragma omp parallel for
+		for (i = 0; i <= n1; ++i)
+			model_node_high_order_hydrodynamic_tvd(model, i);
 	}
 
 	// boundary correction
 
 	model->model_inlet(model);
-	node[0].U[0] += model->inlet_contribution[0] / node[0].dx;
-	node[0].U[2] += model->inlet_contribution[2] / node[0].dx;
-	if (model->channel->type_inlet == 1) node_subcritical_discharge(node);
+	U[0][0] += model->inlet_contribution[0] / node[0].dx;
+	U[2][0] += model->inlet_contribution[2] / node[0].dx;
+	if (model->channel->type_inlet == 1) node_subcritical_discharge(mesh, 0);
 	model->model_outlet(model);
 }
+
+/**
+ * \fn void model_surface_flow_hydrodynamic_tvd_interface(Model *model, \
+ *   unsigned int i)
+ * \brief Function to calculate the first order flux differences and the high
+ *   order wave strengths of a cell interface with the TVD numerical scheme and
+ *   local time stepping, with the time step size of the interface level.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief number of the left node of the interface.
+ */
+void model_surface_flow_hydrodynamic_tvd_interface(Model *model,
+	unsigned int i)
+{
+	unsigned int k, *level = model->mesh->level;
+	double dt;
+	k = (level[i] < level[i + 1]) ? level[i] : level[i + 1];
+	dt = (1 << k) * model->dt;
+	model_interface_flows_hydrodynamic_tvd(model, i);
+	model_surface_flow_hydrodynamic_tvd_template(model, i, dt);
+}
+
+/**
+ * \fn void model_surface_flow_hydrodynamic_tvd_high_order(Model *model, \
+ *   unsigned int i)
+ * \brief Function to add the high order TVD fluxes through a cell interface to
+ *   its flux differences with local time stepping.
+ *
+ * The high order fluxes are calculated by time step size unit and with the
+ * last wave strengths of the neighbour interfaces. They are added to the flux
+ * differences of both nodes with opposite signs, so they are accumulated as
+ * the first order ones and the scheme keeps conservative.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief number of the left node of the interface.
+ */
+void model_surface_flow_hydrodynamic_tvd_high_order(Model *model,
+	unsigned int i)
+{
+	unsigned int j, n2;
+	double F[3], H[3] = {0., 0., 0.};
+	Mesh *mesh = model->mesh;
+	double (*dFl)[3] = mesh->dFl, (*dFr)[3] = mesh->dFr;
+	n2 = mesh->na - 2;
+	if (i > 0 && i < n2)
+	{
+		model_left_high_order_hydrodynamic_tvd(mesh, i, 0.5, F);
+		for (j = 0; j < 3; ++j) H[j] += F[j];
+	}
+	if (i + 1 < n2)
+	{
+		model_right_high_order_hydrodynamic_tvd(mesh, i + 1, 0.5, F);
+		for (j = 0; j < 3; ++j) H[j] -= F[j];
+	}
+	for (j = 0; j < 3; ++j)
+	{
+		dFl[i][j] -= H[j];
+		dFr[i][j] += H[j];
+	}
+}
@@ -41,6 +41,11 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 // member functions
 
+void model_node_gather_hydrodynamic_tvd(Model *model, unsigned int i);
 void model_surface_flow_hydrodynamic_tvd(Model *model);
+void model_surface_flow_hydrodynamic_tvd_interface(Model *model,
+	unsigned int i);
+void model_surface_flow_hydrodynamic_tvd_high_order(Model *model,
+	unsigned int i);
 
 #endif
@@ -39,10 +39,84 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "channel.h"
 #include "node.h"
 #include "mesh.h"
+#include "tridiagonal.h"
 #include "model.h"
 #include "model_hydrodynamic.h"
 #include "model_hydrodynamic_upwind.h"
 
+/**
+ * \fn void model_surface_flow_hydrodynamic_upwind_interface(Model *model, \
+ *   unsigned int i)
+ * \brief Function to calculate the flux differences of a cell interface with
+ *   the upwind numerical scheme.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief number of the left node of the interface.
+ */
+void model_surface_flow_hydrodynamic_upwind_interface(Model *model,
+	unsigned int i)
+{
+	unsigned int j;
+	double c, u, s, l1, l2, sA1, sA2, k1, k2, dh;
+	Mesh *mesh = model->mesh;
+	Node *node = mesh->node;
+	double **U = mesh->U;
+	double (*dF)[3] = mesh->dF, (*dFl)[3] = mesh->dFl, (*dFr)[3] = mesh->dFr;
+
+	node_flows_hydrodynamic(mesh, i, dF[i]);
+	dFr[i][0] = dFr[i][1] = dFr[i][2] = dFl[i][0]
+		= dFl[i][1] = dFl[i][2] = 0;
+	if (mesh->h[i] <= model->minimum_depth &&
+		mesh->h[i + 1] <= model->minimum_depth)
+			return;
+
+	// Roe's averages
+
+	dh = mesh->h[i + 1] - mesh->h[i];
+	c = sqrt(G * (U[0][i + 1] + U[0][i]
+		- 1./3. * node[i].Z * dh * dh) / (node[i + 1].B + node[i].B));
+	sA1 = sqrt(U[0][i]);
+	sA2 = sqrt(U[0][i + 1]);
+	k2 = sA1 + sA2;
+	k1 = sA1 / k2;
+	k2 = sA2 / k2;
+	u = k1 * mesh->u[i] + k2 * mesh->u[i + 1];
+	l1 = u + c;
+	l2 = u - c;
+
+	// wave decomposition
+
+	if (u >= c)
+	{
+		for (j = 0; j < 3; ++j) dFl[i][j] = dF[i][j];
+	}
+	else
+	{
+		s = k1 * node[i].s + k2 * node[i + 1].s;
+		dFr[i][0] = 0.5 * (l1 * dF[i][0] - dF[i][1]) / c;
+		dFr[i][1] = l2 * dFr[i][0];
+		dFr[i][2] = s * dFr[i][0];
+		for (j = 0; j < 3; ++j)
+			dFl[i][j] = dF[i][j] - dFr[i][j];
+	}
+
+	// entropy correction
+
+	if (node[i].l2 < 0. && node[i + 1].l2 > 0.)
+		k1 = 0.25 * (node[i + 1].l2 - node[i].l2 - 2 * fabs(l2));
+	else if (node[i].l1 < 0. && node[i + 1].l1 > 0.)
+		k1 = 0.25 * (node[i + 1].l1 - node[i].l1 - 2 * fabs(l1));
+	else return;
+
+	for (j = 0; j < 3; ++j)
+	{
+		k2 = k1 * (U[j][i + 1] - U[j][i]);
+		dFl[i][j] += k2;
+		dFr[i][j] -= k2;
+	}
+}
+
 /**
  * \fn void model_surface_flow_hydrodynamic_upwind(Model *model)
  * \brief Function to make the surface flow with the upwind numerical scheme.
@@ -51,86 +125,34 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 void model_surface_flow_hydrodynamic_upwind(Model *model)
 {
-	unsigned int i, j, n1;
-	double c, u, s, l1, l2, sA1, sA2, k1, k2, dh;
+	unsigned int i, n1;
 	Mesh *mesh = model->mesh;
 	Node *node = mesh->node;
+	double **U = mesh->U;
 
-	model->inlet_contribution[0] = - model->dt * node[0].U[1];
+	model->inlet_contribution[0] = - model->dt * U[1][0];
 	model->inlet_contribution[2] = - model->dt * node[0].T;
 
-	n1 = mesh->n - 1;
-	for (i = 0; i < n1; ++i)
+	n1 = mesh->na - 1;
+	if (mesh->na < PARALLEL_MINIMUM_NODES)
+		for (i = 0; i < n1; ++i)
+			model_surface_flow_hydrodynamic_upwind_interface(model, i);
+	else
 	{
-		node_flows_hydrodynamic(node + i);
-		node[i].dFr[0] = node[i].dFr[1] = node[i].dFr[2] = node[i].dFl[0]
-			= node[i].dFl[1] = node[i].dFl[2] = 0;
-		if (node[i].h <= model->minimum_depth &&
-			node[i + 1].h <= model->minimum_depth)
-				continue;
-
-		// Roe's averages
-
-		dh = node[i + 1].h - node[i].h;
-		c = sqrt(G * (node[i + 1].U[0] + node[i].U[0]
-			- 1./3. * node[i].Z * dh * dh) / (node[i + 1].B + node[i].B));
-		sA1 = sqrt(node[i].U[0]);
-		sA2 = sqrt(node[i + 1].U[0]);
-		k2 = sA1 + sA2;
-		k1 = sA1 / k2;
-		k2 = sA2 / k2;
-		u = k1 * node[i].u + k2 * node[i + 1].u;
-		l1 = u + c;
-		l2 = u - c;
-
-		// wave decomposition
-
-		if (u >= c)
-		{
-			for (j = 0; j < 3; ++j) node[i].dFl[j] = node[i].dF[j];
-		}
-		else
-		{
-			s = k1 * node[i].s + k2 * node[i + 1].s;
-			node[i].dFr[0] = 0.5 * (l1 * node[i].dF[0] - node[i].dF[1]) / c;
-			node[i].dFr[1] = l2 * node[i].dFr[0];
-			node[i].dFr[2] = s * node[i].dFr[0];
-			for (j = 0; j < 3; ++j)
-				node[i].dFl[j] = node[i].dF[j] - node[i].dFr[j];
-		}
-
-		// entropy correction
-
-		if (node[i].l2 < 0. && node[i + 1].l2 > 0.)
-			k1 = 0.25 * (node[i + 1].l2 - node[i].l2 - 2 * fabs(l2));
-		else if (node[i].l1 < 0. && node[i + 1].l1 > 0.)
-			k1 = 0.25 * (node[i + 1].l1 - node[i].l1 - 2 * fabs(l1));
-		else continue;
-
-		for (j = 0; j < 3; ++j)
-		{
-			k2 = k1 * (node[i + 1].U[j] - node[i].U[j]);
-			node[i].dFl[j] += k2;
-			node[i].dFr[j] -= k2;
-		}
+#pragma omp parallel for
+		for (i = 0; i < n1; ++i)
+			model_surface_flow_hydrodynamic_upwind_interface(model, i);
 	}
 
 	// variables updating
 
-	for (i = 0; i < n1; ++i)
-	{
-		for (j = 0; j < 3; ++j)
-		{
-			node[i].U[j] -= model->dt * node[i].dFr[j] / node[i].dx;
-			node[i + 1].U[j] -= model->dt * node[i].dFl[j] / node[i + 1].dx;
-		}
-	}
+	model_surface_flow_update(model);
 
 	// boundary correction
 
 	model->model_inlet(model);
-	node[0].U[0] += model->inlet_contribution[0] / node[0].dx;
-	node[0].U[2] += model->inlet_contribution[2] / node[0].dx;
-	if (model->channel->type_inlet == 1) node_subcritical_discharge(node);
+	U[0][0] += model->inlet_contribution[0] / node[0].dx;
+	U[2][0] += model->inlet_contribution[2] / node[0].dx;
+	if (model->channel->type_inlet == 1) node_subcritical_discharge(mesh, 0);
 	model->model_outlet(model);
 }
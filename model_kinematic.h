@@ -39,16 +39,21 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 // member functions
 
-void node_discharge_centre_kinematic(Node *node);
-void node_discharge_right_kinematic(Node *node);
-void node_discharge_left_kinematic(Node *node);
-void model_node_parameters_kinematic(Model *model, Node *node,
-	void (*node_discharge)(Node*));
-void model_node_parameters_centre_kinematic(Model *model, Node *node);
-void model_node_parameters_right_kinematic(Model *model, Node *node);
-void model_node_parameters_left_kinematic(Model *model, Node *node);
-double node_1dt_max_kinematic(Node *node);
-void node_flows_kinematic(Node *node1);
+void node_discharge_centre_kinematic(Model *model, unsigned int i);
+void node_discharge_right_kinematic(Model *model, unsigned int i);
+void node_discharge_left_kinematic(Model *model, unsigned int i);
+void model_node_parameters_kinematic(Model *model, unsigned int i,
+	void (*node_discharge)(Model*, unsigned int));
+void model_node_parameters_centre_kinematic(Model *model, unsigned int i);
+void model_node_parameters_right_kinematic(Model *model, unsigned int i);
+void model_node_parameters_left_kinematic(Model *model, unsigned int i);
+double node_1dt_max_kinematic(Mesh *mesh, unsigned int i);
+void node_flows_kinematic(Mesh *mesh, unsigned int i, double *dF);
 double model_inlet_dtmax_kinematic(Model *model);
+#if SPECIALIZED_KERNELS
+void model_parameters_kinematic_Manning(Model *model);
+void model_parameters_kinematic_Manning_minimizing_losses(Model *model);
+double model_1dt_max_kinematic(Model *model);
+#endif
 
 #endif
@@ -39,6 +39,7 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "channel.h"
 #include "node.h"
 #include "mesh.h"
+#include "tridiagonal.h"
 #include "model.h"
 #include "model_kinematic.h"
 #include "model_kinematic_implicit.h"
@@ -94,25 +95,28 @@ void model_surface_flow_kinematic_implicit(Model *model)
 		inlet_contribution[3], outlet_contribution[3];
 	Mesh *mesh = model->mesh;
 	Node *node = mesh->node;
+	double **U = mesh->U;
+	double (*dF)[3] = mesh->dF, (*Un)[3] = mesh->Un, (*dU)[3] = mesh->dU,
+		(*Jp)[9] = mesh->Jp, *Sfn = mesh->Sfn;
 
-	n1 = mesh->n - 1;
+	n1 = mesh->na - 1;
 
 	// saving some former time step variables
 
-	for (i = 0; i < mesh->n; ++i)
+	for (i = 0; i < mesh->na; ++i)
 	{
-		for (j = 0; j < 3; ++j) node[i].Un[j] = node[i].U[j];
-		node[i].Sfn = node[i].Sf;
+		for (j = 0; j < 3; ++j) Un[i][j] = U[j][i];
+		Sfn[i] = mesh->Sf[i];
 	}
 
 	// explicit part
 
-	inlet_contribution[0] = - model->dt * node[0].U[1];
+	inlet_contribution[0] = - model->dt * U[1][0];
 	inlet_contribution[2] = - model->dt * node[0].T;
-	outlet_contribution[0] = model->dt * node[n1].U[1];
+	outlet_contribution[0] = model->dt * U[1][n1];
 	outlet_contribution[2] = model->dt * node[n1].T;
 
-	for (i = 0; i < n1; ++i) node_flows_kinematic(node + i);
+	for (i = 0; i < n1; ++i) node_flows_kinematic(mesh, i, dF[i]);
 
 	// implicit part
 
@@ -129,77 +133,78 @@ void model_surface_flow_kinematic_implicit(Model *model)
 
 		// implicit operators
 
-		for (i = 0; i < mesh->n; ++i)
+		for (i = 0; i < mesh->na; ++i)
 		{
-			if (node[i].h <= model->minimum_depth)
+			if (mesh->h[i] <= model->minimum_depth)
 			{
-				for (j = 0; j < 4; ++j) node[i].Jp[j] = 0.;
+				for (j = 0; j < 4; ++j) Jp[i][j] = 0.;
 				continue;
 			}
-			l1 = node[i].U[1] * (5./3. / node[i].U[0]
+			l1 = U[1][i] * (5./3. / U[0][i]
 				- 4./3. * sqrt(1 + node[i].Z * node[i].Z)
 				/ (node[i].B * node[i].P));
-			node[i].Jp[0] = l1;
-			node[i].Jp[1] = 0.;
-			node[i].Jp[2] = (l1 - node[i].u) * node[i].s;
-			node[i].Jp[3] = node[i].u;
+			Jp[i][0] = l1;
+			Jp[i][1] = 0.;
+			Jp[i][2] = (l1 - mesh->u[i]) * node[i].s;
+			Jp[i][3] = mesh->u[i];
 		}
 
 		// variables updating
 
-		for (j = 0; j < 4; ++j) B[j] = odt * node[0].Jp[j];
-		node[0].dU[0] = node[0].dU[2] = 0.;
-		node[0].U[0] = node[0].Un[0];
-		node[0].U[2] = node[0].Un[2];
+		for (j = 0; j < 4; ++j) B[j] = odt * Jp[0][j];
+		dU[0][0] = dU[0][2] = 0.;
+		U[0][0] = Un[0][0];
+		U[2][0] = Un[0][2];
 		for (i = 0; ++i <= n1;)
 		{
 			model_surface_flow_kinematic_implicit_multiply
-				(B, node[i - 1].dU, D);
-			for (j = 0; j < 4; ++j) A[j] = B[j] = odt * node[i].Jp[j];
+				(B, dU[i - 1], D);
+			for (j = 0; j < 4; ++j) A[j] = B[j] = odt * Jp[i][j];
 			A[0] += node[i].dx;
 			A[3] += node[i].dx;
 			model_surface_flow_kinematic_implicit_invert(A, C);
-			D[0] -= model->dt * node[i - 1].dF[0];
-			D[2] -= model->dt * node[i - 1].dF[2];
-			model_surface_flow_kinematic_implicit_multiply(C, D, node[i].dU);
-			node[i].U[0] = node[i].Un[0] + node[i].dU[0];
-			node[i].U[2] = node[i].Un[2] + node[i].dU[2];
+			D[0] -= model->dt * dF[i - 1][0];
+			D[2] -= model->dt * dF[i - 1][2];
+			model_surface_flow_kinematic_implicit_multiply(C, D, dU[i]);
+			U[0][i] = Un[i][0] + dU[i][0];
+			U[2][i] = Un[i][2] + dU[i][2];
 		}
 		i = n1;
-		model_surface_flow_kinematic_implicit_multiply(B, node[i].dU, D);
+		model_surface_flow_kinematic_implicit_multiply(B, dU[i], D);
 		model->outlet_contribution[0] += D[0];
 		model->outlet_contribution[2] += D[2];
 
 		// boundary conditions
 
 		model->model_inlet(model);
-		for (j = 0; j < 4; ++j) A[j] = B[j] = odt * node[0].Jp[j];
+		for (j = 0; j < 4; ++j) A[j] = B[j] = odt * Jp[0][j];
 		A[0] += node[0].dx;
 		A[3] += node[0].dx;
 		model_surface_flow_kinematic_implicit_invert(A, C);
 		model_surface_flow_kinematic_implicit_multiply
-			(C, model->inlet_contribution, node[0].dU);
-		node[0].U[0] += node[0].dU[0];
-		node[0].U[2] += node[0].dU[2];
+			(C, model->inlet_contribution, dU[0]);
+		U[0][0] += dU[0][0];
+		U[2][0] += dU[0][2];
 		for (i = 0; ++i <= n1;)
 		{
 			model_surface_flow_kinematic_implicit_multiply
-				(B, node[i - 1].dU, D);
-			for (j = 0; j < 4; ++j) A[j] = B[j] = odt * node[i].Jp[j];
+				(B, dU[i - 1], D);
+			for (j = 0; j < 4; ++j) A[j] = B[j] = odt * Jp[i][j];
 			A[0] += node[i].dx;
 			A[3] += node[i].dx;
 			model_surface_flow_kinematic_implicit_invert(A, C);
-			model_surface_flow_kinematic_implicit_multiply(C, D, node[i].dU);
-			node[i].U[0] += node[i].dU[0];
-			node[i].U[2] += node[i].dU[2];
+			model_surface_flow_kinematic_implicit_multiply(C, D, dU[i]);
+			U[0][i] += dU[i][0];
+			U[2][i] += dU[i][2];
 		}
-		if (model->channel->type_inlet == 1) node_subcritical_discharge(node);
+		if (model->channel->type_inlet == 1)
+			node_subcritical_discharge(mesh, 0);
 		model->model_outlet(model);
 		i = n1;
-		node[i].U[0] += model->outlet_contribution[0] / node[i].dx;
-		node[i].U[2] += model->outlet_contribution[2] / node[i].dx;
+		U[0][i] += model->outlet_contribution[0] / node[i].dx;
+		U[2][i] += model->outlet_contribution[2] / node[i].dx;
 
 		model_parameters(model);
 	}
-	while (++iteration < 1);
+	while (model_implicit_iterate(model, ++iteration));
 }
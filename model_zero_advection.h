@@ -39,9 +39,14 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 // member functions
 
-void model_node_parameters_zero_advection(Model *model, Node *node);
-double node_1dt_max_zero_advection(Node *node);
-void node_flows_zero_advection(Node *node1);
+void model_node_parameters_zero_advection(Model *model, unsigned int i);
+double node_1dt_max_zero_advection(Mesh *mesh, unsigned int i);
+void node_flows_zero_advection(Mesh *mesh, unsigned int i, double *dF);
 double model_inlet_dtmax_zero_advection(Model *model);
+#if SPECIALIZED_KERNELS
+void model_parameters_zero_advection_Manning(Model *model);
+void model_parameters_zero_advection_Manning_minimizing_losses(Model *model);
+double model_1dt_max_zero_advection(Model *model);
+#endif
 
 #endif
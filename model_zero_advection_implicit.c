@@ -39,51 +39,69 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "channel.h"
 #include "node.h"
 #include "mesh.h"
+#include "tridiagonal.h"
 #include "model.h"
 #include "model_zero_advection.h"
+#include "model_zero_advection_upwind.h"
+#include "block.h"
 #include "model_zero_advection_implicit.h"
 
 /**
- * \fn void model_surface_flow_zero_advection_implicit_multiply\
- *   (double *m, double *v, double *r)
- * \brief Function to multiply a matrix by a vector of the zero advection model.
- * \param m
- * \brief multiplying matrix.
- * \param v
- * \brief vector to multiply.
- * \param r
- * \brief resulting vector.
- */
-void model_surface_flow_zero_advection_implicit_multiply
-	(double *m, double *v, double *r)
-{
-	r[0] = m[0] * v[0] + m[1] * v[1];
-	r[1] = m[3] * v[0] + m[4] * v[1];
-	r[2] = m[6] * v[0] + m[7] * v[1] + m[8] * v[2];
-}
-
-/**
- * \fn void model_surface_flow_zero_advection_implicit_invert\
- *   (double *m, double *i)
- * \brief Function to invert an implicit operator of the zero advection model.
- * \param m
- * \brief implicit operator to invert.
+ * \fn static void model_node_operators_zero_advection_implicit(Model *model, \
+ *   unsigned int i, double odt)
+ * \brief Function to calculate and to factorize the implicit operators of a
+ *   node.
+ * \param model
+ * \brief model struct.
  * \param i
- * \brief invert operator.
+ * \brief node number.
+ * \param odt
+ * \brief implicit factor by the time step size.
  */
-void model_surface_flow_zero_advection_implicit_invert(double *m, double *i)
+static void model_node_operators_zero_advection_implicit(Model *model,
+	unsigned int i, double odt)
 {
-	double d;
-	d = m[8] * (m[0] * m[4] - m[1] * m[3]);
-	i[0] = m[4] * m[8] / d;
-	i[3] = - m[3] * m[8] / d;
-	i[6] = (m[3] * m[7] - m[4] * m[6]) / d;
-	i[1] = - m[1] * m[8] / d;
-	i[4] = m[0] * m[8] / d;
-	i[7] = (m[1] * m[6] - m[0] * m[7]) / d;
-	i[2] = 0.;
-	i[5] = 0.;
-	i[8] = (m[0] * m[4] - m[1] * m[3]) / d;
+	unsigned int j;
+	double l3;
+	Mesh *mesh = model->mesh;
+	Node *node = mesh->node;
+	double (*Jp)[9] = mesh->Jp, (*Jn)[9] = mesh->Jn, (*Ip)[9] = mesh->Ip,
+		(*In)[9] = mesh->In;
+	if (mesh->h[i] <= model->minimum_depth)
+		for (j = 0; j < 9; ++j) Jp[i][j] = Jn[i][j] = 0.;
+	else
+	{
+		l3 = fmax(0., mesh->u[i]);
+		Jp[i][0] = 0.5 * mesh->c[i];
+		Jp[i][1] = 0.5;
+		Jp[i][2] = 0.;
+		Jp[i][3] = 0.5 * mesh->c[i] * mesh->c[i];
+		Jp[i][4] = 0.5 * mesh->c[i];
+		Jp[i][5] = 0.;
+		Jp[i][6] = (Jp[i][0] - l3) * node[i].s;
+		Jp[i][7] = 0.5 * node[i].s;
+		Jp[i][8] = l3;
+		l3 = fmin(0., mesh->u[i]);
+		Jn[i][0] = -0.5 * mesh->c[i];
+		Jn[i][1] = 0.5;
+		Jn[i][2] = 0.;
+		Jn[i][3] = 0.5 * mesh->c[i] * mesh->c[i];
+		Jn[i][4] = -0.5 * mesh->c[i];
+		Jn[i][5] = 0.;
+		Jn[i][6] = (Jn[i][0] - l3) * node[i].s;
+		Jn[i][7] = 0.5 * node[i].s;
+		Jn[i][8] = l3;
+	}
+
+	// scaling by the time step size and factorizing
+
+	for (j = 0; j < 9; ++j)
+	{
+		Jp[i][j] *= odt;
+		Jn[i][j] *= - odt;
+	}
+	block_factorize(Jp[i], node[i].dx, Ip[i]);
+	block_factorize(Jn[i], node[i].dx, In[i]);
 }
 
 /**
@@ -96,52 +114,41 @@ void model_surface_flow_zero_advection_implicit_invert(double *m, double *i)
 void model_surface_flow_zero_advection_implicit(Model *model)
 {
 	unsigned int i, j, n1, iteration;
-	double c, s, l3, sA1, sA2, k1, k2, dh, odt, godt, A[9], B[9], C[9], D[3],
-		inlet_contribution[3], outlet_contribution[3];
+	double k1, odt, godt, D[3], inlet_contribution[3],
+		outlet_contribution[3];
 	Mesh *mesh = model->mesh;
 	Node *node = mesh->node;
+	double **U = mesh->U;
+	double (*dFl)[3] = mesh->dFl, (*dFr)[3] = mesh->dFr,
+		(*Un)[3] = mesh->Un, (*dU)[3] = mesh->dU, (*Jp)[9] = mesh->Jp,
+		(*Jn)[9] = mesh->Jn, (*Ip)[9] = mesh->Ip, (*In)[9] = mesh->In,
+		*Sfn = mesh->Sfn;
 
-	n1 = mesh->n - 1;
+	n1 = mesh->na - 1;
 
 	// saving some former time step variables
 
-	for (i = 0; i < mesh->n; ++i)
+	for (i = 0; i < mesh->na; ++i)
 	{
-		for (j = 0; j < 3; ++j) node[i].Un[j] = node[i].U[j];
-		node[i].Sfn = node[i].Sf;
+		for (j = 0; j < 3; ++j) Un[i][j] = U[j][i];
+		Sfn[i] = mesh->Sf[i];
 	}
 
 	// explicit part
 
-	inlet_contribution[0] = - model->dt * node[0].U[1];
+	inlet_contribution[0] = - model->dt * U[1][0];
 	inlet_contribution[2] = - model->dt * node[0].T;
-	outlet_contribution[0] = model->dt * node[n1].U[1];
+	outlet_contribution[0] = model->dt * U[1][n1];
 	outlet_contribution[2] = model->dt * node[n1].T;
 
-	for (i = 0; i < n1; ++i)
+	if (mesh->na < PARALLEL_MINIMUM_NODES)
+		for (i = 0; i < n1; ++i)
+			model_surface_flow_zero_advection_upwind_interface(model, i);
+	else
 	{
-		node_flows_zero_advection(node + i);
-		node[i].dFr[0] = node[i].dFr[1] = node[i].dFr[2] = node[i].dFl[0]
-			= node[i].dFl[1] = node[i].dFl[2] = 0;
-		if (node[i].h <= model->minimum_depth &&
-			node[i + 1].h <= model->minimum_depth)
-				continue;
-
-		// wave decomposition
-
-		dh = node[i + 1].h - node[i].h;
-		c = sqrt(G * (node[i + 1].U[0] + node[i].U[0]
-			- 1./3. * node[i].Z * dh * dh) / (node[i + 1].B + node[i].B));
-		sA1 = sqrt(node[i].U[0]);
-		sA2 = sqrt(node[i + 1].U[0]);
-		k2 = sA1 + sA2;
-		k1 = sA1 / k2;
-		k2 = sA2 / k2;
-		s = k1 * node[i].s + k2 * node[i + 1].s;
-		node[i].dFr[0] = 0.5 * (node[i].dF[0] - node[i].dF[1] / c);
-		node[i].dFr[1] = - c * node[i].dFr[0];
-		node[i].dFr[2] = s * node[i].dFr[0];
-		for (j = 0; j < 3; ++j) node[i].dFl[j] = node[i].dF[j] - node[i].dFr[j];
+#pragma omp parallel for
+		for (i = 0; i < n1; ++i)
+			model_surface_flow_zero_advection_upwind_interface(model, i);
 	}
 
 	// implicit part
@@ -159,153 +166,67 @@ void model_surface_flow_zero_advection_implicit(Model *model)
 
 		// implicit operators
 
-		for (i = 0; i < mesh->n; ++i)
+		if (mesh->na < PARALLEL_MINIMUM_NODES)
+			for (i = 0; i < mesh->na; ++i)
+				model_node_operators_zero_advection_implicit(model, i, odt);
+		else
 		{
-			if (node[i].h <= model->minimum_depth)
-			{
-				for (j = 0; j < 9; ++j) node[i].Jp[j] = node[i].Jn[j] = 0.;
-				continue;
-			}
-			l3 = fmax(0., node[i].u);
-			node[i].Jp[0] = 0.5 * node[i].c;
-			node[i].Jp[1] = 0.5;
-			node[i].Jp[2] = 0.;
-			node[i].Jp[3] = 0.5 * node[i].c * node[i].c;
-			node[i].Jp[4] = 0.5 * node[i].c;
-			node[i].Jp[5] = 0.;
-			node[i].Jp[6] = (node[i].Jp[0] - l3) * node[i].s;
-			node[i].Jp[7] = 0.5 * node[i].s;
-			node[i].Jp[8] = l3;
-			l3 = fmin(0., node[i].u);
-			node[i].Jn[0] = -0.5 * node[i].c;
-			node[i].Jn[1] = 0.5;
-			node[i].Jn[2] = 0.;
-			node[i].Jn[3] = 0.5 * node[i].c * node[i].c;
-			node[i].Jn[4] = -0.5 * node[i].c;
-			node[i].Jn[5] = 0.;
-			node[i].Jn[6] = (node[i].Jn[0] - l3) * node[i].s;
-			node[i].Jn[7] = 0.5 * node[i].s;
-			node[i].Jn[8] = l3;
+#pragma omp parallel for
+			for (i = 0; i < mesh->na; ++i)
+				model_node_operators_zero_advection_implicit(model, i, odt);
 		}
 
 		// variables updating
 
-		for (j = 0; j < 9; ++j) B[j] = odt * node[0].Jp[j];
-		for (j = 0; j < 3; ++j)
-		{
-			node[0].dU[j] = 0.;
-			node[0].U[j] = node[0].Un[j];
-		}
+		for (j = 0; j < 3; ++j) dU[0][j] = 0.;
+		block_forward(Jp, Ip, dFl, model->dt, dU, mesh->na);
+		for (j = 0; j < 3; ++j) U[j][0] = Un[0][j];
 		for (i = 0; ++i <= n1;)
-		{
-			model_surface_flow_zero_advection_implicit_multiply
-				(B, node[i - 1].dU, D);
-			for (j = 0; j < 9; ++j) A[j] = B[j] = odt * node[i].Jp[j];
-			A[0] += node[i].dx;
-			A[4] += node[i].dx;
-			A[8] += node[i].dx;
-			model_surface_flow_zero_advection_implicit_invert(A, C);
-			for (j = 0; j < 3; ++j) D[j] -= model->dt * node[i - 1].dFl[j];
-			model_surface_flow_zero_advection_implicit_multiply
-				(C, D, node[i].dU);
-			for (j = 0; j < 3; ++j)
-				node[i].U[j] = node[i].Un[j] + node[i].dU[j];
-		}
-		i = n1;
-		model_surface_flow_zero_advection_implicit_multiply(B, node[i].dU, D);
+			for (j = 0; j < 3; ++j) U[j][i] = Un[i][j] + dU[i][j];
+		block_multiply(Jp[n1], dU[n1], D);
 		model->outlet_contribution[0] += D[0];
 		model->outlet_contribution[2] += D[2];
-		for (j = 0; j < 9; ++j) B[j] = - odt * node[i].Jn[j];
-		for (j = 0; j < 3; ++j) node[i].dU[j] = 0.;
-		do
-		{
-			--i;
-			model_surface_flow_zero_advection_implicit_multiply
-				(B, node[i + 1].dU, D);
-			for (j = 0; j < 9; ++j) A[j] = B[j] = - odt * node[i].Jn[j];
-			A[0] += node[i].dx;
-			A[4] += node[i].dx;
-			A[8] += node[i].dx;
-			model_surface_flow_zero_advection_implicit_invert(A, C);
-			for (j = 0; j < 3; ++j) D[j] -= model->dt * node[i].dFr[j];
-			model_surface_flow_zero_advection_implicit_multiply
-				(C, D, node[i].dU);
-			for (j = 0; j < 3; ++j) node[i].U[j] += node[i].dU[j];
-		}
-		while (i > 0);
-		model_surface_flow_zero_advection_implicit_multiply(B, node[0].dU, D);
+		for (j = 0; j < 3; ++j) dU[n1][j] = 0.;
+		block_backward(Jn, In, dFr, model->dt, dU, mesh->na);
+		for (i = 0; i < n1; ++i)
+			for (j = 0; j < 3; ++j) U[j][i] += dU[i][j];
+		block_multiply(Jn[0], dU[0], D);
 		model->inlet_contribution[0] += D[0];
 		model->inlet_contribution[2] += D[2];
 
-		// boundary conditions
+		// boundary conditions (reusing the factorized systems)
 
 		model->model_inlet(model);
-		for (j = 0; j < 9; ++j) A[j] = B[j] = odt * node[0].Jp[j];
-		A[0] += node[0].dx;
-		A[4] += node[0].dx;
-		A[8] += node[0].dx;
-		model_surface_flow_zero_advection_implicit_invert(A, C);
-		model_surface_flow_zero_advection_implicit_multiply
-			(C, model->inlet_contribution, node[0].dU);
-		for (j = 0; j < 3; ++j) node[0].U[j] += node[0].dU[j];
-		for (i = 0; ++i <= n1;)
-		{
-			model_surface_flow_zero_advection_implicit_multiply
-				(B, node[i - 1].dU, D);
-			for (j = 0; j < 9; ++j) A[j] = B[j] = odt * node[i].Jp[j];
-			A[0] += node[i].dx;
-			A[4] += node[i].dx;
-			A[8] += node[i].dx;
-			model_surface_flow_zero_advection_implicit_invert(A, C);
-			model_surface_flow_zero_advection_implicit_multiply
-				(C, D, node[i].dU);
-			for (j = 0; j < 3; ++j) node[i].U[j] += node[i].dU[j];
-		}
-		if (model->channel->type_inlet == 1) node_subcritical_discharge(node);
+		block_multiply(Ip[0], model->inlet_contribution, dU[0]);
+		block_forward(Jp, Ip, NULL, 0., dU, mesh->na);
+		for (i = 0; i <= n1; ++i)
+			for (j = 0; j < 3; ++j) U[j][i] += dU[i][j];
+		if (model->channel->type_inlet == 1)
+			node_subcritical_discharge(mesh, 0);
 		model->model_outlet(model);
-		i = n1;
-		for (j = 0; j < 9; ++j) A[j] = B[j] = - odt * node[i].Jn[j];
-		A[0] += node[i].dx;
-		A[4] += node[i].dx;
-		A[8] += node[i].dx;
-		model_surface_flow_zero_advection_implicit_invert(A, C);
-		model_surface_flow_zero_advection_implicit_multiply
-			(C, model->outlet_contribution, node[i].dU);
-		for (j = 0; j < 3; ++j) node[i].U[j] += node[i].dU[j];
-		do
-		{
-			--i;
-			model_surface_flow_zero_advection_implicit_multiply
-				(B, node[i + 1].dU, D);
-			for (j = 0; j < 9; ++j) A[j] = B[j] = - odt * node[i].Jn[j];
-			A[0] += node[i].dx;
-			A[4] += node[i].dx;
-			A[8] += node[i].dx;
-			model_surface_flow_zero_advection_implicit_invert(A, C);
-			model_surface_flow_zero_advection_implicit_multiply
-				(C, D, node[i].dU);
-			for (j = 0; j < 3; ++j) node[i].U[j] += node[i].dU[j];
-		}
-		while (i > 0);
+		block_multiply(In[n1], model->outlet_contribution, dU[n1]);
+		block_backward(Jn, In, NULL, 0., dU, mesh->na);
+		for (i = 0; i <= n1; ++i)
+			for (j = 0; j < 3; ++j) U[j][i] += dU[i][j];
 
 		model_parameters(model);
 	}
-	while (++iteration < 2);
+	while (model_implicit_iterate(model, ++iteration));
 
 	// implicit source term
 
 	godt = G * odt;
 	for (i = 0; ++i < n1;)
 	{
-		node[i].U[1] += godt * ((node[i].U[0] - node[i].Un[0])
+		U[1][i] += godt * ((U[0][i] - Un[i][0])
 			* (node[i + 1].zb - node[i - 1].zb)
 			/ (node[i + 1].x - node[i - 1].x)
-			+ node[i].Un[0] * node[i].Sfn);
+			+ Un[i][0] * Sfn[i]);
 		if (node[i].f == 0.) continue;
 		k1 = godt * node[i].f;
-		if (node[i].U[1] > 0.)
-			node[i].U[1] = (sqrt(1. + 4 * k1 * node[i].U[1]) - 1.) / (2 * k1);
+		if (U[1][i] > 0.)
+			U[1][i] = (sqrt(1. + 4 * k1 * U[1][i]) - 1.) / (2 * k1);
 		else
-			node[i].U[1] = (1. - sqrt(1. - 4 * k1 * node[i].U[1])) / (2 * k1);
+			U[1][i] = (1. - sqrt(1. - 4 * k1 * U[1][i])) / (2 * k1);
 	}
 }
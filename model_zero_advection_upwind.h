@@ -41,6 +41,8 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 // member functions
 
+void model_surface_flow_zero_advection_upwind_interface(Model *model,
+	unsigned int i);
 void model_surface_flow_zero_advection_upwind(Model *model);
 
 #endif
@@ -38,173 +38,294 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "channel.h"
 #include "node.h"
 #include "mesh.h"
+#include "tridiagonal.h"
 #include "model.h"
 #include "model_zero_inertia.h"
 
 /**
- * \fn void node_discharge_centre_zero_inertia(Node *node)
- * \brief Function to calculate the zero-inertia discharge using centred
- *   derivatives.
- * \param node
- * \brief node struct.
+ * \fn static inline void node_discharge_centre_zero_inertia_template \
+ *   (Model *model, unsigned int i, \
+ *   double (*node_normal_discharge)(Mesh*, unsigned int, double))
+ * \brief Function template to calculate the zero-inertia discharge using
+ *   centred derivatives.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief node number.
+ * \param node_normal_discharge
+ * \brief pointer to the function calculating the node normal discharge.
  */
-void node_discharge_centre_zero_inertia(Node *node)
+static inline void node_discharge_centre_zero_inertia_template
+	(Model *model, unsigned int i,
+	double (*node_normal_discharge)(Mesh*, unsigned int, double))
 {
 	double dz, dz2;
+	Mesh *mesh = model->mesh;
+	Node *node = mesh->node + i;
 	dz = (node->zs - (node + 1)->zs) / node->ix;
 	dz2 = ((node - 1)->zs - node->zs) / (node - 1)->ix;
-	if (dz * dz2 <= 0. || dz <= 0.) node->U[1] = 0.;
-	else node->U[1] = node_normal_discharge(node, fmin(dz, dz2));
+	if (dz * dz2 <= 0. || dz <= 0.) mesh->U[1][i] = 0.;
+	else mesh->U[1][i] = node_normal_discharge(mesh, i, fmin(dz, dz2));
 }
 
 /**
- * \fn void node_discharge_right_zero_inertia(Node *node)
- * \brief Function to calculate the zero-inertia discharge using right
+ * \fn void node_discharge_centre_zero_inertia(Model *model, unsigned int i)
+ * \brief Function to calculate the zero-inertia discharge using centred
  *   derivatives.
- * \param node
- * \brief node struct.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief node number.
  */
-void node_discharge_right_zero_inertia(Node *node)
+void node_discharge_centre_zero_inertia(Model *model, unsigned int i)
+{
+	node_discharge_centre_zero_inertia_template(model, i,
+		model->node_normal_discharge);
+}
+
+/**
+ * \fn static inline void node_discharge_right_zero_inertia_template \
+ *   (Model *model, unsigned int i, \
+ *   double (*node_normal_discharge)(Mesh*, unsigned int, double))
+ * \brief Function template to calculate the zero-inertia discharge using right
+ *   derivatives.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief node number.
+ * \param node_normal_discharge
+ * \brief pointer to the function calculating the node normal discharge.
+ */
+static inline void node_discharge_right_zero_inertia_template
+	(Model *model, unsigned int i,
+	double (*node_normal_discharge)(Mesh*, unsigned int, double))
 {
 	double dz;
+	Mesh *mesh = model->mesh;
+	Node *node = mesh->node + i;
 	dz = node->zs - (node + 1)->zs;
-	if (dz <= 0.) node->U[1] = 0.;
-	else node->U[1] = node_normal_discharge(node, dz / node->ix);
+	if (dz <= 0.) mesh->U[1][i] = 0.;
+	else mesh->U[1][i] = node_normal_discharge(mesh, i, dz / node->ix);
 }
 
 /**
- * \fn void node_discharge_left_zero_inertia(Node *node)
- * \brief Function to calculate the zero-inertia discharge using left
+ * \fn void node_discharge_right_zero_inertia(Model *model, unsigned int i)
+ * \brief Function to calculate the zero-inertia discharge using right
+ *   derivatives.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief node number.
+ */
+void node_discharge_right_zero_inertia(Model *model, unsigned int i)
+{
+	node_discharge_right_zero_inertia_template(model, i,
+		model->node_normal_discharge);
+}
+
+/**
+ * \fn static inline void node_discharge_left_zero_inertia_template \
+ *   (Model *model, unsigned int i, \
+ *   double (*node_normal_discharge)(Mesh*, unsigned int, double))
+ * \brief Function template to calculate the zero-inertia discharge using left
  *   derivatives.
- * \param node
- * \brief node struct.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief node number.
+ * \param node_normal_discharge
+ * \brief pointer to the function calculating the node normal discharge.
  */
-void node_discharge_left_zero_inertia(Node *node)
+static inline void node_discharge_left_zero_inertia_template
+	(Model *model, unsigned int i,
+	double (*node_normal_discharge)(Mesh*, unsigned int, double))
 {
 	double dz;
+	Mesh *mesh = model->mesh;
+	Node *node = mesh->node + i;
 	dz = (node - 1)->zs - node->zs;
-	if (dz <= 0.) node->U[1] = 0.;
-	else node->U[1] = node_normal_discharge(node, dz / (node - 1)->ix);
+	if (dz <= 0.) mesh->U[1][i] = 0.;
+	else mesh->U[1][i] = node_normal_discharge(mesh, i, dz / (node - 1)->ix);
 }
 
 /**
- * \fn void model_node_parameters_zero_inertia(Model *model, Node *node, \
- *   void (*node_discharge)(Node*))
- * \brief Function to calculate the numerical parameters of a node with the
- *   zero-inertia model.
+ * \fn void node_discharge_left_zero_inertia(Model *model, unsigned int i)
+ * \brief Function to calculate the zero-inertia discharge using left
+ *   derivatives.
  * \param model
  * \brief model struct.
- * \param node
- * \brief node struct.
+ * \param i
+ * \brief node number.
+ */
+void node_discharge_left_zero_inertia(Model *model, unsigned int i)
+{
+	node_discharge_left_zero_inertia_template(model, i,
+		model->node_normal_discharge);
+}
+
+/**
+ * \fn static inline void model_node_parameters_zero_inertia_template \
+ *   (Model *model, unsigned int i, \
+ *   void (*node_discharge)(Model*, unsigned int), \
+ *   void (*node_friction)(Mesh*, unsigned int), \
+ *   void (*node_diffusion)(Mesh*, unsigned int), \
+ *   void (*node_infiltration)(Mesh*, unsigned int))
+ * \brief Function template to calculate the numerical parameters of a node
+ *   with the zero-inertia model.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief node number.
  * \param node_discharge
  * \brief pointer to the function to calculate the discharge.
+ * \param node_friction
+ * \brief pointer to the function calculating the node friction.
+ * \param node_diffusion
+ * \brief pointer to the function calculating the node diffusion.
+ * \param node_infiltration
+ * \brief pointer to the function calculating the node infiltration.
  */
-void model_node_parameters_zero_inertia(Model *model, Node *node,
-	void (*node_discharge)(Node*))
+static inline void model_node_parameters_zero_inertia_template
+	(Model *model, unsigned int i, void (*node_discharge)(Model*, unsigned int),
+	void (*node_friction)(Mesh*, unsigned int),
+	void (*node_diffusion)(Mesh*, unsigned int),
+	void (*node_infiltration)(Mesh*, unsigned int))
 {
-	node_width(node);
-	node_perimeter(node);
-	if (node->U[0] <= 0.)
+	Mesh *mesh = model->mesh;
+	Node *node = mesh->node + i;
+	double *A = mesh->U[0], *Q = mesh->U[1], *As = mesh->U[2];
+	double *u = mesh->u, *Sf = mesh->Sf;
+	node_width(mesh, i);
+	node_perimeter(mesh, i);
+	if (A[i] <= 0.)
 	{
-		node->s = node->U[1] = node->u = node->T = node->Sf = node->Kx
-			= node->KxA = 0.;
+		node->s = Q[i] = u[i] = node->T = Sf[i] = node->Kx = node->KxA = 0.;
 	}
-	else if (node->h < model->minimum_depth)
+	else if (mesh->h[i] < model->minimum_depth)
 	{
-		node->s = node->U[2] / node->U[0];
-		node->U[1] = node->u = node->T = node->Sf = node->Kx = node->KxA = 0.;
+		node->s = As[i] / A[i];
+		Q[i] = u[i] = node->T = Sf[i] = node->Kx = node->KxA = 0.;
 	}
 	else
 	{
-		node->s = node->U[2] / node->U[0];
-		node_discharge(node);
-		node->u = node->U[1] / node->U[0];
-		node->T = node->U[1] * node->s;
-		model->node_friction(node);
-		model->node_diffusion(node);
-		node->KxA = node->Kx * node->U[0];
+		node->s = As[i] / A[i];
+		node_discharge(model, i);
+		u[i] = Q[i] / A[i];
+		node->T = Q[i] * node->s;
+		node_friction(mesh, i);
+		node_diffusion(mesh, i);
+		node->KxA = node->Kx * A[i];
 	}
-	model->node_infiltration(node);
+	node_infiltration(mesh, i);
 	node->Pi = node->P * node->i;
 }
 
 /**
- * \fn void model_node_parameters_centre_zero_inertia(Model *model, Node *node)
+ * \fn void model_node_parameters_zero_inertia(Model *model, \
+ *   unsigned int i, void (*node_discharge)(Model*, unsigned int))
+ * \brief Function to calculate the numerical parameters of a node with the
+ *   zero-inertia model.
+ * \param model
+ * \brief model struct.
+ * \param i
+ * \brief node number.
+ * \param node_discharge
+ * \brief pointer to the function to calculate the discharge.
+ */
+void model_node_parameters_zero_inertia(Model *model, unsigned int i,
+	void (*node_discharge)(Model*, unsigned int))
+{
+	model_node_parameters_zero_inertia_template(model, i, node_discharge,
+		model->node_friction, model->node_diffusion, model->node_infiltration);
+}
+
+/**
+ * \fn void model_node_parameters_centre_zero_inertia(Model *model, \
+ *   unsigned int i)
  * \brief Function to calculate the numerical parameters of a node with the
  *   zero-inertia model and centred derivatives.
  * \param model
  * \brief model struct.
- * \param node
- * \brief node struct.
+ * \param i
+ * \brief node number.
  */
-void model_node_parameters_centre_zero_inertia(Model *model, Node *node)
+void model_node_parameters_centre_zero_inertia(Model *model, unsigned int i)
 {
-	model_node_parameters_zero_inertia(model, node,
+	model_node_parameters_zero_inertia(model, i,
 		&node_discharge_centre_zero_inertia);
 }
 
 /**
- * \fn void model_node_parameters_right_zero_inertia(Model *model, Node *node)
+ * \fn void model_node_parameters_right_zero_inertia(Model *model, \
+ *   unsigned int i)
  * \brief Function to calculate the numerical parameters of a node with the
  *   zero-inertia model and right derivatives.
  * \param model
  * \brief model struct.
- * \param node
- * \brief node struct.
+ * \param i
+ * \brief node number.
  */
-void model_node_parameters_right_zero_inertia(Model *model, Node *node)
+void model_node_parameters_right_zero_inertia(Model *model, unsigned int i)
 {
-	model_node_parameters_zero_inertia(model, node,
+	model_node_parameters_zero_inertia(model, i,
 		&node_discharge_right_zero_inertia);
 }
 
 /**
- * \fn void model_node_parameters_left_zero_inertia(Model *model, Node *node)
+ * \fn void model_node_parameters_left_zero_inertia(Model *model, \
+ *   unsigned int i)
  * \brief Function to calculate the numerical parameters of a node with the
  *   zero-inertia model and left derivatives.
  * \param model
  * \brief model struct.
- * \param node
- * \brief node struct.
+ * \param i
+ * \brief node number.
  */
-void model_node_parameters_left_zero_inertia(Model *model, Node *node)
+void model_node_parameters_left_zero_inertia(Model *model, unsigned int i)
 {
-	model_node_parameters_zero_inertia(model, node,
+	model_node_parameters_zero_inertia(model, i,
 		&node_discharge_left_zero_inertia);
 }
 
 /**
- * \fn double node_1dt_max_zero_inertia(Node *node)
+ * \fn double node_1dt_max_zero_inertia(Mesh *mesh, unsigned int i)
  * \brief Function to calculate the allowed maximum time step size in a node
  *   with the zero-inertia model.
- * \param node
- * \brief node struct.
+ * \param mesh
+ * \brief mesh struct.
+ * \param i
+ * \brief node number.
  * \return inverse of the allowed maximum time step size.
  */
-double node_1dt_max_zero_inertia(Node *node)
+double node_1dt_max_zero_inertia(Mesh *mesh, unsigned int i)
 {
-	double u;
-	u =  5./3. * node->u - 4./3. * node->U[1] * sqrt(1 + node->Z * node->Z)
-		/ (node->B * node->P);
-	if (node->u > 0.)
-		u += node->U[0] * pow(node->U[0] / node->P, 4./3.)
+	double u, A = mesh->U[0][i];
+	Node *node = mesh->node + i;
+	u =  5./3. * mesh->u[i] - 4./3. * mesh->U[1][i]
+		* sqrt(1 + node->Z * node->Z) / (node->B * node->P);
+	if (mesh->u[i] > 0.)
+		u += A * node_power_4_3(A / node->P)
 			/ (node->friction_coefficient[0] * node->friction_coefficient[0]
-			* node->u * node->dx);
+			* mesh->u[i] * node->dx);
 	return u / node->dx;
 }
 
 /**
- * \fn void node_flows_zero_inertia(Node *node1)
+ * \fn void node_flows_zero_inertia(Mesh *mesh, unsigned int i, double *dF)
  * \brief Function to calculate the flux differences in a node with the
  *   zero-inertia model.
- * \param node1
- * \brief node struct.
+ * \param mesh
+ * \brief mesh struct.
+ * \param i
+ * \brief number of the left node.
+ * \param dF
+ * \brief flux difference vector.
  */
-void node_flows_zero_inertia(Node *node1)
+void node_flows_zero_inertia(Mesh *mesh, unsigned int i, double *dF)
 {
-	Node *node2 = node1 + 1;
-	node1->dF[0] = node2->U[1] - node1->U[1];
-	node1->dF[2] = node2->T - node1->T;
+	Node *node1 = mesh->node + i, *node2 = node1 + 1;
+	dF[0] = mesh->U[1][i + 1] - mesh->U[1][i];
+	dF[2] = node2->T - node1->T;
 }
 
 /**
@@ -220,9 +341,74 @@ double model_inlet_dtmax_zero_inertia(Model *model)
 	double A, Q, h, B, c;
 	Node *node = model->mesh->node;
 	Q = hydrogram_discharge(model->channel->water_inlet, model->t);
-	h = node_critical_depth(node, Q);
+	h = model_inlet_critical_depth(model, Q);
+	if (h <= 0.) return INFINITY;
 	A = h * (node->B0 + h * node->Z);
 	B = node->B0 + 2 * h * node->Z;
 	c = sqrt(G * A / B);
 	return node->ix / c;
 }
+
+#if SPECIALIZED_KERNELS
+
+/**
+ * \def MODEL_PARAMETERS_ZERO_INERTIA
+ * \brief Macro template defining the functions to calculate the model
+ *   parameters with the zero-inertia model and a friction model.
+ * \param friction
+ * \brief suffix of the friction model functions.
+ */
+#define MODEL_PARAMETERS_ZERO_INERTIA(friction) \
+static void node_discharge_centre_zero_inertia_##friction(Model *model, \
+	unsigned int i) \
+{ \
+	node_discharge_centre_zero_inertia_template(model, i, \
+		node_normal_discharge_##friction); \
+} \
+static void node_discharge_right_zero_inertia_##friction(Model *model, \
+	unsigned int i) \
+{ \
+	node_discharge_right_zero_inertia_template(model, i, \
+		node_normal_discharge_##friction); \
+} \
+static void node_discharge_left_zero_inertia_##friction(Model *model, \
+	unsigned int i) \
+{ \
+	node_discharge_left_zero_inertia_template(model, i, \
+		node_normal_discharge_##friction); \
+} \
+static void model_node_parameters_centre_zero_inertia_##friction(Model *model, \
+	unsigned int i) \
+{ \
+	model_node_parameters_zero_inertia_template(model, i, \
+		node_discharge_centre_zero_inertia_##friction, \
+		node_friction_##friction, \
+		node_diffusion_Rutherford, node_infiltration_KostiakovLewis); \
+} \
+static void model_node_parameters_right_zero_inertia_##friction(Model *model, \
+	unsigned int i) \
+{ \
+	model_node_parameters_zero_inertia_template(model, i, \
+		node_discharge_right_zero_inertia_##friction, \
+		node_friction_##friction, \
+		node_diffusion_Rutherford, node_infiltration_KostiakovLewis); \
+} \
+static void model_node_parameters_left_zero_inertia_##friction(Model *model, \
+	unsigned int i) \
+{ \
+	model_node_parameters_zero_inertia_template(model, i, \
+		node_discharge_left_zero_inertia_##friction, \
+		node_friction_##friction, \
+		node_diffusion_Rutherford, node_infiltration_KostiakovLewis); \
+} \
+MODEL_PARAMETERS_KERNEL(model_parameters_zero_inertia_##friction, \
+	model_node_parameters_right_zero_inertia_##friction, \
+	model_node_parameters_centre_zero_inertia_##friction, \
+	model_node_parameters_left_zero_inertia_##friction)
+
+MODEL_PARAMETERS_ZERO_INERTIA(Manning)
+MODEL_PARAMETERS_ZERO_INERTIA(Manning_minimizing_losses)
+
+MODEL_1DT_MAX_KERNEL(model_1dt_max_zero_inertia, node_1dt_max_zero_inertia)
+
+#endif
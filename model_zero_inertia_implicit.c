@@ -39,6 +39,7 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "channel.h"
 #include "node.h"
 #include "mesh.h"
+#include "tridiagonal.h"
 #include "model.h"
 #include "model_zero_inertia.h"
 #include "model_zero_inertia_implicit.h"
@@ -106,35 +107,42 @@ void model_surface_flow_zero_inertia_implicit_invert(double *m, double *i)
 void model_surface_flow_zero_inertia_stabilize(Model *model)
 {
 	unsigned int i, k;
-	double zmax, dA, dA2;
+	double zmax, dA, dA2, r;
 	Mesh *mesh = model->mesh;
 	Node *node = mesh->node;
+	double **U = mesh->U;
 
+	// the areas moved between nodes are scaled by the cell sizes ratios to
+	// conserve the volume, also on uniform meshes where the end cells are half
+	// cells
 	zmax = node[0].zs;
-	for (i = k = 0; ++i < mesh->n;)
+	for (i = k = 0; ++i < mesh->na;)
 	{
 		if (node[i].zs > node[i - 1].zs)
 		{
-			dA = node[i].U[0] - node_area_with_level(node + i, node[i - 1].zs);
-			dA2 = node_area_with_level(node + i - 1, zmax) - node[i - 1].U[0];
+			r = node[i].dx / node[i - 1].dx;
+			dA = U[0][i] - node_area_with_level(node + i, node[i - 1].zs);
+			dA2 = (node_area_with_level(node + i - 1, zmax) - U[0][i - 1])
+				/ r;
 			if (dA > dA2)
 			{
-				node[i - 1].U[0] += dA2;
+				U[0][i - 1] += r * dA2;
 				dA -= dA2;
-				node[i].U[0] -= dA;
-				if (i < mesh->n - 1)
+				U[0][i] -= dA;
+				if (i < mesh->na - 1)
 				{
-					node[i + 1].U[0] += dA - dA2;
-					node_depth(node + i + 1);
+					U[0][i + 1]
+						+= (dA - dA2) * node[i].dx / node[i + 1].dx;
+					node_depth(mesh, i + 1);
 				}
 			}
 			else
 			{
-				node[i - 1].U[0] += dA;
-				node[i].U[0] -= dA;
+				U[0][i - 1] += r * dA;
+				U[0][i] -= dA;
 			}
-			node_depth(node + i - 1);
-			node_depth(node + i);
+			node_depth(mesh, i - 1);
+			node_depth(mesh, i);
 			k = 1;
 		}
 		zmax = node[i - 1].zs;
@@ -154,28 +162,32 @@ void model_surface_flow_zero_inertia_implicit(Model *model)
 	unsigned int i, j, n1, iteration;
 	Mesh *mesh = model->mesh;
 	Node *node = mesh->node;
+	double **U = mesh->U;
+	double (*dF)[3] = mesh->dF, (*Un)[3] = mesh->Un, (*dU)[3] = mesh->dU,
+		(*Jp)[9] = mesh->Jp, (*Jn)[9] = mesh->Jn, *Sfn = mesh->Sfn;
 	double k, l1, l2, odt, A[9], B[9], C[9], D[3],
 		inlet_contribution[3], outlet_contribution[3],
-		CC[mesh->n], DD[mesh->n], EE[mesh->n];
+		*CC = model->tridiagonal->C, *DD = model->tridiagonal->D,
+		*EE = model->tridiagonal->E, *HH = model->tridiagonal->H;
 
-	n1 = mesh->n - 1;
+	n1 = mesh->na - 1;
 
 	// saving some former time step variables
 
-	for (i = 0; i < mesh->n; ++i)
+	for (i = 0; i < mesh->na; ++i)
 	{
-		for (j = 0; j < 3; ++j) node[i].Un[j] = node[i].U[j];
-		node[i].Sfn = node[i].Sf;
+		for (j = 0; j < 3; ++j) Un[i][j] = U[j][i];
+		Sfn[i] = mesh->Sf[i];
 	}
 
 	// explicit part
 
-	inlet_contribution[0] = - model->dt * node[0].U[1];
+	inlet_contribution[0] = - model->dt * U[1][0];
 	inlet_contribution[2] = - model->dt * node[0].T;
-	outlet_contribution[0] = model->dt * node[n1].U[1];
+	outlet_contribution[0] = model->dt * U[1][n1];
 	outlet_contribution[2] = model->dt * node[n1].T;
 
-	for (i = 0; i < n1; ++i) node_flows_zero_inertia(node + i);
+	for (i = 0; i < n1; ++i) node_flows_zero_inertia(mesh, i, dF[i]);
 
 	// implicit part
 
@@ -192,116 +204,106 @@ void model_surface_flow_zero_inertia_implicit(Model *model)
 
 		// implicit operators
 
-		for (i = 0; i < mesh->n; ++i)
+		for (i = 0; i < mesh->na; ++i)
 		{
-			if (node[i].h <= model->minimum_depth || node[i].U[1] == 0.)
+			if (mesh->h[i] <= model->minimum_depth || U[1][i] == 0.)
 			{
-				for (j = 0; j < 4; ++j) node[i].Jp[j] = 0.;
-				node[i].Jn[0] = 0.;
+				for (j = 0; j < 4; ++j) Jp[i][j] = 0.;
+				Jn[i][0] = 0.;
 				continue;
 			}
-			l1 = node[i].U[1] * (5./3. / node[i].U[0]
+			l1 = U[1][i] * (5./3. / U[0][i]
 				- 4./3. * sqrt(1 + node[i].Z * node[i].Z)
 				/ (node[i].B * node[i].P));
-			l2 = 0.5 * node[i].U[0] * node[i].U[0]
-				* pow(node[i].U[0] / node[i].P, 4./3.)
-				/ (node[i].U[1] * node[i].friction_coefficient[0]
+			l2 = 0.5 * U[0][i] * U[0][i]
+				* node_power_4_3(U[0][i] / node[i].P)
+				/ (U[1][i] * node[i].friction_coefficient[0]
 				* node[i].friction_coefficient[0] * node[i].B * node[i].dx);
-			node[i].Jp[0] = l1;
-			node[i].Jp[1] = 0.;
-			node[i].Jp[2] = (l1 - node[i].u) * node[i].s;
-			node[i].Jp[3] = node[i].u;
-			node[i].Jn[0] = - l2;
-//			node[i].Jn[0] = 0.;
+			Jp[i][0] = l1;
+			Jp[i][1] = 0.;
+			Jp[i][2] = (l1 - mesh->u[i]) * node[i].s;
+			Jp[i][3] = mesh->u[i];
+			Jn[i][0] = - l2;
+//			Jn[i][0] = 0.;
 		}
 
 		// variables updating
 
-		for (j = 0; j < 4; ++j) B[j] = odt * node[0].Jp[j];
-		node[0].dU[0] = node[0].dU[2] = 0.;
-		node[0].U[0] = node[0].Un[0];
-		node[0].U[2] = node[0].Un[2];
+		for (j = 0; j < 4; ++j) B[j] = odt * Jp[0][j];
+		dU[0][0] = dU[0][2] = 0.;
+		U[0][0] = Un[0][0];
+		U[2][0] = Un[0][2];
 		for (i = 0; ++i <= n1;)
 		{
 			model_surface_flow_zero_inertia_implicit_multiply
-				(B, node[i - 1].dU, D);
-			for (j = 0; j < 4; ++j) A[j] = B[j] = odt * node[i].Jp[j];
+				(B, dU[i - 1], D);
+			for (j = 0; j < 4; ++j) A[j] = B[j] = odt * Jp[i][j];
 			A[0] += node[i].dx;
 			A[3] += node[i].dx;
 			model_surface_flow_zero_inertia_implicit_invert(A, C);
-			D[0] -= model->dt * node[i - 1].dF[0];
-			D[2] -= model->dt * node[i - 1].dF[2];
-			model_surface_flow_zero_inertia_implicit_multiply(C, D, node[i].dU);
-			node[i].U[0] = node[i].Un[0] + node[i].dU[0];
-			node[i].U[2] = node[i].Un[2] + node[i].dU[2];
+			D[0] -= model->dt * dF[i - 1][0];
+			D[2] -= model->dt * dF[i - 1][2];
+			model_surface_flow_zero_inertia_implicit_multiply(C, D, dU[i]);
+			U[0][i] = Un[i][0] + dU[i][0];
+			U[2][i] = Un[i][2] + dU[i][2];
 		}
 		i = n1;
-		model_surface_flow_zero_inertia_implicit_multiply(B, node[i].dU, D);
+		model_surface_flow_zero_inertia_implicit_multiply(B, dU[i], D);
 		model->outlet_contribution[0] += D[0];
 		model->outlet_contribution[2] += D[2];
 
-		for (i = 0; i < mesh->n; ++i)
+		for (i = 0; i < mesh->na; ++i)
 		{
 			DD[i] = node[i].dx;
-			node[i].dU[0] *= node[i].dx;
+			HH[i] = dU[i][0] * node[i].dx;
 		}
 		for (i = 0; i < n1; ++i)
 		{
-			k = odt * fmin(node[i + 1].Jn[0], node[i].Jn[0]);
+			k = odt * fmin(Jn[i + 1][0], Jn[i][0]);
 			CC[i] = EE[i] = k;
 			DD[i] -= k;
 			DD[i + 1] -= k;
 		}
-		for (i = 0; i < n1; ++i)
-		{
-			if (DD[i] == 0.) k = 0; else k = CC[i] / DD[i];
-			DD[i + 1] -= k * EE[i];
-			node[i + 1].dU[0] -= k * node[i].dU[0];
-		}
-		if (DD[i] == 0.) node[i].dU[0] = 0; else node[i].dU[0] /= DD[i];
-		node[i].U[0] = node[i].Un[0] + node[i].dU[0];
-		do
+		tridiagonal_solve(model->tridiagonal, mesh->na);
+		for (i = 0; i < mesh->na; ++i)
 		{
-			--i;
-			if (DD[i] == 0.) node[i].dU[0] = 0;
-			else node[i].dU[0] = (node[i].dU[0] - EE[i] * node[i+1].dU[0])
-				/ DD[i];
-			node[i].U[0] = node[i].Un[0] + node[i].dU[0];
+			dU[i][0] = HH[i];
+			U[0][i] = Un[i][0] + dU[i][0];
 		}
-		while (i > 0);
 
 		// boundary conditions
 
 		model->model_inlet(model);
-		for (j = 0; j < 4; ++j) A[j] = B[j] = odt * node[0].Jp[j];
+		for (j = 0; j < 4; ++j) A[j] = B[j] = odt * Jp[0][j];
 		A[0] += node[0].dx;
 		A[3] += node[0].dx;
 		model_surface_flow_zero_inertia_implicit_invert(A, C);
 		model_surface_flow_zero_inertia_implicit_multiply
-			(C, model->inlet_contribution, node[0].dU);
-		node[0].U[0] += node[0].dU[0];
-		node[0].U[2] += node[0].dU[2];
+			(C, model->inlet_contribution, dU[0]);
+		U[0][0] += dU[0][0];
+		U[2][0] += dU[0][2];
 		for (i = 0; ++i <= n1;)
 		{
 			model_surface_flow_zero_inertia_implicit_multiply
-				(B, node[i - 1].dU, D);
-			for (j = 0; j < 4; ++j) A[j] = B[j] = odt * node[i].Jp[j];
+				(B, dU[i - 1], D);
+			for (j = 0; j < 4; ++j) A[j] = B[j] = odt * Jp[i][j];
 			A[0] += node[i].dx;
 			A[3] += node[i].dx;
 			model_surface_flow_zero_inertia_implicit_invert(A, C);
-			model_surface_flow_zero_inertia_implicit_multiply(C, D, node[i].dU);
-			node[i].U[0] += node[i].dU[0];
-			node[i].U[2] += node[i].dU[2];
+			model_surface_flow_zero_inertia_implicit_multiply(C, D, dU[i]);
+			U[0][i] += dU[i][0];
+			U[2][i] += dU[i][2];
 		}
-		if (model->channel->type_inlet == 1) node_subcritical_discharge(node);
+		if (model->channel->type_inlet == 1)
+			node_subcritical_discharge(mesh, 0);
 		model->model_outlet(model);
 		i = n1;
-		node[i].U[0] += model->outlet_contribution[0] / node[i].dx;
-		node[i].U[2] += model->outlet_contribution[2] / node[i].dx;
+		U[0][i] += model->outlet_contribution[0] / node[i].dx;
+		U[2][i] += model->outlet_contribution[2] / node[i].dx;
 
 		model_parameters(model);
 
 		model_surface_flow_zero_inertia_stabilize(model);
 	}
-	while (++iteration < 1);
+	while (model_implicit_iterate(model, ++iteration));
 }
@@ -39,6 +39,7 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "channel.h"
 #include "node.h"
 #include "mesh.h"
+#include "tridiagonal.h"
 #include "model.h"
 #include "model_zero_inertia.h"
 #include "model_zero_inertia_upwind.h"
@@ -54,24 +55,37 @@ void model_surface_flow_zero_inertia_upwind(Model *model)
 	unsigned int i;
 	Mesh *mesh = model->mesh;
 	Node *node = mesh->node;
+	double **U = mesh->U;
+	double (*dF)[3] = mesh->dF;
 
-	model->inlet_contribution[0] = - model->dt * node[0].U[1];
+	model->inlet_contribution[0] = - model->dt * U[1][0];
 	model->inlet_contribution[2] = - model->dt * node[0].T;
 
 	// variables updating
 
-	for (i = 0; ++i < mesh->n;)
+	if (mesh->na < PARALLEL_MINIMUM_NODES)
+		for (i = 1; i < mesh->na; ++i)
+		{
+			node_flows_zero_inertia(mesh, i - 1, dF[i - 1]);
+			U[0][i] -= model->dt * dF[i - 1][0] / node[i].dx;
+			U[2][i] -= model->dt * dF[i - 1][2] / node[i].dx;
+		}
+	else
 	{
-		node_flows_zero_inertia(node + i - 1);
-		node[i].U[0] -= model->dt * node[i - 1].dF[0] / node[i].dx;
-		node[i].U[2] -= model->dt * node[i - 1].dF[2] / node[i].dx;
+#pragma omp parallel for
+		for (i = 1; i < mesh->na; ++i)
+		{
+			node_flows_zero_inertia(mesh, i - 1, dF[i - 1]);
+			U[0][i] -= model->dt * dF[i - 1][0] / node[i].dx;
+			U[2][i] -= model->dt * dF[i - 1][2] / node[i].dx;
+		}
 	}
 
 	// boundary correction
 
 	model->model_inlet(model);
-	node[0].U[0] += model->inlet_contribution[0] / node[0].dx;
-	node[0].U[2] += model->inlet_contribution[2] / node[0].dx;
-	if (model->channel->type_inlet == 1) node_subcritical_discharge(node);
+	U[0][0] += model->inlet_contribution[0] / node[0].dx;
+	U[2][0] += model->inlet_contribution[2] / node[0].dx;
+	if (model->channel->type_inlet == 1) node_subcritical_discharge(mesh, 0);
 	model->model_outlet(model);
 }
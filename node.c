@@ -33,12 +33,13 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  * \copyright Copyright 2011-2014, Javier Burguete Tolosa.
  */
 #include <stdio.h>
+#include <string.h>
+#include <stdint.h>
 #include <math.h>
 #include "config.h"
 #include "channel.h"
 #include "node.h"
-
-double (*node_normal_discharge)(Node *node, double S);
+#include "mesh.h"
 
 /**
  * \fn void node_init(Node *node, Geometry *geometry)
@@ -84,202 +85,323 @@ void node_init(Node *node, Geometry *geometry)
 }
 
 /**
- * \fn void node_depth(Node *node)
+ * \fn void node_depth(Mesh *mesh, unsigned int i)
  * \brief Function to calculate the depth in a mesh node.
- * \param node
- * \brief node struct.
+ * \param mesh
+ * \brief mesh struct.
+ * \param i
+ * \brief node number.
  */
-void node_depth(Node *node)
+void node_depth(Mesh *mesh, unsigned int i)
 {
+	Node *node = mesh->node + i;
 	if (node->Z == 0.)
-		node->h = node->U[0] / node->B0;
+		mesh->h[i] = mesh->U[0][i] / node->B0;
 	else
-		node->h = (sqrt(node->B0 * node->B0 + 4. * node->U[0] * node->Z)
+		mesh->h[i] = (sqrt(node->B0 * node->B0 + 4. * mesh->U[0][i] * node->Z)
 			- node->B0) / (2 * node->Z);
-	node->zs = node->zb + node->h;
+	node->zs = node->zb + mesh->h[i];
 }
 
 /**
- * \fn void node_width(Node *node)
+ * \fn void node_width(Mesh *mesh, unsigned int i)
  * \brief Function to calculate the width in a mesh node.
- * \param node
- * \brief node struct.
+ * \param mesh
+ * \brief mesh struct.
+ * \param i
+ * \brief node number.
  */
-void node_width(Node *node)
+void node_width(Mesh *mesh, unsigned int i)
 {
-	node->B = node->B0 + 2 * node->Z * node->h;
+	Node *node = mesh->node + i;
+	node->B = node->B0 + 2 * node->Z * mesh->h[i];
 }
 
 /**
- * \fn void node_perimeter(Node *node)
+ * \fn void node_perimeter(Mesh *mesh, unsigned int i)
  * \brief Function to calculate the wetted perimeter in a mesh node.
- * \param node
- * \brief node struct.
+ * \param mesh
+ * \brief mesh struct.
+ * \param i
+ * \brief node number.
  */
-void node_perimeter(Node *node)
+void node_perimeter(Mesh *mesh, unsigned int i)
 {
-	node->P = node->B0 + 2 * sqrt(1 + node->Z * node->Z) * node->h;
+	Node *node = mesh->node + i;
+	node->P = node->B0 + 2 * sqrt(1 + node->Z * node->Z) * mesh->h[i];
 }
 
 /**
- * \fn void node_critical_velocity(Node *node)
- * \brief  * \brief Function to calculate the critical velocity in a mesh node
- * \param node
- * \brief node struct.
+ * \fn void node_critical_velocity(Mesh *mesh, unsigned int i)
+ * \brief Function to calculate the critical velocity in a mesh node
+ * \param mesh
+ * \brief mesh struct.
+ * \param i
+ * \brief node number.
  */
 
-void node_critical_velocity(Node *node)
+void node_critical_velocity(Mesh *mesh, unsigned int i)
 {
-	if (node->B > 0.) node->c = sqrt(G * node->U[0] / node->B); else node->c = 0.;
+	Node *node = mesh->node + i;
+	if (node->B > 0.) mesh->c[i] = sqrt(G * mesh->U[0][i] / node->B);
+	else mesh->c[i] = 0.;
 }
 
 /**
- * \fn void node_subcritical_discharge(Node *node)
+ * \fn void node_subcritical_discharge(Mesh *mesh, unsigned int i)
  * \brief Function to force a subcritical discharge in a mesh node.
- * \param node
- * \brief node struct.
+ * \param mesh
+ * \brief mesh struct.
+ * \param i
+ * \brief node number.
  */
-void node_subcritical_discharge(Node *node)
+void node_subcritical_discharge(Mesh *mesh, unsigned int i)
 {
-	node_depth(node);
-	node_width(node);
-	node_critical_velocity(node);
-	node->U[1] = fmin(node->U[1], 0.99 * node->U[0] * node->c);
+	node_depth(mesh, i);
+	node_width(mesh, i);
+	node_critical_velocity(mesh, i);
+	mesh->U[1][i] = fmin(mesh->U[1][i], 0.99 * mesh->U[0][i] * mesh->c[i]);
 }
 
 /**
- * \fn double node_critical_depth(Node *node, double Q)
+ * \fn void node_dry(Mesh *mesh, unsigned int i)
+ * \brief Function to move a negative wetted cross sectional area of a mesh node
+ *   to the infiltrated water, as the infiltration model does at the end of a
+ *   time step.
+ * \param mesh
+ * \brief mesh struct.
+ * \param i
+ * \brief node number.
+ */
+void node_dry(Mesh *mesh, unsigned int i)
+{
+	double **U = mesh->U;
+	double s = mesh->node[i].s;
+	if (U[0][i] >= 0.) return;
+	U[3][i] += U[0][i];
+	U[4][i] += U[0][i] * s;
+	U[2][i] -= U[0][i] * s;
+	U[0][i] = 0.;
+}
+
+/**
+ * \fn double node_critical_depth(Node *node, double Q, double tolerance)
  * \brief Function to calculate the critical depth in a mesh node.
+ *
+ * The critical depth is analytic in rectangular and triangular cross sections.
+ * In trapezoidal sections the Newton method is applied to the convex and
+ * increasing function \f$G\,A^3-Q^2\,B\f$ from the smallest of the rectangular
+ * and triangular critical depths, an upper bound, so the iterations decrease
+ * monotonically to the solution.
  * \param node
  * \brief node struct.
  * \param Q
  * \brief discharge.
+ * \param tolerance
+ * \brief relative accuracy calculating the critical depth.
  * \return critical depth.
  */
-double node_critical_depth(Node *node, double Q)
+double node_critical_depth(Node *node, double Q, double tolerance)
 {
-	double h[3], A[3], B[3], u[3], c[3];
+	unsigned int i;
+	double h, h2, A, B, Q2;
+	if (Q <= 0.) return 0.;
+	Q2 = Q * Q;
 
-	// searching a subcritical depth
+	// rectangular and triangular cross sections
+	if (node->Z == 0.) return cbrt(Q2 / (G * node->B0 * node->B0));
+	h = pow(2. * Q2 / (G * node->Z * node->Z), 0.2);
+	if (node->B0 == 0.) return h;
 
-	h[0] = 1.;
-	do
+	// trapezoidal cross sections
+	h = fmin(h, cbrt(Q2 / (G * node->B0 * node->B0)));
+	for (i = 0; i < 64; ++i)
 	{
-		h[0] *= 2;
-		A[0] = h[0] * (node->B0 + h[0] * node->Z);
-		B[0] = node->B0 + 2 * h[0] * node->Z;
-		c[0] = G * A[0] / B[0];
-		u[0] = Q / A[0];
-		u[0] = u[0] * u[0];
+		A = h * (node->B0 + h * node->Z);
+		B = node->B0 + 2. * h * node->Z;
+		h2 = h - (G * A * A * A - Q2 * B)
+			/ (3. * G * A * A * B - 2. * Q2 * node->Z);
+		if (!(h2 > 0.)) h2 = 0.5 * h;
+		if (h - h2 <= tolerance * h2) return h2;
+		h = h2;
 	}
-	while (u[0] > c[0]);
-
-	// searching a supercritical depth
+	return h;
+}
 
-	h[1] = h[0];
-	do
-	{
-		h[1] *= 0.5;
-		A[1] = h[1] * (node->B0 + h[1] * node->Z);
-		B[1] = node->B0 + 2 * h[1] * node->Z;
-		c[1] = G * A[1] / B[1];
-		u[1] = Q / A[1];
-		u[1] = u[1] * u[1];
-	}
-	while (u[1] < c[1]);
+/**
+ * \fn double node_cbrt(double x)
+ * \brief Function to calculate the cube root of a number.
+ *
+ * With FAST_POWERS the cube root of a finite positive number is estimated from
+ * its binary representation and refined by two Halley iterations, with a
+ * relative error lower than 1e-14.
+ * \param x
+ * \brief number.
+ * \return cube root.
+ */
+double node_cbrt(double x)
+{
+#if FAST_POWERS
+	uint64_t i;
+	double y, y3;
+	if (!(x > 0.) || x == INFINITY) return cbrt(x);
+	memcpy(&i, &x, sizeof(double));
+	i = i / 3 + 0x2a9f7893782da1ceULL;
+	memcpy(&y, &i, sizeof(double));
+	y3 = y * y * y;
+	y *= (y3 + 2. * x) / (2. * y3 + x);
+	y3 = y * y * y;
+	y *= (y3 + 2. * x) / (2. * y3 + x);
+	return y;
+#else
+	return cbrt(x);
+#endif
+}
 
-	// searching the critical depth by a middle point algorithm
+/**
+ * \fn double node_power_4_3(double x)
+ * \brief Function to calculate the 4/3 power of a number.
+ * \param x
+ * \brief number.
+ * \return 4/3 power.
+ */
+double node_power_4_3(double x)
+{
+#if FAST_POWERS
+	return x * node_cbrt(x);
+#else
+	return pow(x, 4./3.);
+#endif
+}
 
-	do
-	{
-		h[2] = 0.5 * (h[0] + h[1]);
-		A[2] = h[2] * (node->B0 + h[2] * node->Z);
-		B[2] = node->B0 + 2 * h[2] * node->Z;
-		c[2] = G * A[2] / B[2];
-		u[2] = Q / A[2];
-		u[2] = u[2] * u[2];
-		if (u[2] < c[1]) h[0] = h[2]; else h[1] = h[2];
+/**
+ * \fn double node_power_m4_3(double x)
+ * \brief Function to calculate the -4/3 power of a number.
+ * \param x
+ * \brief number.
+ * \return -4/3 power.
+ */
+double node_power_m4_3(double x)
+{
+#if FAST_POWERS
+	return 1. / (x * node_cbrt(x));
+#else
+	return pow(x, -4./3.);
+#endif
+}
 
-	}
-	while (h[0] - h[1] > critical_depth_tolerance);
-	return 0.5 * (h[0] + h[1]);
+/**
+ * \fn double node_power_2_3(double x)
+ * \brief Function to calculate the 2/3 power of a number.
+ * \param x
+ * \brief number.
+ * \return 2/3 power.
+ */
+double node_power_2_3(double x)
+{
+#if FAST_POWERS
+	x = node_cbrt(x);
+	return x * x;
+#else
+	return pow(x, 2./3.);
+#endif
 }
 
 /**
- * \fn void node_friction_Manning(Node *node)
+ * \fn void node_friction_Manning(Mesh *mesh, unsigned int i)
  * \brief Function to calculate the friction slope with the Manning model.
- * \param node
- * \brief node struct.
+ * \param mesh
+ * \brief mesh struct.
+ * \param i
+ * \brief node number.
  */
-void node_friction_Manning(Node *node)
+void node_friction_Manning(Mesh *mesh, unsigned int i)
 {
+	double A = mesh->U[0][i], Q = mesh->U[1][i];
+	Node *node = mesh->node + i;
 	node->f = node->friction_coefficient[0] * node->friction_coefficient[0]
-		* pow(node->P / node->U[0], 4./3.) / (node->U[0] * node->U[0]);
-	node->Sf = node->f * node->U[1] * fabs(node->U[1]);
+		* node_power_4_3(node->P / A) / (A * A);
+	mesh->Sf[i] = node->f * Q * fabs(Q);
 	node->beta = 1.;
 }
 
-double node_normal_discharge_Manning(Node *node, double S)
+double node_normal_discharge_Manning(Mesh *mesh, unsigned int i, double S)
 {
-	return sqrt(S) * node->U[0] * pow(node->U[0] / node->P, 2./3.)
+	double A = mesh->U[0][i];
+	Node *node = mesh->node + i;
+	return sqrt(S) * A * node_power_2_3(A / node->P)
 		/ node->friction_coefficient[0];
 }
 
 /**
- * \fn void node_friction_Manning_minimizing_losses(Node *node)
+ * \fn void node_friction_Manning_minimizing_losses(Mesh *mesh, \
+ *   unsigned int i)
  * \brief Function to calculate the friction slope with the Manning model and
  *   minimizing energy losses velocity distribution in the cross section.
- * \param node
- * \brief node struct.
+ * \param mesh
+ * \brief mesh struct.
+ * \param i
+ * \brief node number.
  */
-void node_friction_Manning_minimizing_losses(Node *node)
+void node_friction_Manning_minimizing_losses(Mesh *mesh, unsigned int i)
 {
-	double k;
-	node->f1 = node->B0 + node->Z * node->h;
-	node->f2 = node->B0 + 0.75 * node->Z * node->h;
-	node->f3 = node->B0 + 0.6 * node->Z * node->h;
-	k = node->friction_coefficient[0] * node->f1 / (node->f2 * node->U[0]);
-	node->f = pow(node->h, -4./3.) * k * k;
-	node->Sf = node->f * node->U[1] * fabs(node->U[1]);
-	node->beta = 49/48. * node->f1 * node->f3 / (node->f2 * node->f2);
+	double k, f1, f2, f3, Q = mesh->U[1][i];
+	double h = mesh->h[i];
+	Node *node = mesh->node + i;
+	f1 = node->B0 + node->Z * h;
+	f2 = node->B0 + 0.75 * node->Z * h;
+	f3 = node->B0 + 0.6 * node->Z * h;
+	k = node->friction_coefficient[0] * f1 / (f2 * mesh->U[0][i]);
+	node->f = node_power_m4_3(h) * k * k;
+	mesh->Sf[i] = node->f * Q * fabs(Q);
+	node->beta = 49/48. * f1 * f3 / (f2 * f2);
 }
 
-double node_normal_discharge_Manning_minimizing_losses(Node *node, double S)
+double node_normal_discharge_Manning_minimizing_losses(Mesh *mesh,
+	unsigned int i, double S)
 {
 	double f1, f2;
-	f1 = node->B0 + node->Z * node->h;
-	f2 = node->B0 + 0.75 * node->Z * node->h;
-	return sqrt(S) * node->U[0] * pow(node->h, 2./3.) * f2
+	double h = mesh->h[i];
+	Node *node = mesh->node + i;
+	f1 = node->B0 + node->Z * h;
+	f2 = node->B0 + 0.75 * node->Z * h;
+	return sqrt(S) * mesh->U[0][i] * node_power_2_3(h) * f2
 		/ (node->friction_coefficient[0] * f1);
 }
 
 /**
- * \fn void node_infiltration_KostiakovLewis(Node *node)
+ * \fn void node_infiltration_KostiakovLewis(Mesh *mesh, unsigned int i)
  * \brief Function to calculate the infiltration with the Kostiakov-Lewis model.
- * \param node
- * \brief node struct.
+ * \param mesh
+ * \brief mesh struct.
+ * \param i
+ * \brief node number.
  */
 
-void node_infiltration_KostiakovLewis(Node *node)
+void node_infiltration_KostiakovLewis(Mesh *mesh, unsigned int i)
 {
+	Node *node = mesh->node + i;
 	node->i = node->infiltration_coefficient[2];
 	if (node->infiltration_coefficient[0] == 0.) return;
 	node->i += node->infiltration_coefficient[0] *
 		node->infiltration_coefficient[1]
-		* pow(node->U[3] / (node->infiltration_coefficient[0]
+		* pow(mesh->U[3][i] / (node->infiltration_coefficient[0]
 		* node->infiltration_coefficient[3]),
 		1. - 1. / node->infiltration_coefficient[1]);
 }
 
 /**
- * \fn void node_diffusion_Rutherford(Node *node)
+ * \fn void node_diffusion_Rutherford(Mesh *mesh, unsigned int i)
  * \brief Function to calculate the diffusion coefficient with the Rutherford
  *   model.
- * \param node
- * \brief node struct.
+ * \param mesh
+ * \brief mesh struct.
+ * \param i
+ * \brief node number.
  */
-void node_diffusion_Rutherford(Node *node)
+void node_diffusion_Rutherford(Mesh *mesh, unsigned int i)
 {
+	Node *node = mesh->node + i;
 	node->Kx = node->diffusion_coefficient[0]
-		* sqrt(G * node->P * node->U[0] * fabs(node->Sf));
+		* sqrt(G * node->P * mesh->U[0][i] * fabs(mesh->Sf[i]));
 }
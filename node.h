@@ -40,6 +40,11 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 /**
  * \struct _Node
  * \brief Struct to define a mesh node.
+ *
+ * Only the geometry, the coefficients and the derived parameters of a node are
+ * stored here. The conserved variables, the depth, the velocity, the critical
+ * velocity and the friction slope are stored per field in the Mesh struct, so
+ * the loops over the mesh read contiguous arrays.
  */
 struct _Node
 {
@@ -56,26 +61,10 @@ struct _Node
  * \brief cell size.
  * \var ix
  * \brief cell distance.
- * \var U
- * \brief conserved variables vector.
  * \var s
  * \brief surface solute concentration.
- * \var si
- * \brief infiltrated solute concentration.
- * \var h
- * \brief depth.
- * \var Sf
- * \brief friction slope.
- * \var Sfn
- * \brief former time step friction slope.
  * \var f
  * \brief friction factor (\f$S_f = f Q |Q|\f$).
- * \var f1
- * \brief geometry factor (\f$f1 = B_0 + Z H\f$).
- * \var f2
- * \brief geometry factor (\f$f2 = B_0 + \frac34 Z H\f$).
- * \var f3
- * \brief geometry factor (\f$f3 = B_0 + \frac35 Z H\f$).
  * \var zb
  * \brief bottom level.
  * \var zs
@@ -86,10 +75,6 @@ struct _Node
  * \brief wetted perimeter.
  * \var B
  * \brief surface width.
- * \var u
- * \brief velocity.
- * \var c
- * \brief critical velocity.
  * \var l1
  * \brief first eigenvalue.
  * \var l2
@@ -110,40 +95,12 @@ struct _Node
  * \brief diffusion coefficient.
  * \var KxA
  * \brief Kx * A.
- * \var Kxi
- * \brief soil diffusion coefficient.
- * \var KxiA
- * \brief Kxi * A.
- * \var dF
- * \brief flux difference vector.
- * \var dFl
- * \brief left numerical flux difference vector.
- * \var dFr
- * \brief right numerical flux difference vector.
- * \var nu
- * \brief artificial viscosity coefficient.
- * \var Jp
- * \brief positive implicit operator.
- * \var Jn
- * \brief negative implicit operator.
- * \var Un
- * \brief former time step conserved variables vector.
- * \var dU
- * \brief conserved variables increment vector.
- * \var dWl
- * \brief high order left numerical flux difference vector.
- * \var dWr
- * \brief high order right numerical flux difference vector.
- * \var l
- * \brief jacobian eigenvalues vector.
  * \var beta
  * \brief Boussinesq's parameter.
  */
-	double friction_coefficient[3], infiltration_coefficient[4],
-		diffusion_coefficient[1], x, dx, ix, U[5], s, si, h, f, f1, f2, f3, Sf,
-		Sfn, zb, zs, zmax, P, B, u, c, l1, l2, i, Pi, Z, B0, F, T, Kx, KxA, Kxi,
-		KxiA, dF[3], dFl[3], dFr[3], nu, Jp[9], Jn[9], Un[3], dU[3], dWl[3],
-		dWr[3], l[3], beta;
+	double *friction_coefficient, *infiltration_coefficient,
+		*diffusion_coefficient, x, dx, ix, s, f, zb, zs, zmax, P, B, l1, l2, i,
+		Pi, Z, B0, F, T, Kx, KxA, beta;
 };
 
 /**
@@ -151,25 +108,30 @@ struct _Node
  */
 typedef struct _Node Node;
 
-// global variables
-
-extern double critical_depth_tolerance;
-extern double (*node_normal_discharge)(Node *node, double S);
+struct _Mesh;
 
 // member functions
 
 void node_init(Node *node, Geometry *geometry);
-void node_depth(Node *node);
-void node_width(Node *node);
-void node_perimeter(Node *node);
-void node_critical_velocity(Node *node);
-void node_subcritical_discharge(Node *node);
-double node_critical_depth(Node *node, double Q);
-void node_friction_Manning(Node *node);
-double node_normal_discharge_Manning(Node *node, double S);
-void node_friction_Manning_minimizing_losses(Node *node);
-double node_normal_discharge_Manning_minimizing_losses(Node *node, double S);
-void node_infiltration_KostiakovLewis(Node *node);
-void node_diffusion_Rutherford(Node *node);
+void node_depth(struct _Mesh *mesh, unsigned int i);
+void node_width(struct _Mesh *mesh, unsigned int i);
+void node_perimeter(struct _Mesh *mesh, unsigned int i);
+void node_critical_velocity(struct _Mesh *mesh, unsigned int i);
+void node_subcritical_discharge(struct _Mesh *mesh, unsigned int i);
+void node_dry(struct _Mesh *mesh, unsigned int i);
+double node_critical_depth(Node *node, double Q, double tolerance);
+double node_cbrt(double x);
+double node_power_4_3(double x);
+double node_power_m4_3(double x);
+double node_power_2_3(double x);
+void node_friction_Manning(struct _Mesh *mesh, unsigned int i);
+double node_normal_discharge_Manning(struct _Mesh *mesh, unsigned int i,
+	double S);
+void node_friction_Manning_minimizing_losses(struct _Mesh *mesh,
+	unsigned int i);
+double node_normal_discharge_Manning_minimizing_losses(struct _Mesh *mesh,
+	unsigned int i, double S);
+void node_infiltration_KostiakovLewis(struct _Mesh *mesh, unsigned int i);
+void node_diffusion_Rutherford(struct _Mesh *mesh, unsigned int i);
 
 #endif
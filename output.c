@@ -0,0 +1,388 @@
+/*
+SWOCS: a software to check the numerical performance of different models in
+	channel or furrow flows
+
+Copyright 2011-2014, Javier Burguete Tolosa.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Javier Burguete Tolosa ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL Javier Burguete Tolosa OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/**
+ * \file output.c
+ * \brief Source file to define the output writer of the advance and probes
+ *   series.
+ * \author Javier Burguete Tolosa.
+ * \copyright Copyright 2011-2014, Javier Burguete Tolosa.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include "config.h"
+#include "channel.h"
+#include "node.h"
+#include "mesh.h"
+#include "tridiagonal.h"
+#include "model.h"
+#include "binary.h"
+#include "output.h"
+
+/**
+ * \fn void output_write(Output *output, double *record, unsigned int n)
+ * \brief Function to write a block of records in the advance and probes files.
+ * \param output
+ * \brief output struct.
+ * \param record
+ * \brief array of records.
+ * \param n
+ * \brief number of records.
+ */
+static void output_write(Output *output, double *record, unsigned int n)
+{
+	unsigned int i, j;
+	for (i = 0; i < n; ++i, record += output->size)
+	{
+		// writing the advance
+		if (output->binary_advance)
+			fwrite(record, sizeof(double), 2, output->file_advance);
+		else
+			fprintf(output->file_advance, "%lg %lg\n", record[0], record[1]);
+
+		// writing the probes
+		if (!output->file_probes) continue;
+		if (output->binary_probes)
+		{
+			fwrite(record, sizeof(double), 1, output->file_probes);
+			fwrite(record + 2, sizeof(double), output->size - 2,
+				output->file_probes);
+		}
+		else
+		{
+			fprintf(output->file_probes, "%lg ", record[0]);
+			for (j = 2; j < output->size; j += 2)
+				fprintf(output->file_probes, "%lg %lg ", record[j],
+					record[j + 1]);
+			fprintf(output->file_probes, "\n");
+		}
+	}
+	output->rows += n;
+}
+
+/**
+ * \fn void* output_thread(void *data)
+ * \brief Function executed by the writer thread, writing the blocks of records
+ *   in order until the solver ends.
+ * \param data
+ * \brief output struct.
+ * \return NULL.
+ */
+static void* output_thread(void *data)
+{
+	unsigned int i, n;
+	Output *output = (Output*)data;
+	pthread_mutex_lock(&output->mutex);
+	for (i = 0;; i = 1 - i)
+	{
+		while (!output->ready[i] && !output->end)
+			pthread_cond_wait(&output->cond, &output->mutex);
+		n = output->ready[i];
+		if (!n) break;
+		pthread_mutex_unlock(&output->mutex);
+		output_write(output, output->buffer[i], n);
+		pthread_mutex_lock(&output->mutex);
+		output->ready[i] = 0;
+		pthread_cond_broadcast(&output->cond);
+	}
+	pthread_mutex_unlock(&output->mutex);
+	return NULL;
+}
+
+/**
+ * \fn void output_flush(Output *output)
+ * \brief Function to pass the current block of records to the writer thread
+ *   and to continue in the other block.
+ * \param output
+ * \brief output struct.
+ */
+static void output_flush(Output *output)
+{
+	unsigned int i;
+	i = output->current;
+	if (!output->threaded)
+	{
+		output_write(output, output->buffer[i], output->records);
+		output->records = 0;
+		return;
+	}
+	pthread_mutex_lock(&output->mutex);
+	output->ready[i] = output->records;
+	output->current = i = 1 - i;
+	pthread_cond_broadcast(&output->cond);
+	while (output->ready[i]) pthread_cond_wait(&output->cond, &output->mutex);
+	pthread_mutex_unlock(&output->mutex);
+	output->records = 0;
+}
+
+/**
+ * \fn void output_record(Output *output, Model *model)
+ * \brief Function to store a record of the model state.
+ * \param output
+ * \brief output struct.
+ * \param model
+ * \brief model struct.
+ */
+static void output_record(Output *output, Model *model)
+{
+	int i;
+	unsigned int j, k;
+	double *record;
+	Mesh *mesh = model->mesh;
+	record = output->buffer[output->current] + output->records * output->size;
+	i = mesh->wet;
+	if (i < 0) i = 0;
+	record[0] = model->t;
+	record[1] = mesh->node[i].x;
+	for (j = 2; j < output->size; j += 2)
+	{
+		k = model->probes->node[j / 2 - 1];
+		record[j] = mesh->h[k];
+		record[j + 1] = mesh->node[k].s;
+	}
+	if (++output->records == OUTPUT_RECORDS) output_flush(output);
+}
+
+/**
+ * \fn int output_trim(FILE *file, unsigned int binary, unsigned int columns, \
+ *   double t, unsigned int *rows, double *last)
+ * \brief Function to remove the records of a series file from a time, to
+ *   continue it on a restarted simulation.
+ *
+ * The records before the time are kept and the file is truncated after them,
+ * removing also an incomplete last record. The times of a text file are
+ * compared with the time written with the same format, so the record written
+ * at the time of the checkpoint on a stopped simulation is also removed. The number of rows of a binary file
+ * header is set as unknown until the file is closed.
+ * \param file
+ * \brief series file, opened to read and write.
+ * \param binary
+ * \brief 1 on a binary file, 0 on a text file.
+ * \param columns
+ * \brief number of values of a record.
+ * \param t
+ * \brief time of the first removed record.
+ * \param rows
+ * \brief pointer to the number of kept records.
+ * \param last
+ * \brief pointer to the time of the last kept record.
+ * \return 0 on error, 1 on success.
+ */
+static int output_trim(FILE *file, unsigned int binary, unsigned int columns,
+	double t, unsigned int *rows, double *last)
+{
+	long int position;
+	int c;
+	double record[columns];
+	char buffer[32];
+	BinaryHeader header[1];
+	*rows = 0;
+	rewind(file);
+	if (binary)
+	{
+		position = 0L;
+		if (fread(header, sizeof(BinaryHeader), 1, file) == 1)
+		{
+			if (memcmp(header->magic, BINARY_MAGIC, 8)
+				|| header->version != BINARY_VERSION
+				|| header->size != sizeof(double) || header->columnar
+				|| header->columns != columns)
+				return 0;
+			position = sizeof(BinaryHeader) + columns * BINARY_NAME_LENGTH;
+			if (fseek(file, position, SEEK_SET)) return 0;
+			while (fread(record, sizeof(double), columns, file) == columns
+				&& record[0] < t)
+			{
+				*last = record[0];
+				++*rows;
+				position += columns * sizeof(double);
+			}
+		}
+	}
+	else
+	{
+		snprintf(buffer, sizeof(buffer), "%lg", t);
+		t = strtod(buffer, NULL);
+		for (;;)
+		{
+			position = ftell(file);
+			if (fscanf(file, "%lf", record) != 1 || record[0] >= t) break;
+			do c = fgetc(file); while (c != '\n' && c != EOF);
+			if (c == EOF) break;
+			*last = record[0];
+			++*rows;
+		}
+	}
+	fflush(file);
+#ifdef _WIN32
+	if (_chsize(_fileno(file), position)) return 0;
+#else
+	if (ftruncate(fileno(file), position)) return 0;
+#endif
+	fseek(file, 0L, SEEK_END);
+	if (binary && position) binary_write_rows(file, 0);
+	return 1;
+}
+
+/**
+ * \fn int output_open(Output *output, Model *model, FILE *file_advance, \
+ *   unsigned int binary_advance, FILE *file_probes, \
+ *   unsigned int binary_probes, unsigned int restart)
+ * \brief Function to open an output writer and to start the writer thread.
+ *
+ * On a restarted simulation the files written before are continued, removing
+ * the records from the restart time, which are written again.
+ * \param output
+ * \brief output struct.
+ * \param model
+ * \brief model struct.
+ * \param file_advance
+ * \brief advance file.
+ * \param binary_advance
+ * \brief 1 on a binary advance file, 0 on a text file.
+ * \param file_probes
+ * \brief probes file (NULL if not used).
+ * \param binary_probes
+ * \brief 1 on a binary probes file, 0 on a text file.
+ * \param restart
+ * \brief 1 on a restarted simulation continuing the files, 0 on new files.
+ * \return 0 on error, 1 on success.
+ */
+int output_open(Output *output, Model *model, FILE *file_advance,
+	unsigned int binary_advance, FILE *file_probes, unsigned int binary_probes,
+	unsigned int restart)
+{
+	unsigned int rows;
+	double last;
+	output->file_advance = file_advance;
+	output->file_probes = file_probes;
+	output->binary_advance = binary_advance;
+	output->binary_probes = binary_probes;
+	output->size = 2;
+	if (file_probes) output->size += 2 * model->probes->n;
+	output->buffer[0]
+		= (double*)malloc(2 * OUTPUT_RECORDS * output->size * sizeof(double));
+	if (!output->buffer[0])
+	{
+		print_error("output: not enough memory");
+		return 0;
+	}
+	output->buffer[1] = output->buffer[0] + OUTPUT_RECORDS * output->size;
+	output->interval = model->interval;
+	output->time = model->t;
+	output->records = output->current = output->ready[0] = output->ready[1]
+		= output->rows = output->end = output->threaded = 0;
+
+	// continuing the files of a restarted simulation before the restart time
+	if (restart)
+	{
+		if (!output_trim(file_advance, binary_advance, 2, model->t,
+				&output->rows, &last)
+			|| (file_probes && (!output_trim(file_probes, binary_probes,
+				output->size - 1, model->t, &rows, &last)
+				|| rows != output->rows)))
+		{
+			print_error("output: bad series file to restart");
+			free(output->buffer[0]);
+			return 0;
+		}
+		if (output->rows && output->interval > 0.)
+			output->time
+				= output->interval * (floor(last / output->interval) + 1.);
+	}
+
+	// writing the headers of the new binary files
+	if (binary_advance && !ftell(file_advance))
+		model_write_advance_header(model, file_advance);
+	if (file_probes && binary_probes && !ftell(file_probes))
+		model_write_probes_header(model, file_probes);
+
+	// starting the writer thread, else the records are written by the solver
+	pthread_mutex_init(&output->mutex, NULL);
+	pthread_cond_init(&output->cond, NULL);
+	if (!pthread_create(&output->thread, NULL, output_thread, output))
+		output->threaded = 1;
+	return 1;
+}
+
+/**
+ * \fn void output_push(Output *output, Model *model)
+ * \brief Function to store a record of the model state if the output time
+ *   interval has been reached.
+ * \param output
+ * \brief output struct.
+ * \param model
+ * \brief model struct.
+ */
+void output_push(Output *output, Model *model)
+{
+	if (model->t < output->time) return;
+	if (output->interval > 0.)
+		output->time
+			= output->interval * (floor(model->t / output->interval) + 1.);
+	output_record(output, model);
+}
+
+/**
+ * \fn void output_close(Output *output, Model *model)
+ * \brief Function to store the final record of the model state, to write the
+ *   pending records and to close an output writer.
+ * \param output
+ * \brief output struct.
+ * \param model
+ * \brief model struct.
+ */
+void output_close(Output *output, Model *model)
+{
+	output_record(output, model);
+	if (output->threaded)
+	{
+		pthread_mutex_lock(&output->mutex);
+		output->ready[output->current] = output->records;
+		output->end = 1;
+		pthread_cond_broadcast(&output->cond);
+		pthread_mutex_unlock(&output->mutex);
+		pthread_join(output->thread, NULL);
+	}
+	else output_write(output, output->buffer[output->current],
+		output->records);
+	pthread_mutex_destroy(&output->mutex);
+	pthread_cond_destroy(&output->cond);
+	if (output->binary_advance)
+		binary_write_rows(output->file_advance, output->rows);
+	if (output->file_probes && output->binary_probes)
+		binary_write_rows(output->file_probes, output->rows);
+	free(output->buffer[0]);
+}
@@ -0,0 +1,111 @@
+/*
+SWOCS: a software to check the numerical performance of different models in
+	channel or furrow flows
+
+Copyright 2011-2014, Javier Burguete Tolosa.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Javier Burguete Tolosa ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL Javier Burguete Tolosa OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/**
+ * \file output.h
+ * \brief Header file to define the output writer of the advance and probes
+ *   series.
+ * \author Javier Burguete Tolosa.
+ * \copyright Copyright 2011-2014, Javier Burguete Tolosa.
+ */
+
+// in order to prevent multiple definitions
+#ifndef OUTPUT__H
+#define OUTPUT__H 1
+
+#include <pthread.h>
+
+/**
+ * \struct _Output
+ * \brief Struct to define the output writer of the advance and probes series.
+ *
+ * The solver stores the records (t, x_advance, h_1, s_1, ..., h_N, s_N) in a
+ * block while the writer thread formats and writes the other block in the
+ * files.
+ */
+struct _Output
+{
+/**
+ * \var file_advance
+ * \brief advance file.
+ * \var file_probes
+ * \brief probes file.
+ * \var buffer
+ * \brief array of the two blocks of records.
+ * \var interval
+ * \brief time interval between records (every time step if not positive).
+ * \var time
+ * \brief time of the next record.
+ * \var size
+ * \brief number of values of a record.
+ * \var records
+ * \brief number of records in the current block.
+ * \var current
+ * \brief block filled by the solver.
+ * \var ready
+ * \brief number of records of each block to write (0 on a free block).
+ * \var rows
+ * \brief number of records written.
+ * \var binary_advance
+ * \brief 1 on a binary advance file, 0 on a text file.
+ * \var binary_probes
+ * \brief 1 on a binary probes file, 0 on a text file.
+ * \var end
+ * \brief 1 when the solver does not add more records.
+ * \var threaded
+ * \brief 1 if the writer thread is running, 0 writing in the solver thread.
+ * \var thread
+ * \brief writer thread.
+ * \var mutex
+ * \brief mutex to access the blocks.
+ * \var cond
+ * \brief condition to signal a change of the blocks.
+ */
+	FILE *file_advance, *file_probes;
+	double *buffer[2], interval, time;
+	unsigned int size, records, current, ready[2], rows, binary_advance,
+		binary_probes, end, threaded;
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+};
+
+/**
+ * \typedef Output
+ */
+typedef struct _Output Output;
+
+// member functions
+
+int output_open(Output *output, Model *model, FILE *file_advance,
+	unsigned int binary_advance, FILE *file_probes, unsigned int binary_probes,
+	unsigned int restart);
+void output_push(Output *output, Model *model);
+void output_close(Output *output, Model *model);
+
+#endif
@@ -0,0 +1,354 @@
+/*
+SWOCS: a software to check the numerical performance of different models in
+	channel or furrow flows
+
+Copyright 2011-2014, Javier Burguete Tolosa.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Javier Burguete Tolosa ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL Javier Burguete Tolosa OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/**
+ * \file profile.c
+ * \brief Source file to define the instrumentation of the time steps.
+ * \author Javier Burguete Tolosa.
+ * \copyright Copyright 2011-2014, Javier Burguete Tolosa.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "config.h"
+#include "channel.h"
+#include "node.h"
+#include "mesh.h"
+#include "tridiagonal.h"
+#include "model.h"
+#include "profile.h"
+
+/**
+ * \var profile_name
+ * \brief array of names of the phases.
+ */
+static const char *profile_name[PROFILE_PHASES] =
+{
+	"time_step", "surface_flow", "inlet", "outlet", "diffusion", "infiltration",
+	"parameters", "active", "output", "adapt"
+};
+
+/**
+ * \fn double profile_clock(void)
+ * \brief Function to get the wall time in seconds (the processor time without
+ *   OpenMP).
+ * \return time in seconds.
+ */
+double profile_clock(void)
+{
+#ifdef _OPENMP
+	return omp_get_wtime();
+#else
+	return clock() / ((double)CLOCKS_PER_SEC);
+#endif
+}
+
+/**
+ * \fn double profile_phase(Profile *profile, unsigned int phase, double t0)
+ * \brief Function to add a call to a phase.
+ * \param profile
+ * \brief profile struct.
+ * \param phase
+ * \brief phase number.
+ * \param t0
+ * \brief wall time at the start of the phase.
+ * \return wall time at the end of the phase.
+ */
+double profile_phase(Profile *profile, unsigned int phase, double t0)
+{
+	double t;
+	t = profile_clock();
+	profile->time[phase] += t - t0;
+	++profile->calls[phase];
+	return t;
+}
+
+/**
+ * \fn static void profile_model_inlet(Model *model)
+ * \brief Function to calculate and to profile the inlet.
+ * \param model
+ * \brief model struct.
+ */
+static void profile_model_inlet(Model *model)
+{
+	Profile *profile = model->profile;
+	double t0;
+	t0 = profile_clock();
+	profile->model_inlet(model);
+	profile_phase(profile, PROFILE_PHASE_INLET, t0);
+}
+
+/**
+ * \fn static void profile_model_outlet(Model *model)
+ * \brief Function to calculate and to profile the outlet.
+ * \param model
+ * \brief model struct.
+ */
+static void profile_model_outlet(Model *model)
+{
+	Profile *profile = model->profile;
+	double t0;
+	t0 = profile_clock();
+	profile->model_outlet(model);
+	profile_phase(profile, PROFILE_PHASE_OUTLET, t0);
+}
+
+/**
+ * \fn static long int profile_memory(void)
+ * \brief Function to get the peak resident memory of the process.
+ * \return peak resident memory in kilobytes (0 if unknown).
+ */
+static long int profile_memory(void)
+{
+#ifdef _WIN32
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage)) return 0;
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+#endif
+}
+
+/**
+ * \fn static void profile_write_phases(Profile *profile)
+ * \brief Function to write the times and the calls of the phases.
+ * \param profile
+ * \brief profile struct.
+ */
+static void profile_write_phases(Profile *profile)
+{
+	unsigned int i;
+	fprintf(profile->file, "\"phases\":{");
+	for (i = 0; i < PROFILE_PHASES; ++i)
+		fprintf(profile->file, "%s\"%s\":{\"time\":%.6le,\"calls\":%lu}",
+			i ? "," : "", profile_name[i], profile->time[i], profile->calls[i]);
+	fprintf(profile->file, "}");
+}
+
+/**
+ * \fn static void profile_write_histogram(FILE *file, char *name, \
+ *   unsigned long int *histogram, unsigned int n)
+ * \brief Function to write a histogram.
+ * \param file
+ * \brief file.
+ * \param name
+ * \brief histogram name.
+ * \param histogram
+ * \brief array of bin counts.
+ * \param n
+ * \brief number of bins.
+ */
+static void profile_write_histogram(FILE *file, char *name,
+	unsigned long int *histogram, unsigned int n)
+{
+	unsigned int i;
+	fprintf(file, "\"%s\":[", name);
+	for (i = 0; i < n; ++i) fprintf(file, "%s%lu", i ? "," : "", histogram[i]);
+	fprintf(file, "]");
+}
+
+/**
+ * \fn int profile_open(Profile *profile, Model *model, FILE *file, \
+ *   unsigned int sample)
+ * \brief Function to start the instrumentation of a model.
+ *
+ * The profile writes in the file a JSON object by line: a sample every sample
+ * time steps and a summary at the end.
+ * \param profile
+ * \brief profile struct.
+ * \param model
+ * \brief model struct.
+ * \param file
+ * \brief profile file.
+ * \param sample
+ * \brief number of time steps between samples (0 to write only the summary).
+ * \return 0 on error, 1 on success.
+ */
+int profile_open(Profile *profile, Model *model, FILE *file,
+	unsigned int sample)
+{
+	memset(profile, 0, sizeof(Profile));
+	profile->n = model->mesh->nmax;
+	profile->limiting
+		= (unsigned long int*)calloc(profile->n, sizeof(unsigned long int));
+	if (!profile->limiting)
+	{
+		print_error("profile: not enough memory");
+		return 0;
+	}
+	profile->file = file;
+	profile->sample = sample;
+	profile->dt_minimum = INFINITY;
+	profile->last = profile->n;
+	profile->t0 = model->t;
+	profile->water = mesh_water_mass(model->mesh);
+	profile->model_inlet = model->model_inlet;
+	profile->model_outlet = model->model_outlet;
+	model->model_inlet = profile_model_inlet;
+	model->model_outlet = profile_model_outlet;
+	model->profile = profile;
+	profile->start = profile_clock();
+	return 1;
+}
+
+/**
+ * \fn void profile_step(Profile *profile, Model *model, unsigned int inlet)
+ * \brief Function to add a time step of the model to the profile.
+ * \param profile
+ * \brief profile struct.
+ * \param model
+ * \brief model struct.
+ * \param inlet
+ * \brief 1 if the time step size is limited by the inlet, 0 if it is limited
+ *   by a node.
+ */
+void profile_step(Profile *profile, Model *model, unsigned int inlet)
+{
+	unsigned int i;
+	int decade;
+	double v, vmax;
+	Mesh *mesh = model->mesh;
+
+	// time step size histogram
+	profile->dt_minimum = fmin(profile->dt_minimum, model->dt);
+	profile->dt_maximum = fmax(profile->dt_maximum, model->dt);
+	if (model->dt > 0.)
+	{
+		decade = (int)floor(log10(model->dt)) - PROFILE_DT_DECADE + 1;
+		if (decade < 0) decade = 0;
+		else if (decade > PROFILE_DT_DECADES + 1)
+			decade = PROFILE_DT_DECADES + 1;
+	}
+	else decade = 0;
+	++profile->dt_histogram[decade];
+
+	// node limiting the time step size
+	if (inlet)
+	{
+		profile->last = profile->n;
+		++profile->limiting_inlet;
+	}
+	else
+	{
+		vmax = -INFINITY;
+		for (i = 0; i < mesh->na; ++i)
+		{
+			if (model->type_diffusion == 1)
+				v = model_node_diffusion_1dt_max(mesh, i);
+			else
+				v = model->node_1dt_max(mesh, i);
+			if (v > vmax)
+			{
+				vmax = v;
+				profile->last = i;
+			}
+		}
+		++profile->limiting[profile->last];
+	}
+
+	// nonlinear iterations histogram
+	if (model->type_surface_flow == 3)
+	{
+		i = (model->iterations < PROFILE_ITERATIONS) ?
+			model->iterations : PROFILE_ITERATIONS - 1;
+		++profile->iterations_histogram[i];
+	}
+
+	// sample
+	++profile->steps;
+	if (!profile->sample || profile->steps % profile->sample) return;
+	fprintf(profile->file,
+		"{\"type\":\"sample\",\"steps\":%u,\"t\":%.14le,\"dt\":%.14le,"
+		"\"wall\":%.6le,\"limiting\":%d,\"iterations\":%u,",
+		profile->steps, model->t, model->dt, profile_clock() - profile->start,
+		(profile->last == profile->n) ? -1 : (int)profile->last,
+		model->iterations);
+	profile_write_phases(profile);
+	fprintf(profile->file, "}\n");
+}
+
+/**
+ * \fn void profile_close(Profile *profile, Model *model)
+ * \brief Function to write the summary of the profile and to stop the
+ *   instrumentation of a model.
+ * \param profile
+ * \brief profile struct.
+ * \param model
+ * \brief model struct.
+ */
+void profile_close(Profile *profile, Model *model)
+{
+	unsigned int i, imax;
+	FILE *file = profile->file;
+
+	// node limiting more time steps
+	for (i = imax = 0; i < profile->n; ++i)
+		if (profile->limiting[i] > profile->limiting[imax]) imax = i;
+
+	fprintf(file,
+		"{\"type\":\"summary\",\"steps\":%u,\"t\":%.14le,\"wall\":%.6le,"
+		"\"nodes\":%u,",
+		profile->steps, model->t, profile_clock() - profile->start,
+		profile->n);
+	profile_write_phases(profile);
+	fprintf(file, ",\"dt\":{\"minimum\":%.14le,\"maximum\":%.14le,"
+		"\"decade\":%d,",
+		profile->steps ? profile->dt_minimum : 0., profile->dt_maximum,
+		PROFILE_DT_DECADE);
+	profile_write_histogram(file, "histogram", profile->dt_histogram,
+		PROFILE_DT_DECADES + 2);
+	fprintf(file, "},\"limiting\":{\"inlet\":%lu,\"node\":%u,\"x\":%.14le,"
+		"\"steps\":%lu},",
+		profile->limiting_inlet, imax, model->mesh->node[imax].x,
+		profile->limiting[imax]);
+	fprintf(file, "\"iterations\":{\"total\":%u,", model->iterations_number);
+	profile_write_histogram(file, "histogram", profile->iterations_histogram,
+		PROFILE_ITERATIONS);
+	fprintf(file, "},\"water\":{\"initial\":%.14le,\"final\":%.14le,"
+		"\"inlet\":%.14le},\"memory\":%ld}\n",
+		profile->water, mesh_water_mass(model->mesh),
+		hydrogram_integrate(model->channel->water_inlet, profile->t0, model->t),
+		profile_memory());
+
+	model->model_inlet = profile->model_inlet;
+	model->model_outlet = profile->model_outlet;
+	model->profile = NULL;
+	free(profile->limiting);
+}
@@ -0,0 +1,163 @@
+/*
+SWOCS: a software to check the numerical performance of different models in
+	channel or furrow flows
+
+Copyright 2011-2014, Javier Burguete Tolosa.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Javier Burguete Tolosa ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL Javier Burguete Tolosa OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/**
+ * \file profile.h
+ * \brief Header file to define the instrumentation of the time steps.
+ * \author Javier Burguete Tolosa.
+ * \copyright Copyright 2011-2014, Javier Burguete Tolosa.
+ */
+
+// in order to prevent multiple definitions
+#ifndef PROFILE__H
+#define PROFILE__H 1
+
+/**
+ * \def PROFILE_PHASE_TIME_STEP
+ * \brief phase calculating the time step size.
+ * \def PROFILE_PHASE_SURFACE_FLOW
+ * \brief phase of the numerical surface flow scheme (including the inlet, the
+ *   outlet and the parameters of the nonlinear iterations).
+ * \def PROFILE_PHASE_INLET
+ * \brief phase of the inlet boundary condition.
+ * \def PROFILE_PHASE_OUTLET
+ * \brief phase of the outlet boundary condition.
+ * \def PROFILE_PHASE_DIFFUSION
+ * \brief phase of the numerical diffusion scheme.
+ * \def PROFILE_PHASE_INFILTRATION
+ * \brief phase of the infiltration model.
+ * \def PROFILE_PHASE_PARAMETERS
+ * \brief phase calculating the model parameters.
+ * \def PROFILE_PHASE_ACTIVE
+ * \brief phase updating the active part of the mesh.
+ * \def PROFILE_PHASE_OUTPUT
+ * \brief phase storing the advance and the probes.
+ * \def PROFILE_PHASE_ADAPT
+ * \brief phase adapting the refinement of an adaptive mesh.
+ * \def PROFILE_PHASES
+ * \brief number of phases.
+ */
+#define PROFILE_PHASE_TIME_STEP 0
+#define PROFILE_PHASE_SURFACE_FLOW 1
+#define PROFILE_PHASE_INLET 2
+#define PROFILE_PHASE_OUTLET 3
+#define PROFILE_PHASE_DIFFUSION 4
+#define PROFILE_PHASE_INFILTRATION 5
+#define PROFILE_PHASE_PARAMETERS 6
+#define PROFILE_PHASE_ACTIVE 7
+#define PROFILE_PHASE_OUTPUT 8
+#define PROFILE_PHASE_ADAPT 9
+#define PROFILE_PHASES 10
+
+/**
+ * \def PROFILE_DT_DECADE
+ * \brief decimal exponent of the lower limit of the time step size histogram.
+ * \def PROFILE_DT_DECADES
+ * \brief number of decades of the time step size histogram.
+ * \def PROFILE_ITERATIONS
+ * \brief number of bins of the nonlinear iterations histogram.
+ */
+#define PROFILE_DT_DECADE -6
+#define PROFILE_DT_DECADES 10
+#define PROFILE_ITERATIONS 16
+
+/**
+ * \struct _Profile
+ * \brief Struct to define the instrumentation of the time steps.
+ *
+ * The phase times are wall times, so the nested phases (inlet, outlet and the
+ * parameters of the implicit schemes) are also added to the surface flow
+ * phase.
+ */
+struct _Profile
+{
+/**
+ * \var file
+ * \brief profile file.
+ * \var time
+ * \brief array of wall times of the phases.
+ * \var start
+ * \brief wall time at the start of the profile.
+ * \var t0
+ * \brief model time at the start of the profile.
+ * \var water
+ * \brief water mass at the start of the profile.
+ * \var dt_minimum
+ * \brief minimum time step size.
+ * \var dt_maximum
+ * \brief maximum time step size.
+ * \var calls
+ * \brief array of numbers of calls of the phases.
+ * \var dt_histogram
+ * \brief histogram of the time step sizes by decades, the first and the last
+ *   bins counting the sizes out of the range.
+ * \var iterations_histogram
+ * \brief histogram of the nonlinear iterations of the implicit schemes, the
+ *   last bin counting also the greater numbers.
+ * \var limiting
+ * \brief array of numbers of time steps limited by every node.
+ * \var limiting_inlet
+ * \brief number of time steps limited by the inlet.
+ * \var steps
+ * \brief number of time steps.
+ * \var sample
+ * \brief number of time steps between samples (0 without samples).
+ * \var n
+ * \brief number of mesh nodes.
+ * \var last
+ * \brief node limiting the last time step (n if the inlet).
+ * \var model_inlet
+ * \brief pointer to the profiled function calculating the inlet.
+ * \var model_outlet
+ * \brief pointer to the profiled function calculating the outlet.
+ */
+	FILE *file;
+	double time[PROFILE_PHASES], start, t0, water, dt_minimum, dt_maximum;
+	unsigned long int calls[PROFILE_PHASES],
+		dt_histogram[PROFILE_DT_DECADES + 2],
+		iterations_histogram[PROFILE_ITERATIONS], *limiting, limiting_inlet;
+	unsigned int steps, sample, n, last;
+	void (*model_inlet)(Model *model);
+	void (*model_outlet)(Model *model);
+};
+
+/**
+ * \typedef Profile
+ */
+typedef struct _Profile Profile;
+
+// member functions
+
+double profile_clock(void);
+double profile_phase(Profile *profile, unsigned int phase, double t0);
+int profile_open(Profile *profile, Model *model, FILE *file,
+	unsigned int sample);
+void profile_step(Profile *profile, Model *model, unsigned int inlet);
+void profile_close(Profile *profile, Model *model);
+
+#endif
@@ -0,0 +1,172 @@
+/*
+SWOCS: a software to check the numerical performance of different models in
+	channel or furrow flows
+
+Copyright 2011-2014, Javier Burguete Tolosa.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Javier Burguete Tolosa ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL Javier Burguete Tolosa OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/**
+ * \file tridiagonal.c
+ * \brief Source file to define the tridiagonal solver of the implicit
+ *   numerical schemes.
+ *
+ * The implicit diffusion scheme and the implicit depth correction of the
+ * zero-inertia model solve a tridiagonal system every time step. The system
+ * is solved by the Thomas algorithm in a workspace allocated once with the
+ * model, sized to the maximum number of mesh nodes and aligned to allow
+ * vectorized sweeps. Several right hand sides can be solved at once with the
+ * same factorization, as when several solutes are transported.
+ * \author Javier Burguete Tolosa.
+ * \copyright Copyright 2011-2014, Javier Burguete Tolosa.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "config.h"
+#include "channel.h"
+#include "tridiagonal.h"
+
+/**
+ * \fn void* tridiagonal_alloc(size_t size)
+ * \brief Function to allocate an aligned array of the workspace.
+ * \param size
+ * \brief size in bytes.
+ * \return pointer to the array, NULL on error.
+ */
+void* tridiagonal_alloc(size_t size)
+{
+	void *p;
+#ifdef _WIN32
+	p = _aligned_malloc(size, TRIDIAGONAL_ALIGNMENT);
+#else
+	if (posix_memalign(&p, TRIDIAGONAL_ALIGNMENT, size)) p = NULL;
+#endif
+	return p;
+}
+
+/**
+ * \fn void tridiagonal_free(void *p)
+ * \brief Function to free an aligned array of the workspace.
+ * \param p
+ * \brief pointer to the array.
+ */
+void tridiagonal_free(void *p)
+{
+#ifdef _WIN32
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+/**
+ * \fn int tridiagonal_open(Tridiagonal *tridiagonal, unsigned int nmax, \
+ *   unsigned int m)
+ * \brief Function to allocate the workspace of a tridiagonal system.
+ * \param tridiagonal
+ * \brief tridiagonal struct.
+ * \param nmax
+ * \brief maximum number of rows.
+ * \param m
+ * \brief number of right hand sides.
+ * \return 0 on error, 1 on success.
+ */
+int tridiagonal_open(Tridiagonal *tridiagonal, unsigned int nmax,
+	unsigned int m)
+{
+	tridiagonal->nmax = nmax;
+	tridiagonal->m = m;
+	tridiagonal->C = (double*)tridiagonal_alloc(nmax * sizeof(double));
+	tridiagonal->D = (double*)tridiagonal_alloc(nmax * sizeof(double));
+	tridiagonal->E = (double*)tridiagonal_alloc(nmax * sizeof(double));
+	tridiagonal->H = (double*)tridiagonal_alloc(nmax * m * sizeof(double));
+	if (!tridiagonal->C || !tridiagonal->D || !tridiagonal->E
+		|| !tridiagonal->H)
+	{
+		print_error("tridiagonal: not enough memory");
+		return 0;
+	}
+	return 1;
+}
+
+/**
+ * \fn void tridiagonal_solve(Tridiagonal *tridiagonal, unsigned int n)
+ * \brief Function to solve a tridiagonal system by the Thomas algorithm.
+ *
+ * The C, D, E and H arrays of the n first rows have to be filled before. The
+ * diagonal is modified and the right hand sides are replaced by the solutions.
+ * A null pivot gives a null solution in its row.
+ * \param tridiagonal
+ * \brief tridiagonal struct.
+ * \param n
+ * \brief number of rows.
+ */
+void tridiagonal_solve(Tridiagonal *tridiagonal, unsigned int n)
+{
+	unsigned int i, j, m;
+	double k, *C, *D, *E, *H, *Hn, *Hp;
+	C = tridiagonal->C;
+	D = tridiagonal->D;
+	E = tridiagonal->E;
+	H = tridiagonal->H;
+	m = tridiagonal->m;
+
+	// forward elimination
+
+	for (i = 0; ++i < n;)
+	{
+		if (D[i - 1] == 0.) k = 0.; else k = C[i - 1] / D[i - 1];
+		D[i] -= k * E[i - 1];
+		Hn = H + i * m;
+		Hp = Hn - m;
+		for (j = 0; j < m; ++j) Hn[j] -= k * Hp[j];
+	}
+
+	// backward substitution
+
+	i = n - 1;
+	Hn = H + i * m;
+	if (D[i] == 0.) for (j = 0; j < m; ++j) Hn[j] = 0.;
+	else for (j = 0; j < m; ++j) Hn[j] /= D[i];
+	while (i-- > 0)
+	{
+		Hp = Hn;
+		Hn = H + i * m;
+		if (D[i] == 0.) for (j = 0; j < m; ++j) Hn[j] = 0.;
+		else for (j = 0; j < m; ++j) Hn[j] = (Hn[j] - E[i] * Hp[j]) / D[i];
+	}
+}
+
+/**
+ * \fn void tridiagonal_delete(Tridiagonal *tridiagonal)
+ * \brief Function to free the workspace of a tridiagonal system.
+ * \param tridiagonal
+ * \brief tridiagonal struct.
+ */
+void tridiagonal_delete(Tridiagonal *tridiagonal)
+{
+	tridiagonal_free(tridiagonal->C);
+	tridiagonal_free(tridiagonal->D);
+	tridiagonal_free(tridiagonal->E);
+	tridiagonal_free(tridiagonal->H);
+}
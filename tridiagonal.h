@@ -0,0 +1,84 @@
+/*
+SWOCS: a software to check the numerical performance of different models in
+	channel or furrow flows
+
+Copyright 2011-2014, Javier Burguete Tolosa.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice,
+		this list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright notice,
+		this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Javier Burguete Tolosa ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL Javier Burguete Tolosa OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/**
+ * \file tridiagonal.h
+ * \brief Header file to define the tridiagonal solver of the implicit
+ *   numerical schemes.
+ * \author Javier Burguete Tolosa.
+ * \copyright Copyright 2011-2014, Javier Burguete Tolosa.
+ */
+
+// in order to prevent multiple definitions
+#ifndef TRIDIAGONAL__H
+#define TRIDIAGONAL__H 1
+
+/**
+ * \def TRIDIAGONAL_ALIGNMENT
+ * \brief alignment in bytes of the workspace arrays.
+ */
+#define TRIDIAGONAL_ALIGNMENT 64
+
+/**
+ * \struct _Tridiagonal
+ * \brief Struct to define the workspace of a tridiagonal system.
+ * \var C
+ * \brief lower diagonal array (C[i] multiplies the unknown i in the row i+1).
+ * \var D
+ * \brief diagonal array.
+ * \var E
+ * \brief upper diagonal array (E[i] multiplies the unknown i+1 in the row i).
+ * \var H
+ * \brief right hand sides array, replaced by the solutions, with the m values
+ *   of a row stored contiguously.
+ * \var nmax
+ * \brief maximum number of rows.
+ * \var m
+ * \brief number of right hand sides.
+ */
+struct _Tridiagonal
+{
+	double *C, *D, *E, *H;
+	unsigned int nmax, m;
+};
+
+/**
+ * \typedef Tridiagonal
+ */
+typedef struct _Tridiagonal Tridiagonal;
+
+// member functions
+
+void* tridiagonal_alloc(size_t size);
+void tridiagonal_free(void *p);
+int tridiagonal_open(Tridiagonal *tridiagonal, unsigned int nmax,
+	unsigned int m);
+void tridiagonal_solve(Tridiagonal *tridiagonal, unsigned int n);
+void tridiagonal_delete(Tridiagonal *tridiagonal);
+
+#endif